@@ -290,8 +290,11 @@ int main( int argc, char **argv ) {
 #endif
   int argc_max;
   //  int flag_dryrun = 0;
-  int pipid;
-  int i, j, d;
+  int pipid, *pipids;
+  int i, j;
+#ifdef NOT_YET
+  int d;
+#endif
   int extval, errsig;
   int err = 0;
 
@@ -405,8 +408,8 @@ int main( int argc, char **argv ) {
       pip_spawn_from_func( &prog, nargv[0], spawn->func, NULL,
 			   NULL, NULL );
     }
-    for( i=0; i<spawn->ntasks; i++ ) {
 #ifdef NOT_YET
+    for( i=0; i<spawn->ntasks; i++ ) {
       int j = i;
       int s = nt_start;
       int c;
@@ -420,9 +423,6 @@ int main( int argc, char **argv ) {
 	}
       }
       d = ( s + nt_start ) % ncores;
-#else
-      d = PIP_CPUCORE_ASIS;
-#endif
       pipid = j++;
       err = pip_task_spawn( &prog, d, 0, &pipid, NULL );
       if( err ) {
@@ -430,6 +430,23 @@ int main( int argc, char **argv ) {
 	pip_exit( err );
       }
     }
+#else
+    pipids = (int*) malloc( sizeof( int ) * spawn->ntasks );
+    if( pipids == NULL ) {
+      fprintf( stderr, "%s: Not enough memory (pipids)\n", program );
+      (void) pip_kill_all_child_tasks();
+      pip_exit( ENOMEM );
+    }
+    for( i=0; i<spawn->ntasks; i++ ) pipids[i] = j++;
+    /* tasks running the same program are spawned at once */
+    err = pip_task_spawn_n( &prog, spawn->ntasks, PIP_CPUCORE_ASIS, 0,
+			    pipids, NULL );
+    free( pipids );
+    if( err ) {
+      (void) pip_kill_all_child_tasks();
+      pip_exit( err );
+    }
+#endif
     nt_start += spawn->ntasks;
   }
   extval = 0;
@@ -89,7 +89,9 @@ DEPINCS = $(PIP_INCDIR)/pip/pip_config.h		\
 	  $(PIP_INCDIR)/pip/pip_clone.h			\
 	  $(PIP_INCDIR)/pip/pip_util.h			\
 	  $(PIP_INCDIR)/pip/pip_list.h 			\
+	  $(PIP_INCDIR)/pip/pip_sync.h			\
 	  $(PIP_INCDIR)/pip/pip_debug.h			\
+	  $(PIP_INCDIR)/pip/pip_mem.h			\
 	  $(PIP_INCDIR)/pip/pip_machdep.h 		\
 	  $(PIP_INCDIR)/pip/pip_machdep_aarch64.h 	\
 	  $(PIP_INCDIR)/pip/pip_machdep_x86_64.h 	\
@@ -0,0 +1,96 @@
+/*
+ * $PIP_license: <Simplified BSD License>
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *     Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ * 
+ *     Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ * $
+ * $RIKEN_copyright: Riken Center for Computational Sceience (R-CCS),
+ * System Software Development Team, 2016-2022
+ * $
+ * $PIP_VERSION: Version 2.4.1$
+ *
+ * $Author: Atsushi Hori 
+ * Query:   procinproc-info@googlegroups.com
+ * User ML: procinproc-users@googlegroups.com
+ * $
+ */
+
+/* Latency of pip_barrier_wait() and pip_tree_barrier_wait() with */
+/* the root and NTASKS PiP tasks, e.g., 8, 64 and 256 tasks.      */
+/*   usage: barrier_bench [NTASKS]                                 */
+
+#include <pip/pip.h>
+#include <stdlib.h>
+
+#define NWARMUP		(100)
+#define NITERS		(10000)
+
+struct bench {
+  pip_barrier_t		barrier;
+  pip_tree_barrier_t	*tree;
+} bench;
+
+static void run( struct bench *bp, int rank ) {
+  int i;
+  for( i=0; i<NWARMUP+NITERS; i++ ) pip_barrier_wait( &bp->barrier );
+  for( i=0; i<NWARMUP+NITERS; i++ ) pip_tree_barrier_wait( bp->tree, rank );
+}
+
+int main( int argc, char **argv ) {
+  void *export = (void*) &bench;
+  double t0, t_flat, t_tree;
+  int pipid, ntasks, i, err;
+
+  ntasks = ( argc > 1 ) ? atoi( argv[1] ) : 8;
+  pip_init( &pipid, &ntasks, &export, 0 );
+  if( pipid != PIP_PIPID_ROOT ) {
+    run( (struct bench*) export, pipid );
+    pip_fin();
+    return 0;
+  }
+  pip_barrier_init( &bench.barrier, ntasks + 1 );
+  if( ( err = pip_tree_barrier_create( &bench.tree, ntasks + 1 ) ) != 0 ) {
+    fprintf( stderr, "pip_tree_barrier_create(): %s\n", strerror( err ) );
+    return 1;
+  }
+  for( i=0; i<ntasks; i++ ) {
+    pipid = i;
+    pip_spawn( argv[0], argv, NULL, PIP_CPUCORE_ASIS, &pipid,
+	       NULL, NULL, NULL );
+  }
+  /* the root is the last rank */
+  for( i=0; i<NWARMUP; i++ ) pip_barrier_wait( &bench.barrier );
+  t0 = pip_gettime();
+  for( i=0; i<NITERS; i++ ) pip_barrier_wait( &bench.barrier );
+  t_flat = pip_gettime() - t0;
+  for( i=0; i<NWARMUP; i++ ) pip_tree_barrier_wait( bench.tree, ntasks );
+  t0 = pip_gettime();
+  for( i=0; i<NITERS; i++ ) pip_tree_barrier_wait( bench.tree, ntasks );
+  t_tree = pip_gettime() - t0;
+
+  for( i=0; i<ntasks; i++ ) pip_wait( i, NULL );
+  printf( "%4d tasks  pip_barrier %8.2f us  pip_tree_barrier %8.2f us\n",
+	  ntasks, t_flat / NITERS * 1e6, t_tree / NITERS * 1e6 );
+  pip_tree_barrier_destroy( bench.tree );
+  pip_barrier_fin( &bench.barrier );
+  pip_fin();
+  return 0;
+}
@@ -0,0 +1,166 @@
+/*
+ * $PIP_license: <Simplified BSD License>
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *     Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ * 
+ *     Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ * $
+ * $RIKEN_copyright: Riken Center for Computational Sceience (R-CCS),
+ * System Software Development Team, 2016-2022
+ * $
+ * $PIP_VERSION: Version 2.4.1$
+ *
+ * $Author: Atsushi Hori 
+ * Query:   procinproc-info@googlegroups.com
+ * User ML: procinproc-users@googlegroups.com
+ * $
+ */
+
+/* Throughput and latency of channels. Task 0 sends to the root    */
+/* over an SPSC channel one by one and in batches, all the tasks   */
+/* send to the root over an MPMC channel, and then the root and    */
+/* task 0 play ping-pong over two named SPSC channels. Run this in */
+/* both the thread and the process modes, e.g.,                    */
+/*   PIP_MODE=thread  channel_bench [NTASKS]                        */
+/*   PIP_MODE=process channel_bench [NTASKS]                        */
+
+#include <pip/pip.h>
+#include <stdlib.h>
+
+#define NMSGS		(1000000)
+#define NPINGS		(100000)
+#define BATCH		(32)
+#define CAPACITY	(1024)
+
+struct bench {
+  pip_barrier_t		barrier;
+  pip_channel_t		*spsc;
+  pip_channel_t		*mpmc;
+} bench;
+
+static void task( struct bench *bp, int pipid, int ntasks ) {
+  pip_channel_t *ping, *pong;
+  uint64_t msg, msgs[BATCH];
+  int i, n;
+
+  pip_barrier_wait( &bp->barrier );
+  if( pipid == 0 ) {
+    for( i=0; i<NMSGS; i++ ) {
+      msg = i;
+      pip_channel_send( bp->spsc, &msg );
+    }
+  }
+  pip_barrier_wait( &bp->barrier );
+  if( pipid == 0 ) {
+    for( i=0; i<BATCH; i++ ) msgs[i] = i;
+    for( i=0; i<NMSGS; i+=n ) {
+      n = ( NMSGS - i < BATCH ) ? NMSGS - i : BATCH;
+      if( pip_channel_send_n( bp->spsc, msgs, n, &n ) != 0 ) n = 0;
+    }
+  }
+  pip_barrier_wait( &bp->barrier );
+  for( i=0; i<NMSGS/ntasks; i++ ) {
+    msg = i;
+    pip_channel_send( bp->mpmc, &msg );
+  }
+  pip_barrier_wait( &bp->barrier );
+  if( pipid == 0 ) {
+    pip_channel_create( &pong, sizeof(msg), CAPACITY,
+			PIP_CHANNEL_SPSC | PIP_CHANNEL_BLOCK, "pong" );
+    pip_channel_attach( &ping, PIP_PIPID_ROOT, "ping" );
+    for( i=0; i<NPINGS; i++ ) {
+      pip_channel_recv( ping, &msg );
+      pip_channel_send( pong, &msg );
+    }
+  }
+  pip_barrier_wait( &bp->barrier );
+  if( pipid == 0 ) pip_channel_destroy( pong );
+}
+
+static void report( char *what, int n, double t ) {
+  printf( "%-24s %10.1f Mmsgs/s %8.1f ns/msg\n",
+	  what, (double) n / t * 1e-6, t / n * 1e9 );
+}
+
+int main( int argc, char **argv ) {
+  pip_channel_t *ping, *pong;
+  void *export = (void*) &bench;
+  uint64_t msg, msgs[BATCH];
+  double t0;
+  int pipid, ntasks, nmpmc, i, n;
+
+  ntasks = ( argc > 1 ) ? atoi( argv[1] ) : 2;
+  pip_init( &pipid, &ntasks, &export, 0 );
+  if( pipid != PIP_PIPID_ROOT ) {
+    task( (struct bench*) export, pipid, ntasks );
+    pip_fin();
+    return 0;
+  }
+  pip_barrier_init( &bench.barrier, ntasks + 1 );
+  pip_channel_create( &bench.spsc, sizeof(msg), CAPACITY,
+		      PIP_CHANNEL_SPSC, NULL );
+  pip_channel_create( &bench.mpmc, sizeof(msg), CAPACITY,
+		      PIP_CHANNEL_MPMC, NULL );
+  pip_channel_create( &ping, sizeof(msg), CAPACITY,
+		      PIP_CHANNEL_SPSC | PIP_CHANNEL_BLOCK, "ping" );
+  for( i=0; i<ntasks; i++ ) {
+    pipid = i;
+    pip_spawn( argv[0], argv, NULL, PIP_CPUCORE_ASIS, &pipid,
+	       NULL, NULL, NULL );
+  }
+  printf( "%s mode, %d tasks\n", pip_get_mode_str(), ntasks );
+
+  pip_barrier_wait( &bench.barrier );
+  t0 = pip_gettime();
+  for( i=0; i<NMSGS; i++ ) pip_channel_recv( bench.spsc, &msg );
+  report( "SPSC", NMSGS, pip_gettime() - t0 );
+
+  pip_barrier_wait( &bench.barrier );
+  t0 = pip_gettime();
+  for( i=0; i<NMSGS; i+=n ) {
+    if( pip_channel_recv_n( bench.spsc, msgs, BATCH, &n ) != 0 ) n = 0;
+  }
+  report( "SPSC batched", NMSGS, pip_gettime() - t0 );
+
+  pip_barrier_wait( &bench.barrier );
+  nmpmc = ( NMSGS / ntasks ) * ntasks;
+  t0 = pip_gettime();
+  for( i=0; i<nmpmc; i++ ) pip_channel_recv( bench.mpmc, &msg );
+  report( "MPMC", nmpmc, pip_gettime() - t0 );
+
+  pip_barrier_wait( &bench.barrier );
+  pip_channel_attach( &pong, 0, "pong" );
+  t0 = pip_gettime();
+  for( i=0; i<NPINGS; i++ ) {
+    msg = i;
+    pip_channel_send( ping, &msg );
+    pip_channel_recv( pong, &msg );
+  }
+  printf( "%-24s %10.2f us round trip\n", "ping-pong",
+	  ( pip_gettime() - t0 ) / NPINGS * 1e6 );
+  pip_barrier_wait( &bench.barrier );
+
+  for( i=0; i<ntasks; i++ ) pip_wait( i, NULL );
+  pip_channel_destroy( ping );
+  pip_channel_destroy( bench.mpmc );
+  pip_channel_destroy( bench.spsc );
+  pip_fin();
+  return 0;
+}
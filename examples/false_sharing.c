@@ -0,0 +1,173 @@
+/*
+ * $PIP_license: <Simplified BSD License>
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *     Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ * 
+ *     Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ * $
+ * $RIKEN_copyright: Riken Center for Computational Sceience (R-CCS),
+ * System Software Development Team, 2016-2022
+ * $
+ * $PIP_VERSION: Version 2.4.1$
+ *
+ * $Author: Atsushi Hori 
+ * Query:   procinproc-info@googlegroups.com
+ * User ML: procinproc-users@googlegroups.com
+ * $
+ */
+
+/* False sharing between the read-mostly and the hot fields of      */
+/* pip_task_t. Each pair of threads works on its own entry of an    */
+/* array laid out as pip_root_t.tasks[]. One thread keeps reading   */
+/* libc_ftabp, which is read in every libc call of a task, and the  */
+/* other keeps updating malloc_free_list as the other tasks do when */
+/* they free blocks of the task. This is compared with the word     */
+/* next to libc_ftabp being updated instead, which is where         */
+/* flag_sigchld and status were before they got their own cache     */
+/* block. The threads of a pair are bound to different CPUs. This   */
+/* does not call pip_init(). Run it under "perf c2c record" to see  */
+/* the HITM counts as well.                                         */
+/*   usage: false_sharing [NPAIRS]                                  */
+
+#include <pip/pip_internal.h>
+#include <stddef.h>
+
+#define DURATION_US	(500000)
+#define NREADS		(1000)
+
+typedef struct pair {
+  char			*entry;
+  size_t		off_read;
+  size_t		off_write;
+  int			cpu;
+  long			count;
+  pthread_t		thread;
+} pair_t;
+
+static volatile int stop;
+static int ncpus;
+
+static void bind_cpu( int cpu ) {
+  cpu_set_t set;
+  CPU_ZERO( &set );
+  CPU_SET( cpu % ncpus, &set );
+  (void) sched_setaffinity( 0, sizeof(set), &set );
+}
+
+static void *reader( void *arg ) {
+  pair_t *p = (pair_t*) arg;
+  void *volatile *word = (void *volatile*) ( p->entry + p->off_read );
+  void *v;
+  int i;
+
+  bind_cpu( p->cpu );
+  while( !stop ) {
+    for( i=0; i<NREADS; i++ ) v = *word;
+    p->count += NREADS;
+  }
+  (void) v;
+  return NULL;
+}
+
+static void *writer( void *arg ) {
+  pair_t *p = (pair_t*) arg;
+  pip_atomic_t *word = (pip_atomic_t*) ( p->entry + p->off_write );
+
+  bind_cpu( p->cpu );
+  while( !stop ) {
+    (void) __sync_fetch_and_add( word, 1 );
+    p->count ++;
+  }
+  return NULL;
+}
+
+static void run( char *what, pip_task_t *tasks, int npairs,
+		 size_t off_read, size_t off_write ) {
+  pair_t *rd, *wr;
+  long nreads = 0, nwrites = 0;
+  int i;
+
+  rd = (pair_t*) calloc( npairs * 2, sizeof(pair_t) );
+  wr = rd + npairs;
+  stop = 0;
+  for( i=0; i<npairs; i++ ) {
+    rd[i].entry = wr[i].entry = (char*) &tasks[i];
+    rd[i].off_read  = off_read;
+    wr[i].off_write = off_write;
+    rd[i].cpu = i * 2;
+    wr[i].cpu = i * 2 + 1;
+    pthread_create( &rd[i].thread, NULL, reader, &rd[i] );
+    pthread_create( &wr[i].thread, NULL, writer, &wr[i] );
+  }
+  usleep( DURATION_US );
+  stop = 1;
+  for( i=0; i<npairs; i++ ) {
+    pthread_join( rd[i].thread, NULL );
+    pthread_join( wr[i].thread, NULL );
+    nreads  += rd[i].count;
+    nwrites += wr[i].count;
+  }
+  printf( "%-32s reads %8.1f M/s  writes %8.1f M/s  (per pair)\n", what,
+	  (double) nreads  / npairs / DURATION_US,
+	  (double) nwrites / npairs / DURATION_US );
+  free( rd );
+}
+
+#define FIELD(T,F)							\
+  printf( "  %-20s offset %5lu  block %3lu\n", #F,			\
+	  (unsigned long) offsetof(T,F),				\
+	  (unsigned long) offsetof(T,F) / PIP_CACHEBLK_SZ )
+
+int main( int argc, char **argv ) {
+  pip_task_t *tasks;
+  size_t off_ftab = offsetof( pip_task_t, libc_ftabp );
+  int npairs;
+
+  ncpus  = sysconf( _SC_NPROCESSORS_ONLN );
+  npairs = ( argc > 1 ) ? atoi( argv[1] ) : ( ncpus > 1 ? ncpus / 2 : 1 );
+
+  printf( "pip_task_t: %lu bytes\n", (unsigned long) sizeof(pip_task_t) );
+  FIELD( pip_task_t, pipid );
+  FIELD( pip_task_t, args );
+  FIELD( pip_task_t, libc_ftabp );
+  FIELD( pip_task_t, malloc_free_list );
+  FIELD( pip_task_t, flag_sigchld );
+  FIELD( pip_task_t, status );
+  printf( "pip_root_t: %lu bytes\n", (unsigned long) sizeof(pip_root_t) );
+  FIELD( pip_root_t, ntasks );
+  FIELD( pip_root_t, lock_tasks );
+  FIELD( pip_root_t, ntasks_curr );
+  FIELD( pip_root_t, lock_clone );
+  FIELD( pip_root_t, libc_lock );
+  FIELD( pip_root_t, lock_bt );
+  FIELD( pip_root_t, lock_stack );
+  FIELD( pip_root_t, tasks );
+
+  if( posix_memalign( (void**) &tasks, PIP_CACHEBLK_SZ,
+		      sizeof(pip_task_t) * npairs ) != 0 ) return 1;
+  memset( tasks, 0, sizeof(pip_task_t) * npairs );
+  printf( "%d CPUs, %d pairs\n", ncpus, npairs );
+  run( "malloc_free_list (own block)", tasks, npairs,
+       off_ftab, offsetof( pip_task_t, malloc_free_list ) );
+  run( "next to libc_ftabp (shared)", tasks, npairs,
+       off_ftab, off_ftab + sizeof(void*) );
+  free( tasks );
+  return 0;
+}
@@ -0,0 +1,117 @@
+/*
+ * $PIP_license: <Simplified BSD License>
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *     Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ * 
+ *     Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ * $
+ * $RIKEN_copyright: Riken Center for Computational Sceience (R-CCS),
+ * System Software Development Team, 2016-2022
+ * $
+ * $PIP_VERSION: Version 2.4.1$
+ *
+ * $Author: Atsushi Hori 
+ * Query:   procinproc-info@googlegroups.com
+ * User ML: procinproc-users@googlegroups.com
+ * $
+ */
+
+/* Fan-in wake-up latency of blocking named imports. All PiP tasks */
+/* block in importing a name from the root, and the root exports   */
+/* it. The time from the export to the wake-up of the last task,   */
+/* and the average, are reported for pip_named_import() and        */
+/* pip_named_timedimport().                                         */
+/*   usage: fanin_bench [NTASKS]                                    */
+
+#include <pip/pip.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define NROUNDS		(100)
+#define SETTLE_US	(10000)	/* for all tasks to block */
+
+struct bench {
+  pip_barrier_t	barrier;
+  int		timed;
+  double	woken[PIP_NTASKS_MAX];
+} bench;
+
+int x;
+
+static void task( struct bench *bp, int pipid ) {
+  struct timespec to = { 10, 0 };
+  void *addr;
+  int r;
+
+  for( r=0; r<NROUNDS*2; r++ ) {
+    pip_barrier_wait( &bp->barrier );
+    if( bp->timed ) {
+      pip_named_timedimport( PIP_PIPID_ROOT, &addr, &to, "round-%d", r );
+    } else {
+      pip_named_import( PIP_PIPID_ROOT, &addr, "round-%d", r );
+    }
+    bp->woken[pipid] = pip_gettime();
+    pip_barrier_wait( &bp->barrier );
+  }
+}
+
+int main( int argc, char **argv ) {
+  void *export = (void*) &bench;
+  double t0, last, sum, sum_last[2], sum_avg[2];
+  int pipid, ntasks, i, r;
+
+  ntasks = ( argc > 1 ) ? atoi( argv[1] ) : 16;
+  pip_init( &pipid, &ntasks, &export, 0 );
+  if( pipid != PIP_PIPID_ROOT ) {
+    task( (struct bench*) export, pipid );
+    pip_fin();
+    return 0;
+  }
+  pip_barrier_init( &bench.barrier, ntasks + 1 );
+  for( i=0; i<ntasks; i++ ) {
+    pipid = i;
+    pip_spawn( argv[0], argv, NULL, PIP_CPUCORE_ASIS, &pipid,
+	       NULL, NULL, NULL );
+  }
+  sum_last[0] = sum_last[1] = sum_avg[0] = sum_avg[1] = 0.0;
+  for( r=0; r<NROUNDS*2; r++ ) {
+    bench.timed = ( r >= NROUNDS );
+    pip_barrier_wait( &bench.barrier );
+    usleep( SETTLE_US );
+    t0 = pip_gettime();
+    pip_named_export( &x, "round-%d", r );
+    pip_barrier_wait( &bench.barrier );
+    last = sum = 0.0;
+    for( i=0; i<ntasks; i++ ) {
+      sum += bench.woken[i] - t0;
+      if( bench.woken[i] - t0 > last ) last = bench.woken[i] - t0;
+    }
+    sum_last[bench.timed] += last;
+    sum_avg[bench.timed]  += sum / ntasks;
+  }
+  for( i=0; i<ntasks; i++ ) pip_wait( i, NULL );
+  printf( "%d tasks, %d rounds\n", ntasks, NROUNDS );
+  printf( "%-24s last %8.1f us  average %8.1f us\n", "pip_named_import",
+	  sum_last[0] / NROUNDS * 1e6, sum_avg[0] / NROUNDS * 1e6 );
+  printf( "%-24s last %8.1f us  average %8.1f us\n", "pip_named_timedimport",
+	  sum_last[1] / NROUNDS * 1e6, sum_avg[1] / NROUNDS * 1e6 );
+  pip_fin();
+  return 0;
+}
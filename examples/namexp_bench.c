@@ -0,0 +1,113 @@
+/*
+ * $PIP_license: <Simplified BSD License>
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *     Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ * 
+ *     Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ * $
+ * $RIKEN_copyright: Riken Center for Computational Sceience (R-CCS),
+ * System Software Development Team, 2016-2022
+ * $
+ * $PIP_VERSION: Version 2.4.1$
+ *
+ * $Author: Atsushi Hori 
+ * Query:   procinproc-info@googlegroups.com
+ * User ML: procinproc-users@googlegroups.com
+ * $
+ */
+
+/* Latency of pip_named_import() and pip_named_import_key() of the */
+/* names already exported, as the number of the names exported by  */
+/* the task grows.                                                  */
+/*   usage: namexp_bench                                            */
+
+#include <pip/pip.h>
+#include <stdlib.h>
+
+#define NEXP_MIN	(16)
+#define NEXP_MAX	(16384)
+#define NITERS		(100000)
+#define STRIDE		(7919)	/* prime, not to import in order */
+
+struct bench {
+  pip_barrier_t	barrier;
+  int		nexp;		/* 0 to terminate */
+} bench;
+
+int objs[NEXP_MAX];
+
+static void task( struct bench *bp ) {
+  int i, n, nexported = 0;
+
+  while( 1 ) {
+    pip_barrier_wait( &bp->barrier );
+    if( ( n = bp->nexp ) == 0 ) break;
+    for( i=nexported; i<n; i++ ) pip_named_export( &objs[i], "obj-%d", i );
+    nexported = n;
+    pip_barrier_wait( &bp->barrier );
+  }
+}
+
+int main( int argc, char **argv ) {
+  pip_named_key_t *keys;
+  void *export = (void*) &bench;
+  void *addr;
+  double t0, t_fmt, t_key;
+  int pipid, ntasks = 1, i, k, n;
+
+  pip_init( &pipid, &ntasks, &export, 0 );
+  if( pipid != PIP_PIPID_ROOT ) {
+    task( (struct bench*) export );
+    pip_fin();
+    return 0;
+  }
+  keys = (pip_named_key_t*) malloc( sizeof(pip_named_key_t) * NEXP_MAX );
+  for( i=0; i<NEXP_MAX; i++ ) pip_named_key( &keys[i], "obj-%d", i );
+
+  pip_barrier_init( &bench.barrier, 2 );
+  pipid = 0;
+  pip_spawn( argv[0], argv, NULL, PIP_CPUCORE_ASIS, &pipid, NULL, NULL, NULL );
+
+  printf( "%8s %16s %16s\n", "#exports", "import [ns]", "import_key [ns]" );
+  for( n=NEXP_MIN; n<=NEXP_MAX; n*=2 ) {
+    bench.nexp = n;
+    pip_barrier_wait( &bench.barrier ); /* the task exports */
+    pip_barrier_wait( &bench.barrier ); /* done */
+
+    t0 = pip_gettime();
+    for( i=0, k=0; i<NITERS; i++, k=(k+STRIDE)%n ) {
+      pip_named_import( 0, &addr, "obj-%d", k );
+    }
+    t_fmt = pip_gettime() - t0;
+    t0 = pip_gettime();
+    for( i=0, k=0; i<NITERS; i++, k=(k+STRIDE)%n ) {
+      pip_named_import_key( 0, &addr, &keys[k] );
+    }
+    t_key = pip_gettime() - t0;
+    printf( "%8d %16.1f %16.1f\n", n,
+	    t_fmt / NITERS * 1e9, t_key / NITERS * 1e9 );
+  }
+  bench.nexp = 0;
+  pip_barrier_wait( &bench.barrier );
+  pip_wait( 0, NULL );
+  free( keys );
+  pip_fin();
+  return 0;
+}
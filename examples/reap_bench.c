@@ -0,0 +1,121 @@
+/*
+ * $PIP_license: <Simplified BSD License>
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *     Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ * 
+ *     Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ * $
+ * $RIKEN_copyright: Riken Center for Computational Sceience (R-CCS),
+ * System Software Development Team, 2016-2022
+ * $
+ * $PIP_VERSION: Version 2.4.1$
+ *
+ * $Author: Atsushi Hori 
+ * Query:   procinproc-info@googlegroups.com
+ * User ML: procinproc-users@googlegroups.com
+ * $
+ */
+
+/* Reaping PiP tasks by pip_wait_any() and pip_trywait_any().      */
+/* First, all tasks terminate at once after a barrier and the root */
+/* reaps them as fast as possible. Then, the tasks terminate one   */
+/* by one at intervals, and the delay from the termination of a    */
+/* task to its reaping is measured.                                */
+/*   usage: reap_bench [NTASKS]                                    */
+
+#include <pip/pip.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define INTERVAL_US	(1000)
+
+struct bench {
+  pip_barrier_t	barrier;
+  int		staggered;
+  double	exited[PIP_NTASKS_MAX];
+} bench;
+
+static void spawn_all( char **argv, int ntasks ) {
+  int i, pipid;
+  for( i=0; i<ntasks; i++ ) {
+    pipid = i;
+    pip_spawn( argv[0], argv, NULL, PIP_CPUCORE_ASIS, &pipid,
+	       NULL, NULL, NULL );
+  }
+}
+
+int main( int argc, char **argv ) {
+  void *export = (void*) &bench;
+  struct bench *bp;
+  double t0, t, delay;
+  long ncalls;
+  int pipid, ntasks, i;
+
+  ntasks = ( argc > 1 ) ? atoi( argv[1] ) : 256;
+  pip_init( &pipid, &ntasks, &export, 0 );
+  if( pipid != PIP_PIPID_ROOT ) {
+    bp = (struct bench*) export;
+    pip_barrier_wait( &bp->barrier );
+    if( bp->staggered ) usleep( INTERVAL_US * ( pipid + 1 ) );
+    bp->exited[pipid] = pip_gettime();
+    pip_fin();
+    return 0;
+  }
+  pip_barrier_init( &bench.barrier, ntasks + 1 );
+
+  /* burst */
+  bench.staggered = 0;
+  spawn_all( argv, ntasks );
+  pip_barrier_wait( &bench.barrier );
+  t0 = pip_gettime();
+  for( i=0; i<ntasks; i++ ) pip_wait_any( &pipid, NULL );
+  t = pip_gettime() - t0;
+  printf( "%d tasks  burst      pip_wait_any    %8.1f tasks/s  "
+	  "%8.2f us/task\n", ntasks, ntasks / t, t / ntasks * 1e6 );
+
+  /* staggered, blocking */
+  bench.staggered = 1;
+  spawn_all( argv, ntasks );
+  pip_barrier_wait( &bench.barrier );
+  delay = 0.0;
+  for( i=0; i<ntasks; i++ ) {
+    pip_wait_any( &pipid, NULL );
+    delay += pip_gettime() - bench.exited[pipid];
+  }
+  printf( "%d tasks  staggered  pip_wait_any    delay %8.2f us\n",
+	  ntasks, delay / ntasks * 1e6 );
+
+  /* staggered, polling */
+  spawn_all( argv, ntasks );
+  pip_barrier_wait( &bench.barrier );
+  delay  = 0.0;
+  ncalls = 0;
+  for( i=0; i<ntasks; ) {
+    ncalls ++;
+    if( pip_trywait_any( &pipid, NULL ) == 0 ) {
+      delay += pip_gettime() - bench.exited[pipid];
+      i ++;
+    }
+  }
+  printf( "%d tasks  staggered  pip_trywait_any delay %8.2f us  "
+	  "%ld calls\n", ntasks, delay / ntasks * 1e6, ncalls );
+  pip_fin();
+  return 0;
+}
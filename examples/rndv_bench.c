@@ -0,0 +1,139 @@
+/*
+ * $PIP_license: <Simplified BSD License>
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *     Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ * 
+ *     Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ * $
+ * $RIKEN_copyright: Riken Center for Computational Sceience (R-CCS),
+ * System Software Development Team, 2016-2022
+ * $
+ * $PIP_VERSION: Version 2.4.1$
+ *
+ * $Author: Atsushi Hori 
+ * Query:   procinproc-info@googlegroups.com
+ * User ML: procinproc-users@googlegroups.com
+ * $
+ */
+
+/* Bandwidth of copying a message from task 0 to the root:        */
+/*  - memcpy() and pip_memcpy_nt() within the root, as references, */
+/*  - double copy through a staging buffer, as over shared memory, */
+/*  - pip_rndv_send() into the buffer posted by pip_rndv_post().   */
+/*   usage: rndv_bench                                             */
+
+#include <pip/pip.h>
+#include <stdlib.h>
+
+#define SZ_MIN		(4UL<<10)
+#define SZ_MAX		(64UL<<20)
+#define NBYTES		(1UL<<30) /* per measurement */
+#define NITERS(S)	(((NBYTES/(S))<10)?10:(NBYTES/(S)))
+
+struct bench {
+  pip_barrier_t	barrier;
+  char		*staging;
+} bench;
+
+static void task( struct bench *bp ) {
+  char *src = (char*) malloc( SZ_MAX );
+  size_t sz, i;
+
+  memset( src, 1, SZ_MAX );
+  pip_barrier_wait( &bp->barrier );
+  for( sz=SZ_MIN; sz<=SZ_MAX; sz*=4 ) {
+    for( i=0; i<NITERS(sz); i++ ) {
+      memcpy( bp->staging, src, sz );
+      pip_barrier_wait( &bp->barrier ); /* staged */
+      pip_barrier_wait( &bp->barrier ); /* copied out */
+    }
+    for( i=0; i<NITERS(sz); i++ ) {
+      pip_rndv_send( PIP_PIPID_ROOT, "msg", src, sz );
+    }
+  }
+  free( src );
+}
+
+static double gbps( size_t sz, size_t n, double t ) {
+  return (double) sz * n / t * 1e-9;
+}
+
+int main( int argc, char **argv ) {
+  void *export = (void*) &bench;
+  pip_rndv_t *rndv;
+  char *src, *dst;
+  double t0, t_cpy, t_nt, t_dbl, t_rndv;
+  size_t sz, i, n;
+  int pipid, ntasks = 1;
+
+  pip_init( &pipid, &ntasks, &export, 0 );
+  if( pipid != PIP_PIPID_ROOT ) {
+    task( (struct bench*) export );
+    pip_fin();
+    return 0;
+  }
+  src = (char*) malloc( SZ_MAX );
+  dst = (char*) malloc( SZ_MAX );
+  bench.staging = (char*) malloc( SZ_MAX );
+  memset( src, 1, SZ_MAX );
+  memset( dst, 0, SZ_MAX );
+  memset( bench.staging, 0, SZ_MAX );
+  pip_barrier_init( &bench.barrier, 2 );
+  pipid = 0;
+  pip_spawn( argv[0], argv, NULL, PIP_CPUCORE_ASIS, &pipid, NULL, NULL, NULL );
+
+  printf( "%10s %10s %10s %10s %10s  [GB/s]\n",
+	  "size", "memcpy", "memcpy_nt", "double", "rndv" );
+  pip_barrier_wait( &bench.barrier );
+  for( sz=SZ_MIN; sz<=SZ_MAX; sz*=4 ) {
+    n = NITERS(sz);
+    t0 = pip_gettime();
+    for( i=0; i<n; i++ ) memcpy( dst, src, sz );
+    t_cpy = pip_gettime() - t0;
+    t0 = pip_gettime();
+    for( i=0; i<n; i++ ) pip_memcpy_nt( dst, src, sz );
+    t_nt = pip_gettime() - t0;
+
+    t0 = pip_gettime();
+    for( i=0; i<n; i++ ) {
+      pip_barrier_wait( &bench.barrier );
+      memcpy( dst, bench.staging, sz );
+      pip_barrier_wait( &bench.barrier );
+    }
+    t_dbl = pip_gettime() - t0;
+
+    t0 = pip_gettime();
+    for( i=0; i<n; i++ ) {
+      pip_rndv_post( &rndv, dst, sz, "msg" );
+      pip_rndv_wait( rndv, NULL );
+    }
+    t_rndv = pip_gettime() - t0;
+
+    printf( "%10lu %10.2f %10.2f %10.2f %10.2f\n", sz,
+	    gbps( sz, n, t_cpy ), gbps( sz, n, t_nt ),
+	    gbps( sz, n, t_dbl ), gbps( sz, n, t_rndv ) );
+  }
+  pip_wait( 0, NULL );
+  free( bench.staging );
+  free( dst );
+  free( src );
+  pip_fin();
+  return 0;
+}
@@ -0,0 +1,118 @@
+/*
+ * $PIP_license: <Simplified BSD License>
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *     Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ * 
+ *     Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ * $
+ * $RIKEN_copyright: Riken Center for Computational Sceience (R-CCS),
+ * System Software Development Team, 2016-2022
+ * $
+ * $PIP_VERSION: Version 2.4.1$
+ *
+ * $Author: Atsushi Hori 
+ * Query:   procinproc-info@googlegroups.com
+ * User ML: procinproc-users@googlegroups.com
+ * $
+ */
+
+/* Scaling of the task table, e.g., up to PIP_NTASKS_MAX tasks.    */
+/* NTASKS-1 tasks are spawned and kept alive, and then a task is    */
+/* spawned and reaped repeatedly in the last free slot. The cost of */
+/* spawning should not depend on the number of live tasks.          */
+/*   usage: scale_bench [NTASKS]                                    */
+
+#include <pip/pip.h>
+#include <stdlib.h>
+
+#define NSAMPLES	(64)
+#define NCHURNS		(1000)
+
+struct bench {
+  pip_barrier_t	barrier;
+} bench;
+
+static int spawn( char **argv ) {
+  pip_spawn_program_t prog;
+  int pipid = PIP_PIPID_ANY, err;
+
+  pip_spawn_from_main( &prog, argv[0], argv, NULL, NULL );
+  err = pip_task_spawn( &prog, PIP_CPUCORE_ASIS, 0, &pipid, NULL );
+  if( err ) {
+    fprintf( stderr, "pip_task_spawn(): %s\n", strerror( err ) );
+    exit( 1 );
+  }
+  return pipid;
+}
+
+int main( int argc, char **argv ) {
+  char *churn_argv[] = { argv[0], "1", "churn", NULL };
+  void *export = (void*) &bench;
+  double t0, t_init, t_first, t_last, t_churn, t_reap;
+  int pipid, ntasks, nlive, i;
+
+  ntasks = ( argc > 1 ) ? atoi( argv[1] ) : 1024;
+  t0 = pip_gettime();
+  pip_init( &pipid, &ntasks, &export, 0 );
+  t_init = pip_gettime() - t0;
+  if( pipid != PIP_PIPID_ROOT ) {
+    if( argc < 3 ) {		/* stay alive until all are spawned */
+      pip_barrier_wait( &((struct bench*)export)->barrier );
+    }
+    pip_fin();
+    return 0;
+  }
+  nlive = ntasks - 1;
+  if( nlive < NSAMPLES * 2 ) {
+    fprintf( stderr, "NTASKS must be %d or more\n", NSAMPLES * 2 + 1 );
+    return 1;
+  }
+  pip_barrier_init( &bench.barrier, nlive + 1 );
+
+  t0 = pip_gettime();
+  for( i=0; i<NSAMPLES; i++ ) spawn( argv );
+  t_first = pip_gettime() - t0;
+  for( ; i<nlive-NSAMPLES; i++ ) spawn( argv );
+  t0 = pip_gettime();
+  for( ; i<nlive; i++ ) spawn( argv );
+  t_last = pip_gettime() - t0;
+
+  t0 = pip_gettime();
+  for( i=0; i<NCHURNS; i++ ) pip_wait( spawn( churn_argv ), NULL );
+  t_churn = pip_gettime() - t0;
+
+  pip_barrier_wait( &bench.barrier );
+  t0 = pip_gettime();
+  for( i=0; i<nlive; i++ ) pip_wait_any( &pipid, NULL );
+  t_reap = pip_gettime() - t0;
+
+  printf( "%d tasks\n", ntasks );
+  printf( "pip_init                 %10.2f ms\n", t_init * 1e3 );
+  printf( "spawn, first %d tasks    %10.2f us/task\n", NSAMPLES,
+	  t_first / NSAMPLES * 1e6 );
+  printf( "spawn, last %d tasks     %10.2f us/task\n", NSAMPLES,
+	  t_last / NSAMPLES * 1e6 );
+  printf( "spawn+wait, table full   %10.2f us/task\n",
+	  t_churn / NCHURNS * 1e6 );
+  printf( "reap all                 %10.2f us/task\n",
+	  t_reap / nlive * 1e6 );
+  pip_fin();
+  return 0;
+}
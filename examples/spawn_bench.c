@@ -0,0 +1,115 @@
+/*
+ * $PIP_license: <Simplified BSD License>
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *     Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ * 
+ *     Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ * $
+ * $RIKEN_copyright: Riken Center for Computational Sceience (R-CCS),
+ * System Software Development Team, 2016-2022
+ * $
+ * $PIP_VERSION: Version 2.4.1$
+ *
+ * $Author: Atsushi Hori 
+ * Query:   procinproc-info@googlegroups.com
+ * User ML: procinproc-users@googlegroups.com
+ * $
+ */
+
+/* Spawning rate of PiP tasks. The tasks are spawned one by one  */
+/* by pip_task_spawn() as bin/pip-exec.c does, and then at once  */
+/* by pip_task_spawn_n(), optionally after loading the name      */
+/* spaces in advance by pip_task_spawn_prepare().                */
+/*   usage: spawn_bench [NTASKS]                                  */
+
+#include <pip/pip.h>
+#include <stdlib.h>
+
+static void report( char *what, int ntasks, double spawn, double total ) {
+  printf( "%-24s %4d tasks  spawn %8.3f ms (%8.1f tasks/s)  "
+	  "spawn+wait %8.3f ms\n",
+	  what, ntasks, spawn * 1e3, (double) ntasks / spawn, total * 1e3 );
+}
+
+static void wait_all( int ntasks ) {
+  int i, pipid;
+  for( i=0; i<ntasks; i++ ) pip_wait_any( &pipid, NULL );
+}
+
+int main( int argc, char **argv ) {
+  pip_spawn_program_t prog;
+  double t0, t1, t2;
+  int pipid, ntasks, i, err;
+
+  ntasks = ( argc > 1 ) ? atoi( argv[1] ) : 64;
+  if( ( err = pip_init( &pipid, &ntasks, NULL, 0 ) ) != 0 ) {
+    fprintf( stderr, "pip_init(): %s\n", strerror( err ) );
+    return 1;
+  }
+  if( pipid != PIP_PIPID_ROOT ) {
+    /* PiP task, nothing to do */
+    pip_fin();
+    return 0;
+  }
+  pip_spawn_from_main( &prog, argv[0], argv, NULL, NULL );
+
+  /* one by one */
+  t0 = pip_gettime();
+  for( i=0; i<ntasks; i++ ) {
+    pipid = PIP_PIPID_ANY;
+    err = pip_task_spawn( &prog, PIP_CPUCORE_ASIS, 0, &pipid, NULL );
+    if( err ) {
+      fprintf( stderr, "pip_task_spawn(): %s\n", strerror( err ) );
+      return 1;
+    }
+  }
+  t1 = pip_gettime();
+  wait_all( ntasks );
+  t2 = pip_gettime();
+  report( "pip_task_spawn loop", ntasks, t1 - t0, t2 - t0 );
+
+  /* at once */
+  t0 = pip_gettime();
+  err = pip_task_spawn_n( &prog, ntasks, PIP_CPUCORE_ASIS, 0, NULL, NULL );
+  if( err ) {
+    fprintf( stderr, "pip_task_spawn_n(): %s\n", strerror( err ) );
+    return 1;
+  }
+  t1 = pip_gettime();
+  wait_all( ntasks );
+  t2 = pip_gettime();
+  report( "pip_task_spawn_n", ntasks, t1 - t0, t2 - t0 );
+
+  /* at once, name spaces loaded in advance (not timed) */
+  if( pip_task_spawn_prepare( &prog, ntasks ) == 0 ) {
+    t0 = pip_gettime();
+    err = pip_task_spawn_n( &prog, ntasks, PIP_CPUCORE_ASIS, 0, NULL, NULL );
+    if( err ) {
+      fprintf( stderr, "pip_task_spawn_n(): %s\n", strerror( err ) );
+      return 1;
+    }
+    t1 = pip_gettime();
+    wait_all( ntasks );
+    t2 = pip_gettime();
+    report( "prepared+pip_task_spawn_n", ntasks, t1 - t0, t2 - t0 );
+  }
+  pip_fin();
+  return 0;
+}
@@ -43,6 +43,7 @@
 #include <stddef.h>
 #include <string.h>
 #include <signal.h>
+#include <time.h>
 #include <stdio.h>
 #include <errno.h>
 
@@ -86,6 +87,12 @@
 
 #define PIP_ENV_STACKSZ			"PIP_STACKSIZE"
 
+#define PIP_ENV_HUGEPAGE		"PIP_HUGEPAGE"
+#define PIP_ENV_HUGEPAGE_THP		"thp"
+#define PIP_ENV_HUGEPAGE_HUGETLB	"hugetlb"
+#define PIP_ENV_NUMA			"PIP_NUMA"
+#define PIP_ENV_STACK_POOL		"PIP_STACK_POOL"
+
 #define PIP_STACK_SIZE			(16*1024*1024LU) /* 8 MiB */
 #define PIP_STACK_SIZE_MIN		(4*1024*1024LU) /* 1 MiB */
 #define PIP_STACK_SIZE_MAX		(1014*1024*1024*1024LU) /* 1 TiB */
@@ -98,7 +105,8 @@
 #define PIP_PIPID_NULL			(PIP_MAGIC_NUM-4)
 #define PIP_PIPID_SELF			PIP_PIPID_MYSELF
 
-#define PIP_NTASKS_MAX			(300)
+#define PIP_NTASKS_MAX			(4096)
+#define PIP_NTASKS_DEFAULT		(300)
 
 #define PIP_CPUCORE_FLAG_SHIFT		(24)
 #define PIP_CPUCORE_FLAG_MASK		(0xFFU<<PIP_CPUCORE_FLAG_SHIFT)
@@ -135,13 +143,82 @@ typedef struct {
 
 typedef uintptr_t	pip_id_t;
 
+/* synchronization objects on futex words, see pip_sync.c */
 typedef struct pip_barrier {
   int			count_init;
   volatile uint32_t	count;
-  volatile int		gsense;
-  sem_t			semaphore[2];
+  volatile uint32_t	generation;
 } pip_barrier_t;
 
+typedef struct pip_tree_barrier	pip_tree_barrier_t;
+
+typedef struct pip_mutex {
+  volatile uint32_t	word;	/* 0:unlocked 1:locked 2:contended */
+} pip_mutex_t;
+
+typedef struct pip_cond {
+  volatile uint32_t	seq;
+} pip_cond_t;
+
+typedef struct pip_semaphore {
+  volatile uint32_t	count;
+  volatile uint32_t	nwaiters;
+} pip_semaphore_t;
+
+typedef struct pip_rwlock {
+  volatile uint32_t	state;	/* number of readers or WRITER */
+  volatile uint32_t	seq;
+  volatile uint32_t	nwaiters;
+  volatile uint32_t	nwriters; /* waiting writers */
+} pip_rwlock_t;
+
+#define PIP_NAMED_KEY_MAX		(128)
+typedef struct pip_named_key {
+  uint64_t	hash;
+  size_t	len;
+  char		name[PIP_NAMED_KEY_MAX];
+} pip_named_key_t;
+
+typedef struct pip_named_sub {
+  void		*entry;
+  uint64_t	version;
+  void		*address;
+} pip_named_sub_t;
+
+typedef struct pip_shmpool	pip_shmpool_t;
+
+typedef struct pip_task_pool	pip_task_pool_t;
+typedef int(*pip_task_pool_func_t)(void*);
+#define PIP_TASK_POOL_FUNCNAME_MAX	(128)
+
+typedef struct pip_coll		pip_coll_t;
+/* data types of pip_coll_reduce and pip_coll_allreduce */
+#define PIP_COLL_INT32			(0)
+#define PIP_COLL_INT64			(1)
+#define PIP_COLL_FLOAT			(2)
+#define PIP_COLL_DOUBLE			(3)
+#define PIP_COLL_NTYPES			(4)
+/* reduction operations */
+#define PIP_COLL_SUM			(0)
+#define PIP_COLL_PROD			(1)
+#define PIP_COLL_MIN			(2)
+#define PIP_COLL_MAX			(3)
+#define PIP_COLL_NOPS			(4)
+
+typedef struct pip_channel		pip_channel_t;
+/* flags of pip_channel_create */
+#define PIP_CHANNEL_SPSC		(0x0)
+#define PIP_CHANNEL_MPMC		(0x1)
+#define PIP_CHANNEL_BLOCK		(0x2)
+
+typedef struct pip_rndv			pip_rndv_t;
+
+/* an event posted by pip_post_event() */
+typedef struct pip_event {
+  int			pipid;
+  uint64_t		value;
+} pip_event_t;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -176,8 +253,9 @@ extern "C" {
    *  process, then this returns \c PIP_PIPID_ROOT, otherwise it returns
    *  the PiP ID of the calling PiP task.
    * \param[in,out] ntasksp When called by the PiP root, it specifies
-   *  the maximum number of PiP tasks. When called by a PiP task, then
-   *  the number specified by the PiP root is returned.
+   *  the maximum number of PiP tasks, up to \c PIP_NTASKS_MAX. If this
+   *  is \c NULL, then \c PIP_NTASKS_DEFAULT is assumed. When called by
+   *  a PiP task, then the number specified by the PiP root is returned.
    * \param[in,out] root_expp If the root PiP is ready to export a
    *  memory region to any PiP task(s), then this parameter is to pass
    *  the exporting address. If
@@ -221,6 +299,19 @@ extern "C" {
    * effective. The 'T',  
    * 'G', 'M', 'K' and 'B' posfix character can be used, as
    * abbreviations of Tera, Giga, Mega, Kilo and Byte, respectively.
+   * \arg \b PIP_HUGEPAGE If the value is 'thp', then the PiP root
+   * tables, PiP task stacks and the memory regions of \c pip_malloc
+   * are advised to be backed by transparent huge pages. If the value
+   * is 'hugetlb', then task stacks are allocated from the huge page
+   * pool first.
+   * \arg \b PIP_NUMA If the value is 'on', then the stack and the
+   * \c pip_malloc region of a PiP task are placed on the NUMA node
+   * where the task is bound, and the PiP root tables are interleaved
+   * over the NUMA nodes.
+   * \arg \b PIP_STACK_POOL Specifying the number of task stacks
+   * allocated and pre-faulted by \c pip_init. The stack of a
+   * terminated PiP task is returned to this pool by \c pip_wait and
+   * its variants, and reused by the next task.
    * \arg \b PIP_STOP_ON_START Specifying the PIP ID to stop on start
    * to debug the specified PiP task from the beginning. If the
    * before hook is specified, then the PiP task will be stopped just
@@ -522,6 +613,104 @@ void pip_spawn_hook( pip_spawn_hook_t *hook,
 		      pip_spawn_hook_t *hookp );
   /** @} */
 
+  /**
+   * \defgroup pip_task_spawn_n pip_task_spawn_n
+   * @{ */
+  /**
+   * \description
+   * This function spawns \c ntasks PiP tasks running the same program
+   * specified by \c progp. The program is looked up and checked only
+   * once, and all the PiP task structures are prepared before any of
+   * them is loaded. The PiP root does not wait for each PiP task to
+   * start up before loading the next one, so that loading and
+   * starting PiP tasks overlap.
+   *
+   * \param[in] progp Pointer to the \p pip_spawn_program_t
+   *  structure in which the program invocation information is set
+   * \param[in] ntasks Number of PiP tasks to spawn
+   * \param[in] coreno CPU core number for the first PiP task to be
+   *  bound to. The i-th PiP task is bound to \c coreno + i. The
+   *  \p PIP_CPUCORE_ABS and \p PIP_CPUCORE_ASIS flags are applied to
+   *  all PiP tasks as in \p pip_task_spawn.
+   * \param[in] opts option flags
+   * \param[in,out] pipids Array of \c ntasks PiP IDs. Each element
+   *  specifies the PiP ID of the i-th PiP task or \p PIP_PIPID_ANY,
+   *  and the assigned PiP ID is returned. On error, the elements of
+   *  the PiP tasks not spawned are set to \p PIP_PIPID_NULL. If this
+   *  is \c NULL, then all PiP IDs are up to the PiP library.
+   * \param[in] hookp Hook information to be invoked before and after
+   *  the program invokation.
+   *
+   * \return Zero is returned if all PiP tasks are spawned. On error,
+   * an error number is returned.
+   * \retval EPERM PiP library is not yet initialized, or PiP task
+   * tries to spawn child tasks
+   * \retval EINVAL \c progp is \c NULL, \c ntasks is not positive
+   * or larger than the maximum number of PiP tasks, or any of \c pipids
+   * or \c coreno is invalid
+   * \retval EAGAIN not enough free PiP IDs, or specified PiP ID is
+   * already occupied. No PiP task is spawned in this case.
+   * \retval ENOMEM not enough memory
+   * \retval ENOEXEC \c dlmopen fails. The PiP tasks spawned before the
+   * failure keep running.
+   *
+   * \sa pip_task_spawn
+   * \sa pip_spawn_from_main
+   * \sa pip_spawn_from_func
+   * \sa pip_spawn_hook
+   */
+  int pip_task_spawn_n( pip_spawn_program_t *progp,
+			int ntasks,
+			uint32_t coreno,
+			uint32_t opts,
+			int *pipids,
+			pip_spawn_hook_t *hookp );
+  /** @} */
+
+  /**
+   * \defgroup pip_task_spawn_prepare pip_task_spawn_prepare
+   * @{ */
+  /**
+   * \description
+   * This function loads the program specified by \c progp into \c n
+   * new name spaces in advance, without creating any PiP task. The
+   * loaded name spaces are kept by the PiP root and a following
+   * \p pip_task_spawn or \p pip_task_spawn_n of the same program,
+   * the same start function and the same environment variables
+   * takes one of them, so that only the PiP task creation takes
+   * place at spawning. This moves the cost of loading and relocating
+   * the program and its dependencies out of the spawn, for example,
+   * before a timing critical phase.
+   *
+   * \param[in] progp Pointer to the \p pip_spawn_program_t
+   *  structure in which the program invocation information is set.
+   *  The argument vector is not used here, it is taken from the
+   *  spawn call.
+   * \param[in] n Number of name spaces to load
+   *
+   * \return Zero is returned if all name spaces are loaded. On
+   * error, an error number is returned. The name spaces already
+   * loaded by this call are not rolled back, they are kept and
+   * taken by the following spawns or unloaded by \p pip_fin, as
+   * if this function had been called with the smaller \c n.
+   * \retval EPERM PiP library is not yet initialized, or PiP task
+   * calls this function
+   * \retval EINVAL \c progp is \c NULL or \c n is not positive
+   * \retval ENOMEM not enough memory
+   * \retval ENOEXEC \c dlmopen fails, for example, the number of name
+   * spaces exceeds the limit of the glibc
+   *
+   * \note
+   * The constructors of the program run when the name space is
+   * loaded, not when the PiP task is spawned. The name spaces not
+   * taken by any spawn are unloaded by \p pip_fin.
+   *
+   * \sa pip_task_spawn
+   * \sa pip_task_spawn_n
+   */
+  int pip_task_spawn_prepare( pip_spawn_program_t *progp, int n );
+  /** @} */
+
   /**
    * \defgroup pip_spawn pip_spawn.
    * @{ */
@@ -709,678 +898,2524 @@ void pip_spawn_hook( pip_spawn_hook_t *hook,
   /** @} */
 
   /**
-   * \defgroup pip_export pip_export
+   * \defgroup pip_named_timedimport pip_named_timedimport
    * @{ */
   /**
    * \description
-   * Pass an address of a memory region to the other PiP task. This is
-   * a very naive implementation in PiP v1 and deprecated. Once a task
-   * export an address, there is no way to change the exported address
-   * or undo export. You cannot export \b NULL.
-   *
-   * \param[in] exp An addresss
+   * Import an address exported by the specified PiP task and having
+   * the specified name. If it is not exported yet, the calling task
+   * will be blocked at most for the time specified by \p timeout.
    *
-   * \return Return 0 on success. Return an error code on error.
-   * \retval EPERM PiP library is not initialized yet
-   * \retval EINVAL tried to export \b NULL
+   * \param[in] pipid The PiP ID to import the exposed address
+   * \param[out] expp The starting address of the exposed region of
+   *  the PiP task specified by the \a pipid.
+   * \param[in] timeout relative time to wait
+   * \param[in] format a \c printf format to give the exported address a name
    *
-   * \note 
-   * This function was introduced from the first PiP version and is
-   * deprecated.
+   * \return Zero is returned if this function succeeds. On error, an
+   * error number is returned.
+   * \retval EPERM \p pip_init is not yet called.
+   * \retval EINVAL The specified \p pipid is invalid, or \p timeout
+   * is \p NULL
+   * \retval ENOMEM Not enough memory
+   * \retval ECANCELED The target task is terminated
+   * \retval EDEADLK \p pipid is the calling task and tries to block
+   * itself
+   * \retval ETIMEDOUT The address is not exported within the
+   * \p timeout
    *
    * \sa pip_named_export
    * \sa pip_named_import
    * \sa pip_named_tryimport
-   * \sa pip_import
-   *
-   * \author Atsushi Hori
    */
-  int pip_export( void *exp );
+  int pip_named_timedimport( int pipid,
+			     void **expp,
+			     const struct timespec *timeout,
+			     const char *format, ... )
+    __attribute__ ((format (printf, 4, 5)));
   /** @} */
 
   /**
-   * \defgroup pip_import pip_import
+   * \defgroup pip_named_key pip_named_key
    * @{ */
   /**
    * \description
-   * Get an address exported by the specified PiP task. This is
-   * a very naive implementation in PiP v1 and deprecated. If the
-   * address is not yet exported at the time of calling this function,
-   * then \p NULL is returned.
+   * Format a name and compute its hash value in advance. The key can
+   * be passed to \ref pip_named_export_key, \ref pip_named_import_key
+   * and \ref pip_named_tryimport_key as many times as needed, and
+   * then the name is neither formatted nor hashed again.
    *
-   * \param[in] pipid The PiP ID to import the exported address
-   * \param[out] expp The exported address
+   * \param[out] key the key to be set
+   * \param[in] format a \c printf format to give the exported address
+   * a name. If this is \p NULL, then the name is assumed to be "".
    *
    * \return Return 0 on success. Return an error code on error.
-   * \retval EPERM PiP library is not initialized yet
-   *
-   * \sa pip_export
-   * \sa pip_named_export
-   * \sa pip_named_import
-   * \sa pip_named_tryimport
+   * \retval EINVAL \p key is \p NULL
+   * \retval ENAMETOOLONG The name is longer than
+   * \p PIP_NAMED_KEY_MAX - 1
    *
-   * \note 
-   * This function was introduced from the first PiP version and is
-   * deprecated.
+   * \note
+   * The name formatted by \ref pip_named_export and its friends is
+   * the same as the name of the key, if the same format and arguments
+   * are given.
    *
-   * \author Atsushi Hori
+   * \sa pip_named_export_key
+   * \sa pip_named_import_key
+   * \sa pip_named_tryimport_key
    */
-  int pip_import( int pipid, void **expp );
+  int pip_named_key( pip_named_key_t *key, const char *format, ... )
+    __attribute__ ((format (printf, 2, 3)));
   /** @} */
 
   /**
-   * \defgroup pip_set_aux pip_set_aux
+   * \defgroup pip_named_export_key pip_named_export_key
    * @{ */
   /**
    * \description
-   * associate arbitrary data with a PiP task
+   * Same as \ref pip_named_export but the name is given by a key set
+   * by \ref pip_named_key.
    *
-   * \param[in] aux Pointer to the user dats to assocate with the calling PiP task
+   * \param[in] exp an address to be passed to the other PiP task
+   * \param[in] key the name key
    *
    * \return Return 0 on success. Return an error code on error.
-   * \retval EPERM PiP library is not yet initialized or already
-   * finalized
-   *
-   * \sa pip_get_aux
+   * \retval EPERM \p pip_init is not yet called.
+   * \retval EINVAL \p key is \p NULL
+   * \retval EBUSY The name is already registered.
+   * \retval ENOMEM Not enough memory
    *
-   * \author Atsushi Hori
+   * \sa pip_named_key
+   * \sa pip_named_export
    */
-  int pip_set_aux( void *aux );
+  int pip_named_export_key( void *exp, const pip_named_key_t *key );
   /** @} */
 
   /**
-   * \defgroup pip_get_aux pip_get_aux
+   * \defgroup pip_named_import_key pip_named_import_key
    * @{ */
   /**
    * \description
-   * obtain the data which was associated by \a pip_set_aus().
-   *
-   * \param[out] auxp Returned user data
+   * Same as \ref pip_named_import but the name is given by a key set
+   * by \ref pip_named_key. If the address is already exported, this
+   * function allocates no memory.
    *
-   * \return Return 0 on success. Return an error code on error.
-   * \retval EPERM PiP library is not yet initialized or already
-   * finalized
+   * \param[in] pipid The PiP ID to import the exposed address
+   * \param[out] expp The exported address
+   * \param[in] key the name key
    *
-   * \sa pip_set_aux
+   * \return zero is returned if this function succeeds. On error, an
+   * error number is returned.
+   * \retval EPERM \p pip_init is not yet called.
+   * \retval EINVAL The specified \p pipid is invalid, or \p key is
+   * \p NULL
+   * \retval ENOMEM Not enough memory
+   * \retval ECANCELED The target task is terminated
+   * \retval EDEADLK \p pipid is the calling task and tries to block
+   * itself
    *
-   * \author Atsushi Hori
+   * \sa pip_named_key
+   * \sa pip_named_import
    */
-  int pip_get_aux( void **auxp );
-  /** @} */
+  int pip_named_import_key( int pipid,
+			    void **expp,
+			    const pip_named_key_t *key );
   /** @} */
 
   /**
-   * \defgroup PiP-API3-wait API: Waiting for PiP task termination
-   * @{
-   */
-
-  /**
-   * \defgroup pip_wait pip_wait
+   * \defgroup pip_named_tryimport_key pip_named_tryimport_key
    * @{ */
   /**
    * \description
-   * This function can be used regardless to the PiP execution mode.
-   * This function blocks until the specified PiP task terminates.
-   * The macros such as \p WIFEXITED and so on defined in Glibc can be 
-   * applied to the returned \p status value.
-   *
-   * \param[in] pipid PiP ID to wait for.
-   * \param[out] status Status value of the terminated PiP task
+   * Same as \ref pip_named_tryimport but the name is given by a key
+   * set by \ref pip_named_key. This function allocates no memory.
    *
-   * \return Return 0 on success. Return an error code on error.
-   * \retval EPERM PiP library is not initialized yet, or This
-   * function is called other than PiP root.
-   * \retval EDEADLK The specified \c pipid is the one of PiP root
-   * \retval ECHILD The target PiP task does not exist or it was already
-   * terminated and waited for
+   * \param[in] pipid The PiP ID to import the exposed address
+   * \param[out] expp The exported address
+   * \param[in] key the name key
    *
-   * \sa pip_exit
-   * \sa pip_trywait
-   * \sa pip_wait_any
-   * \sa pip_trywait_any
-   * \sa wait(Linux 3)
+   * \return Zero is returned if this function succeeds. On error, an
+   * error number is returned.
+   * \retval EPERM \p pip_init is not yet called.
+   * \retval EINVAL The specified \p pipid is invalid, or \p key is
+   * \p NULL
+   * \retval ECANCELED The target task is terminated
+   * \retval EAGAIN Target is not exported yet
    *
-   * \author Atsushi Hori
+   * \sa pip_named_key
+   * \sa pip_named_tryimport
    */
-  int pip_wait( int pipid, int *status );
+  int pip_named_tryimport_key( int pipid,
+			       void **expp,
+			       const pip_named_key_t *key );
   /** @} */
 
   /**
-   * \defgroup pip_trywait pip_trywait
+   * \defgroup pip_named_timedimport_key pip_named_timedimport_key
    * @{ */
   /**
    * \description
-   * This function can be used regardless to the PiP execution mode.
-   * This function behaves like the \p wait function of glibc and the
-   * macros such as \p WIFEXITED and so on can be applied to the
-   * returned \p status value.
-   *
-   * \param[in] pipid PiP ID to wait for.
-   * \param[out] status Status value of the terminated PiP task
-   *
-   * \note This function can be used regardless to the PiP execution
-   * mode.
+   * Same as \ref pip_named_timedimport but the name is given by a key
+   * set by \ref pip_named_key.
    *
-   * \return Return 0 on success. Return an error code on error.
-   * \retval EPERM The PiP library is not initialized yet, or this
-   * function is called other than PiP root 
-   * \retval EDEADLK The specified \c pipid is the one of PiP root
-   * \retval ECHILD The target PiP task does not exist or it was already
-   * terminated and waited for
+   * \param[in] pipid The PiP ID to import the exposed address
+   * \param[out] expp The exported address
+   * \param[in] timeout relative time to wait
+   * \param[in] key the name key
    *
-   * \sa pip_exit
-   * \sa pip_wait
-   * \sa pip_wait_any
-   * \sa pip_trywait_any
-   * \sa wait(Linux 2)
+   * \return Zero is returned if this function succeeds. On error, an
+   * error number is returned.
+   * \retval EPERM \p pip_init is not yet called.
+   * \retval EINVAL The specified \p pipid is invalid, or \p timeout or
+   * \p key is \p NULL
+   * \retval ENOMEM Not enough memory
+   * \retval ECANCELED The target task is terminated
+   * \retval EDEADLK \p pipid is the calling task and tries to block
+   * itself
+   * \retval ETIMEDOUT The address is not exported within the
+   * \p timeout
    *
-   * \author Atsushi Hori
+   * \sa pip_named_key
+   * \sa pip_named_timedimport
    */
-  int pip_trywait( int pipid, int *status );
+  int pip_named_timedimport_key( int pipid,
+				 void **expp,
+				 const struct timespec *timeout,
+				 const pip_named_key_t *key );
   /** @} */
 
   /**
-   * \defgroup pip_wait_any pip_wait_any
+   * \defgroup pip_named_export_keys pip_named_export_keys
    * @{ */
   /**
    * \description
-   * This function can be used regardless to the PiP execution mode.
-   * This function blocks until any of PiP tasks terminates.
-   * The macros such as \p WIFEXITED and so on defined in Glibc can be
-   * applied to the returned \p status value.
+   * Export \p n addresses with the names given by \p keys at once.
+   * The export table of the calling task is locked only once, and
+   * the tasks waiting for any of the names are resumed after all
+   * names are exported. Either all or none of the names are exported.
    *
-   * \param[out] pipid PiP ID of terminated PiP task.
-   * \param[out] status Exit statusof the terminated PiP task
+   * \param[in] n number of the addresses
+   * \param[in] exps array of the addresses to export
+   * \param[in] keys array of the name keys set by \ref pip_named_key
    *
    * \return Return 0 on success. Return an error code on error.
-   * \retval EPERM The PiP library is not initialized yet, or the
-   * function is called other than PiP root 
-   * \retval ECHILD The target PiP task does not exist or it was already
-   * terminated and waited for
-   *
-   * \sa pip_exit
-   * \sa pip_wait
-   * \sa pip_trywait
-   * \sa pip_trywait_any
-   * \sa wait(Linux 2)
+   * \retval EPERM \p pip_init is not yet called.
+   * \retval EINVAL \p exps or \p keys is \p NULL, or \p n is negative
+   * \retval EBUSY One of the names is already registered, or the same
+   * name appears twice in \p keys
+   * \retval ENOMEM Not enough memory
    *
-   * \author Atsushi Hori
+   * \sa pip_named_key
+   * \sa pip_named_export_key
+   * \sa pip_named_import_all
    */
-  int pip_wait_any( int *pipid, int *status );
+  int pip_named_export_keys( int n, void **exps, const pip_named_key_t *keys );
   /** @} */
 
   /**
-   * \defgroup pip_trywait_any pip_trywait_any
+   * \defgroup pip_named_import_all pip_named_import_all
    * @{ */
   /**
    * \description
-   * This function can be used regardless to the PiP execution mode.
-   * This function blocks until any of PiP tasks terminates.
-   * The macros such as \p WIFEXITED and so on defined in Glibc can be
-   * applied to the returned \p status value.
-   *
-   * \param[out] pipid PiP ID of terminated PiP task.
-   * \param[out] status Exit status of the terminated PiP task
-   *
-   * \return Return 0 on success. Return an error code on error.
-   * \retval EPERM The PiP library is not initialized yet, or the
-   * function is called other than PiP root 
-   * \retval ECHILD There is no PiP task to wait for
+   * Import the addresses exported with the same name by \p n PiP
+   * tasks. The addresses already exported are imported without
+   * locking. For the rest, the calling task is registered to all of
+   * them first and then blocked until all of them are exported. This
+   * is useful when every task exports its buffer and imports the
+   * buffers of all the other tasks.
+   *
+   * \param[in] key the name key set by \ref pip_named_key
+   * \param[in] n number of the PiP tasks
+   * \param[in] pipids array of the PiP IDs to import from. If this
+   * is \p NULL, the addresses are imported from the PiP tasks whose
+   * PiP IDs are 0 to \p n - 1.
+   * \param[out] exps array of \p n imported addresses
    *
-   * \sa pip_exit
-   * \sa pip_wait
-   * \sa pip_trywait
-   * \sa pip_wait_any
-   * \sa wait(Linux 2)
+   * \return zero is returned if this function succeeds. On error, an
+   * error number is returned.
+   * \retval EPERM \p pip_init is not yet called.
+   * \retval EINVAL \p key or \p exps is \p NULL, or \p n is invalid
+   * \retval ERANGE One of the PiP IDs is out of range
+   * \retval ENOMEM Not enough memory
+   * \retval ECANCELED One of the target tasks is terminated
+   * \retval EDEADLK The calling task is one of the targets and the
+   * name is not yet exported by the calling task
    *
-   * \author Atsushi Hori
+   * \sa pip_named_key
+   * \sa pip_named_import_key
+   * \sa pip_named_export_keys
    */
-  int pip_trywait_any( int *pipid, int *status );
+  int pip_named_import_all( const pip_named_key_t *key,
+			    int n,
+			    const int *pipids,
+			    void **exps );
   /** @} */
-  /** @} */
-
-  /**
-   * \defgroup PiP-API4-query API: Query Functions
-   * @{
-   */
 
   /**
-   * \defgroup pip_get_pipid pip_get_pipid
+   * \defgroup pip_named_export_replace pip_named_export_replace
    * @{ */
   /**
    * \description
-   * obtain PIPID of the calling PiP task
+   * Export an address with the specified name. Unlike
+   * \ref pip_named_export, if the name is already exported by the
+   * calling task, the exported address is replaced with \p exp and
+   * the version number of the name is incremented. The tasks
+   * importing the name after this call get the new address, and the
+   * subscribers (see \ref pip_named_subscribe) are notified.
    *
-   * \param[out] pipidp This parameter points to the variable which
-   *  will be set to the PiP ID of the calling task
+   * \param[in] exp an address to be passed to the other PiP task
+   * \param[out] versionp the version number of the export (if not
+   * \p NULL). The first export of a name has version 1. The version
+   * keeps increasing when the name is unexported and exported again.
+   * \param[in] format a \c printf format to give the exported address
+   * a name. If this is \p NULL, then the name is assumed to be "".
    *
    * \return Return 0 on success. Return an error code on error.
-   * \retval EPERM PiP library is not initialized yet
-   *
-   * \sa pip_init
+   * \retval EPERM \p pip_init is not yet called.
+   * \retval ENOMEM Not enough memory
    *
-   * \author Atsushi Hori
+   * \sa pip_named_export
+   * \sa pip_named_unexport
+   * \sa pip_named_subscribe
    */
-  int pip_get_pipid( int *pipidp );
+  int pip_named_export_replace( void *exp,
+				uint64_t *versionp,
+				const char *format, ... )
+    __attribute__ ((format (printf, 3, 4)));
   /** @} */
 
   /**
-   * \defgroup pip_is_initialized pip_is_initialized
+   * \defgroup pip_named_export_replace_key pip_named_export_replace_key
    * @{ */
   /**
    * \description
-   * query function if \a pip_init() is called already or not
+   * Same as \ref pip_named_export_replace but the name is given by a
+   * key set by \ref pip_named_key.
    *
-   * \return Return a non-zero value if PiP is already
-   * initialized. Otherwise this returns zero.
+   * \param[in] exp an address to be passed to the other PiP task
+   * \param[out] versionp the version number of the export (if not
+   * \p NULL)
+   * \param[in] key the name key
    *
-   * \note
-   * A spawned PiP task is initialized implicitly and this function
-   * returns true until it calles \p pip_fun.
+   * \return Return 0 on success. Return an error code on error.
+   * \retval EPERM \p pip_init is not yet called.
+   * \retval EINVAL \p key is \p NULL
+   * \retval ENOMEM Not enough memory
    *
-   * \sa pip_init
+   * \sa pip_named_export_replace
+   */
+  int pip_named_export_replace_key( void *exp,
+				    uint64_t *versionp,
+				    const pip_named_key_t *key );
+  /** @} */
+
+  /**
+   * \defgroup pip_named_unexport pip_named_unexport
+   * @{ */
+  /**
+   * \description
+   * Withdraw the address exported by the calling task with the
+   * specified name. The name can be exported again. The addresses
+   * already imported by the other tasks are not affected, but the
+   * subscribers get \p ENOENT by \ref pip_named_poll until the name
+   * is exported again.
+   *
+   * \param[in] format a \c printf format to give the exported address
+   * a name. If this is \p NULL, then the name is assumed to be "".
+   *
+   * \return Return 0 on success. Return an error code on error.
+   * \retval EPERM \p pip_init is not yet called.
+   * \retval ENOENT The name is not exported
+   * \retval ENOMEM Not enough memory
+   *
+   * \sa pip_named_export
+   * \sa pip_named_export_replace
+   */
+  int pip_named_unexport( const char *format, ... )
+    __attribute__ ((format (printf, 1, 2)));
+  /** @} */
+
+  /**
+   * \defgroup pip_named_unexport_key pip_named_unexport_key
+   * @{ */
+  /**
+   * \description
+   * Same as \ref pip_named_unexport but the name is given by a key
+   * set by \ref pip_named_key.
+   *
+   * \param[in] key the name key
+   *
+   * \return Return 0 on success. Return an error code on error.
+   * \retval EPERM \p pip_init is not yet called.
+   * \retval EINVAL \p key is \p NULL
+   * \retval ENOENT The name is not exported
+   *
+   * \sa pip_named_unexport
+   */
+  int pip_named_unexport_key( const pip_named_key_t *key );
+  /** @} */
+
+  /**
+   * \defgroup pip_named_subscribe pip_named_subscribe
+   * @{ */
+  /**
+   * \description
+   * Import the address exported by the specified PiP task with the
+   * name of \p key, and remember the export in \p sub so that
+   * changes of the address can be checked by \ref pip_named_poll
+   * without looking up the name again. If the name is not exported
+   * yet, the calling task is blocked as \ref pip_named_import_key.
+   *
+   * \param[in] pipid The PiP ID to import the exposed address
+   * \param[out] sub the subscription
+   * \param[in] key the name key
+   *
+   * \return Return 0 on success. Return an error code on error.
+   * \retval EPERM \p pip_init is not yet called.
+   * \retval EINVAL \p sub or \p key is \p NULL, or \p pipid is invalid
+   * \retval ENOMEM Not enough memory
+   * \retval ECANCELED The target task is terminated
+   * \retval EDEADLK \p pipid is the calling task and tries to block
+   * itself
+   *
+   * \sa pip_named_poll
+   * \sa pip_named_export_replace
+   */
+  int pip_named_subscribe( int pipid,
+			   pip_named_sub_t *sub,
+			   const pip_named_key_t *key );
+  /** @} */
+
+  /**
+   * \defgroup pip_named_poll pip_named_poll
+   * @{ */
+  /**
+   * \description
+   * Check if the address subscribed by \ref pip_named_subscribe has
+   * been replaced. This only compares the version numbers and does
+   * not block.
+   *
+   * \param[in,out] sub the subscription
+   * \param[out] expp the current address (if not \p NULL)
+   * \param[out] changedp set to 1 if the address has been replaced
+   * since the last call, or 0 otherwise (if not \p NULL)
+   *
+   * \return Return 0 on success. Return an error code on error.
+   * \retval EINVAL \p sub is not a valid subscription
+   * \retval ENOENT The name is unexported, or the exporting task is
+   * terminated. When the name is exported again by the same task,
+   * the subscription follows it and the next call reports the new
+   * address as changed. Exports by a new task spawned with the same
+   * PiP ID are not followed.
+   *
+   * \sa pip_named_subscribe
+   * \sa pip_named_export_replace
+   * \sa pip_named_unexport
+   */
+  int pip_named_poll( pip_named_sub_t *sub, void **expp, int *changedp );
+  /** @} */
+
+  /**
+   * \defgroup pip_export pip_export
+   * @{ */
+  /**
+   * \description
+   * Pass an address of a memory region to the other PiP task. This is
+   * a very naive implementation in PiP v1 and deprecated. Once a task
+   * export an address, there is no way to change the exported address
+   * or undo export. You cannot export \b NULL.
+   *
+   * \param[in] exp An addresss
+   *
+   * \return Return 0 on success. Return an error code on error.
+   * \retval EPERM PiP library is not initialized yet
+   * \retval EINVAL tried to export \b NULL
+   *
+   * \note 
+   * This function was introduced from the first PiP version and is
+   * deprecated.
+   *
+   * \sa pip_named_export
+   * \sa pip_named_import
+   * \sa pip_named_tryimport
+   * \sa pip_import
    *
    * \author Atsushi Hori
    */
-  int pip_is_initialized( void );
+  int pip_export( void *exp );
   /** @} */
 
   /**
-   * \defgroup pip_get_ntasks pip_get_ntasks
+   * \defgroup pip_import pip_import
    * @{ */
   /**
-   * \description 
-   * Obtain the maximum number of PiP tasks able to be created
+   * \description
+   * Get an address exported by the specified PiP task. This is
+   * a very naive implementation in PiP v1 and deprecated. If the
+   * address is not yet exported at the time of calling this function,
+   * then \p NULL is returned.
    *
-   * \param[out] ntasksp Maximum number of PiP tasks is returned
+   * \param[in] pipid The PiP ID to import the exported address
+   * \param[out] expp The exported address
    *
    * \return Return 0 on success. Return an error code on error.
-   * \retval EPERM PiP library is not yet initialized
+   * \retval EPERM PiP library is not initialized yet
    *
-   * \sa pip_init
+   * \sa pip_export
+   * \sa pip_named_export
+   * \sa pip_named_import
+   * \sa pip_named_tryimport
+   *
+   * \note 
+   * This function was introduced from the first PiP version and is
+   * deprecated.
    *
    * \author Atsushi Hori
    */
-  int pip_get_ntasks( int *ntasksp );
+  int pip_import( int pipid, void **expp );
+  /** @} */
+
+  /**
+   * \defgroup pip_set_aux pip_set_aux
+   * @{ */
+  /**
+   * \description
+   * associate arbitrary data with a PiP task
+   *
+   * \param[in] aux Pointer to the user dats to assocate with the calling PiP task
+   *
+   * \return Return 0 on success. Return an error code on error.
+   * \retval EPERM PiP library is not yet initialized or already
+   * finalized
+   *
+   * \sa pip_get_aux
+   *
+   * \author Atsushi Hori
+   */
+  int pip_set_aux( void *aux );
+  /** @} */
+
+  /**
+   * \defgroup pip_get_aux pip_get_aux
+   * @{ */
+  /**
+   * \description
+   * obtain the data which was associated by \a pip_set_aus().
+   *
+   * \param[out] auxp Returned user data
+   *
+   * \return Return 0 on success. Return an error code on error.
+   * \retval EPERM PiP library is not yet initialized or already
+   * finalized
+   *
+   * \sa pip_set_aux
+   *
+   * \author Atsushi Hori
+   */
+  int pip_get_aux( void **auxp );
+  /** @} */
+  /** @} */
+
+  /**
+   * \defgroup PiP-API3-wait API: Waiting for PiP task termination
+   * @{
+   */
+
+  /**
+   * \defgroup pip_wait pip_wait
+   * @{ */
+  /**
+   * \description
+   * This function can be used regardless to the PiP execution mode.
+   * This function blocks until the specified PiP task terminates.
+   * The macros such as \p WIFEXITED and so on defined in Glibc can be 
+   * applied to the returned \p status value.
+   *
+   * \param[in] pipid PiP ID to wait for.
+   * \param[out] status Status value of the terminated PiP task
+   *
+   * \return Return 0 on success. Return an error code on error.
+   * \retval EPERM PiP library is not initialized yet, or This
+   * function is called other than PiP root.
+   * \retval EDEADLK The specified \c pipid is the one of PiP root
+   * \retval ECHILD The target PiP task does not exist or it was already
+   * terminated and waited for
+   *
+   * \sa pip_exit
+   * \sa pip_trywait
+   * \sa pip_wait_any
+   * \sa pip_trywait_any
+   * \sa wait(Linux 3)
+   *
+   * \author Atsushi Hori
+   */
+  int pip_wait( int pipid, int *status );
+  /** @} */
+
+  /**
+   * \defgroup pip_trywait pip_trywait
+   * @{ */
+  /**
+   * \description
+   * This function can be used regardless to the PiP execution mode.
+   * This function behaves like the \p wait function of glibc and the
+   * macros such as \p WIFEXITED and so on can be applied to the
+   * returned \p status value.
+   *
+   * \param[in] pipid PiP ID to wait for.
+   * \param[out] status Status value of the terminated PiP task
+   *
+   * \note This function can be used regardless to the PiP execution
+   * mode.
+   *
+   * \return Return 0 on success. Return an error code on error.
+   * \retval EPERM The PiP library is not initialized yet, or this
+   * function is called other than PiP root 
+   * \retval EDEADLK The specified \c pipid is the one of PiP root
+   * \retval ECHILD The target PiP task does not exist or it was already
+   * terminated and waited for
+   *
+   * \sa pip_exit
+   * \sa pip_wait
+   * \sa pip_wait_any
+   * \sa pip_trywait_any
+   * \sa wait(Linux 2)
+   *
+   * \author Atsushi Hori
+   */
+  int pip_trywait( int pipid, int *status );
   /** @} */
 
   /**
-   * \defgroup pip_get_mode pip_get_mode
+   * \defgroup pip_wait_any pip_wait_any
+   * @{ */
+  /**
+   * \description
+   * This function can be used regardless to the PiP execution mode.
+   * This function blocks until any of PiP tasks terminates.
+   * The macros such as \p WIFEXITED and so on defined in Glibc can be
+   * applied to the returned \p status value.
+   *
+   * \param[out] pipid PiP ID of terminated PiP task.
+   * \param[out] status Exit statusof the terminated PiP task
+   *
+   * \return Return 0 on success. Return an error code on error.
+   * \retval EPERM The PiP library is not initialized yet, or the
+   * function is called other than PiP root 
+   * \retval ECHILD The target PiP task does not exist or it was already
+   * terminated and waited for
+   *
+   * \sa pip_exit
+   * \sa pip_wait
+   * \sa pip_trywait
+   * \sa pip_trywait_any
+   * \sa wait(Linux 2)
+   *
+   * \author Atsushi Hori
+   */
+  int pip_wait_any( int *pipid, int *status );
+  /** @} */
+
+  /**
+   * \defgroup pip_trywait_any pip_trywait_any
+   * @{ */
+  /**
+   * \description
+   * This function can be used regardless to the PiP execution mode.
+   * This function blocks until any of PiP tasks terminates.
+   * The macros such as \p WIFEXITED and so on defined in Glibc can be
+   * applied to the returned \p status value.
+   *
+   * \param[out] pipid PiP ID of terminated PiP task.
+   * \param[out] status Exit status of the terminated PiP task
+   *
+   * \return Return 0 on success. Return an error code on error.
+   * \retval EPERM The PiP library is not initialized yet, or the
+   * function is called other than PiP root 
+   * \retval ECHILD There is no PiP task to wait for
+   *
+   * \sa pip_exit
+   * \sa pip_wait
+   * \sa pip_trywait
+   * \sa pip_wait_any
+   * \sa wait(Linux 2)
+   *
+   * \author Atsushi Hori
+   */
+  int pip_trywait_any( int *pipid, int *status );
+  /** @} */
+  /** @} */
+
+  /**
+   * \defgroup PiP-API4-query API: Query Functions
+   * @{
+   */
+
+  /**
+   * \defgroup pip_get_pipid pip_get_pipid
+   * @{ */
+  /**
+   * \description
+   * obtain PIPID of the calling PiP task
+   *
+   * \param[out] pipidp This parameter points to the variable which
+   *  will be set to the PiP ID of the calling task
+   *
+   * \return Return 0 on success. Return an error code on error.
+   * \retval EPERM PiP library is not initialized yet
+   *
+   * \sa pip_init
+   *
+   * \author Atsushi Hori
+   */
+  int pip_get_pipid( int *pipidp );
+  /** @} */
+
+  /**
+   * \defgroup pip_is_initialized pip_is_initialized
+   * @{ */
+  /**
+   * \description
+   * query function if \a pip_init() is called already or not
+   *
+   * \return Return a non-zero value if PiP is already
+   * initialized. Otherwise this returns zero.
+   *
+   * \note
+   * A spawned PiP task is initialized implicitly and this function
+   * returns true until it calles \p pip_fun.
+   *
+   * \sa pip_init
+   *
+   * \author Atsushi Hori
+   */
+  int pip_is_initialized( void );
+  /** @} */
+
+  /**
+   * \defgroup pip_get_ntasks pip_get_ntasks
+   * @{ */
+  /**
+   * \description 
+   * Obtain the maximum number of PiP tasks able to be created
+   *
+   * \param[out] ntasksp Maximum number of PiP tasks is returned
+   *
+   * \return Return 0 on success. Return an error code on error.
+   * \retval EPERM PiP library is not yet initialized
+   *
+   * \sa pip_init
+   *
+   * \author Atsushi Hori
+   */
+  int pip_get_ntasks( int *ntasksp );
+  /** @} */
+
+  /**
+   * \defgroup pip_get_mode pip_get_mode
+   * @{ */
+  /**
+   * \description
+   * Obtain the current PiP execution mode
+   *
+   * \param[out] modep Returned PiP execution mode
+   *
+   * \return Return 0 on success. Return an error code on error.
+   * \retval EPERM PiP library is not yet initialized
+   *
+   * \sa pip_get_mode_str
+   *
+   * \author Atsushi Hori
+   */
+  int pip_get_mode( int *modep );
+  /** @} */
+
+  /**
+   * \defgroup pip_get_mode_str pip_get_mode_str
+   * @{ */
+  /**
+   * \description
+   * Obtain the current PiP execution mode in character string
+   *
+   * \return Return the name string of the current execution mode. If
+   * PiP library is not initialized yet, then this returns \p NULL.
+   *
+   * \sa pip_get_mode
+   *
+   * \author Atsushi Hori
+   */
+  const char *pip_get_mode_str( void );
+  /** @} */
+
+  /**
+   * \defgroup pip_get_system_id pip_get_system_id
+   * @{ */
+  /**
+   * \description
+   * The returned object depends on the PiP execution mode. In the process
+   * mode it returns TID (Thread ID, not PID) and in the thread mode
+   * it returns thread (\p pthread_t) associated with the PiP task
+   * This function can be used regardless to the PiP execution
+   * mode.
+   *
+   * \param[out] pipid PiP ID of a target PiP task
+   * \param[out] idp a pointer to store the ID value
+   *
+   * \return Return 0 on success. Return an error code on error.
+   * \retval EPERM The PiP library is not initialized yet
+   *
+   * \sa getpid(Linux 2)
+   * \sa pthread_self(Linux 3)
+   *
+   * \author Atsushi Hori
+   */
+  int pip_get_system_id( int pipid, pip_id_t *idp );
+  /** @} */
+
+  /**
+   * \defgroup pip_isa_root pip_isa_root
+   * @{ */
+  /**
+   * \description
+   * a predicate if the calling task is the PiP root or not
+   *
+   * \return Return a non-zero value if the caller is the PiP
+   * root. Otherwise this returns zero.
+   *
+   * \sa pip_init
+   *
+   * \author Atsushi Hori
+   */
+  int pip_isa_root( void );
+  /** @} */
+
+  /**
+   * \defgroup pip_isa_task pip_isa_task
+   * @{ */
+  /**
+   * \description
+   * a predicate if the calling task is a PiP task or not
+   *
+   * \return Return a non-zero value if the caller is the PiP
+   * task. Otherwise this returns zero.
+   *
+   * \sa pip_init
+   *
+   * \author Atsushi Hori
+   */
+  int pip_isa_task( void );
+  /** @} */
+
+  /**
+   * \defgroup pip_is_threaded pip_is_threaded
+   * @{ */
+  /**
+   * \description
+   * a predicate if the current PiP execution mode is thread or not.
+   *
+   * \param[out] flagp set to a non-zero value if PiP execution mode is
+   * Pthread
+   *
+   * \return Return 0 on success. Return an error code on error.
+   * \retval EPERM The PiP library is not initialized yet
+   *
+   * \sa pip_init
+   *
+   * \author Atsushi Hori
+   */
+  int pip_is_threaded( int *flagp );
+  /** @} */
+
+  /**
+   * \defgroup pip_is_shared_fd pip_is_shared_fd
+   * @{ */
+  /**
+   * \description
+   * a predicate if the FDs (file descriptors) are shared among PiP
+   * tasks or not
+   *
+   * \param[out] flagp set to a non-zero value if FDs are shared
+   *
+   * \return Return 0 on success. Return an error code on error.
+   * \retval EPERM The PiP library is not initialized yet
+   *
+   * \sa pip_init
+   *
+   * \author Atsushi Hori
+   */
+  int pip_is_shared_fd( int *flagp );
+  /** @} */
+
+  /**
+   * \defgroup pip_gettime pip_gettime
+   * @{ */
+  /**
+   * \description
+   * returning the result of \b gettimeofday in double.
+   *
+   * \return The current time in double [sec].
+   *
+   * \sa gettimeofday(Linux 3)
+   *
+   * \author Atsushi Hori
+   */
+  double pip_gettime( void );
+  /** @} */
+  /** @} */
+
+  /**
+   * \defgroup PiP-API5-exit API: termination and signaling
+   * @{
+   */
+
+  /**
+   * \defgroup pip_exit pip_exit
+   * @{ */
+  /**
+   * \description
+   * When the main function or the start function of a PiP task
+   * returns with an integer value, then it has the same effect of
+   * calling \ref pip_exit with the returned value.
+   *
+   * \param[in] status This status is returned to PiP root.
+   *
+   * \note
+   * This function can be used regardless to the PiP execution mode.
+   * \p exit(3) is called in the process mode and \p pthread_exit(3)
+   * is called in the pthread mode.
+   *
+   * \sa pip_wait
+   * \sa pip_trywait
+   * \sa pip_wait_any
+   * \sa pip_trywait_any
+   * \sa exit(Linux 3)
+   * \sa pthread_exit(Linux 3)
+   *
+   * \author Atsushi Hori
+   */
+  void pip_exit( int status );
+  /** @} */
+
+  /**
+   * \defgroup pip_kill_all_child_tasks pip_kill_all_child_tasks
+   * @{ */
+  /**
+   * \description
+   * kill all PiP tasks (excluding PiP root)
+   *
+   * \note
+   * This function must be called from PiP root.
+   *
+   * \return Return 0 on success. Return an error code on error.
+   * \retval EPERM The PiP library is not initialized yet or not called from root
+   *
+   * \author Atsushi Hori
+   */
+  int pip_kill_all_child_tasks( void );
+  /** @} */
+
+  /**
+   * \defgroup pip_abort pip_abort
+   * @{ */
+  /**
+   * \description Kill all PiP tasks and then kill PiP root by the
+   * SIGABRT signal.
+   *
+   * \author Atsushi Hori
+   */
+  void pip_abort(void);
+  /** @} */
+
+  /**
+   * \defgroup pip_kill pip_kill
+   * @{ */
+  /**
+   * \description 
+   * deliver a signal to PiP task
+   *
+   * \param[out] pipid PiP ID of a target PiP task to deliver the signal
+   * \param[out] signal signal number to be delivered
+   *
+   * \return Return 0 on success. Return an error code on error.
+   * \retval EPERM PiP library is not yet initialized
+   * \retval EINVAL An invalid signal number or invalid PiP ID is
+   * specified
+   *
+   * \sa tkill(Luinux 2)
+   *
+   * \author Atsushi Hori
+   */
+  int pip_kill( int pipid, int signal );
+  /** @} */
+
+  /**
+   * \defgroup pip_sigmask pip_sigmask
+   * @{ */
+  /**
+   * \description
+   * set signal mask of the current PiP task
+   * 
+   * \note
+   * This function is agnostic to the PiP execution mode.
+   *
+   * \param[in] how see \b sigprogmask or \b pthread_sigmask
+   * \param[in] sigmask signal mask
+   * \param[out] oldmask old signal mask
+   *
+   * \return Return 0 on success. Return an error code on error.
+   * \retval EPERM PiP library is not yet initialized
+   * \retval EINVAL An invalid signal number or invalid PiP ID is
+   * specified
+   *
+   * \sa sigprocmask(Linux 2)
+   * \sa pthread_sigmask(Linux 3)
+   *
+   * \author Atsushi Hori
+   */
+  int pip_sigmask( int how, const sigset_t *sigmask, sigset_t *oldmask );
+  /** @} */
+
+  /**
+   * \defgroup pip_signal_wait pip_signal_wait
+   * @{ */
+  /**
+   * \description
+   * This function is agnostic to the PiP execution mode.
+   *
+   * \param[in] signal signal to wait
+   *
+   * \return Return 0 on success. Return an error code on error.
+   *
+   * \note This function does NOT return the \p EINTR error. This case
+   * is treated as normal return;
+   *
+   * \sa sigwait(Linux 3)
+   * \sa sigsuspend(Linux 2)
+   *
+   * \author Atsushi Hori
+   */
+  int pip_signal_wait( int signal );
+  /** @} */
+  /** @} */
+
+  /**
+   * \defgroup PiP-API6-sync API: Synchronization
+   * @{
+   */
+
+  /**
+   * \defgroup pip_yield pip_yield
+   * @{ */
+  /**
+   * \description yield
+   *
+   * \param[in] flag to specify the behavior of yielding. Unused and
+   * reserved for BLT/ULP (in PiP-v3)
+   *
+   * \return Thuis function always succeeds and returns zero.
+   *
+   * \sa sched_yield(Linux 2)
+   * \sa pthread_yield(Linux 3)
+   *
+   * \author Atsushi Hori
+   */
+  int pip_yield( int flag );
+  /** @} */
+
+  /**
+   * \defgroup pip_barrier_init pip_barrier_init
+   * @{ */
+  /**
+   * \description 
+   * initialize barrier synchronization structure
+   *
+   * \param[in] barrp pointer to a PiP barrier structure
+   * \param[in] n number of participants of this barrier synchronization
+   *
+   * \return Return 0 on success. Return an error code on error.
+   *
+   * \retval EPERM PiP library is not yet initialized or already
+   * finalized
+   * \retval EINAVL \c n is invalid
+   *
+   * \sa pip_barrier_wait
+   * \sa pip_barrier_fin
+   *
+   * \author Atsushi Hori
+   */
+  int pip_barrier_init( pip_barrier_t *barrp, int n );
+  /** @} */
+
+  /**
+   * \defgroup pip_barrier_wait pip_barrier_wait
+   * @{ */
+  /**
+   * \description wait on barrier synchronization
+   *
+   * \param[in] barrp pointer to a PiP barrier structure
+   *
+   * \return Return 0 on success. Return an error code on error.
+   *
+   * \retval EPERM PiP library is not yet initialized or already
+   * finalized
+   *
+   * \sa pip_barrier_init
+   * \sa pip_barrier_fin
+   *
+   * \author Atsushi Hori
+   */
+  int pip_barrier_wait( pip_barrier_t *barrp );
+  /** @} */
+
+  /**
+   * \defgroup pip_barrier_fin pip_barrier_fin
+   * @{ */
+  /**
+   * \description
+   * finalize barrier synchronization structure
+   *
+   * \param[in] barrp pointer to a PiP barrier structure
+   *
+   * \return Return 0 on success. Return an error code on error.
+   * \retval EPERM PiP library is not yet initialized or already
+   * finalized
+   * \retval EBUSY there are some tasks wating for barrier
+   * synchronization
+   *
+   * \sa pip_barrier_init
+   * \sa pip_barrier_wait
+   *
+   * \author Atsushi Hori
+   */
+  int pip_barrier_fin( pip_barrier_t *barrp );
+  /** @} */
+
+  /**
+   * \defgroup pip_tree_barrier_create pip_tree_barrier_create
+   * @{ */
+  /**
+   * \description
+   * Create a combining tree barrier for \p n participants. Unlike
+   * \ref pip_barrier_wait where all participants decrement one
+   * counter, the participants of a tree barrier arrive at the leaves
+   * of a radix-4 tree whose nodes have their own cache blocks, and
+   * only the last arriver of a node goes up to the parent node. The
+   * last arriver at the root releases all participants by updating
+   * one word. This scales better with many PiP tasks.
+   *
+   * \param[out] barrp pointer to the created barrier
+   * \param[in] n number of participants
+   *
+   * \return Return 0 on success. Return an error code on error.
+   * \retval EPERM PiP library is not yet initialized or already
+   * finalized
+   * \retval EINVAL \p barrp is \p NULL or \p n is invalid
+   * \retval ENOMEM not enough memory
+   *
+   * \note
+   * Participants with close ranks share the sub-trees. Giving the
+   * ranks in the order of the CPU cores, e.g. PiP IDs of the tasks
+   * spawned on the consecutive cores, keeps the sub-trees local.
+   *
+   * \sa pip_tree_barrier_wait
+   * \sa pip_tree_barrier_destroy
+   * \sa pip_barrier_init
+   */
+  int pip_tree_barrier_create( pip_tree_barrier_t **barrp, int n );
+  /** @} */
+
+  /**
+   * \defgroup pip_tree_barrier_wait pip_tree_barrier_wait
+   * @{ */
+  /**
+   * \description
+   * Wait on a tree barrier until all \p n participants arrive. The
+   * waiting participants spin for a while and then sleep on a futex.
+   *
+   * \param[in] barr pointer to a tree barrier
+   * \param[in] rank rank of the calling participant, ranging from 0
+   * to \p n - 1. Each participant must have a distinct rank.
+   *
+   * \return Return 0 on success. Return an error code on error.
+   * \retval EINVAL \p barr is not a valid tree barrier
+   * \retval ERANGE \p rank is out of range
+   *
+   * \sa pip_tree_barrier_create
+   */
+  int pip_tree_barrier_wait( pip_tree_barrier_t *barr, int rank );
+  /** @} */
+
+  /**
+   * \defgroup pip_tree_barrier_destroy pip_tree_barrier_destroy
+   * @{ */
+  /**
+   * \description
+   * Destroy a tree barrier.
+   *
+   * \param[in] barr pointer to a tree barrier
+   *
+   * \return Return 0 on success. Return an error code on error.
+   * \retval EINVAL \p barr is not a valid tree barrier
+   * \retval EBUSY some participants are waiting on the barrier
+   *
+   * \sa pip_tree_barrier_create
+   */
+  int pip_tree_barrier_destroy( pip_tree_barrier_t *barr );
+  /** @} */
+
+  /**
+   * \defgroup pip_mutex_init pip_mutex_init
+   * @{ */
+  /**
+   * \description
+   * Initialize a PiP mutex. Unlike \c pthread_mutex_t, a PiP mutex is a
+   * single futex word and can be shared by PiP tasks in both of the
+   * thread and process modes. A task trying to lock a locked mutex
+   * spins for a while and then sleeps in the kernel.
+   *
+   * \param[out] mutex pointer to a PiP mutex
+   *
+   * \return Return 0 on success. Return an error code on error.
+   * \retval EINVAL \p mutex is \p NULL
+   *
+   * \sa pip_mutex_lock
+   * \sa pip_mutex_unlock
+   * \sa pip_mutex_fin
+   */
+  int pip_mutex_init( pip_mutex_t *mutex );
+  /** @} */
+
+  /**
+   * \defgroup pip_mutex_lock pip_mutex_lock
+   * @{ */
+  /**
+   * \description
+   * Lock a PiP mutex. The mutex is not recursive.
+   *
+   * \param[in] mutex pointer to a PiP mutex
+   *
+   * \return Return 0 on success. Return an error code on error.
+   * \retval EINVAL \p mutex is \p NULL
+   *
+   * \sa pip_mutex_trylock
+   * \sa pip_mutex_unlock
+   */
+  int pip_mutex_lock( pip_mutex_t *mutex );
+  /** @} */
+
+  /**
+   * \defgroup pip_mutex_trylock pip_mutex_trylock
+   * @{ */
+  /**
+   * \description
+   * Lock a PiP mutex if it is not locked.
+   *
+   * \param[in] mutex pointer to a PiP mutex
+   *
+   * \return Return 0 on success. Return an error code on error.
+   * \retval EINVAL \p mutex is \p NULL
+   * \retval EBUSY \p mutex is already locked
+   *
+   * \sa pip_mutex_lock
+   * \sa pip_mutex_unlock
+   */
+  int pip_mutex_trylock( pip_mutex_t *mutex );
+  /** @} */
+
+  /**
+   * \defgroup pip_mutex_unlock pip_mutex_unlock
+   * @{ */
+  /**
+   * \description
+   * Unlock a PiP mutex and wake up one of the waiting tasks, if any.
+   *
+   * \param[in] mutex pointer to a PiP mutex
+   *
+   * \return Return 0 on success. Return an error code on error.
+   * \retval EINVAL \p mutex is \p NULL
+   * \retval EPERM \p mutex is not locked
+   *
+   * \sa pip_mutex_lock
+   */
+  int pip_mutex_unlock( pip_mutex_t *mutex );
+  /** @} */
+
+  /**
+   * \defgroup pip_mutex_fin pip_mutex_fin
+   * @{ */
+  /**
+   * \description
+   * Finalize a PiP mutex.
+   *
+   * \param[in] mutex pointer to a PiP mutex
+   *
+   * \return Return 0 on success. Return an error code on error.
+   * \retval EINVAL \p mutex is \p NULL
+   * \retval EBUSY \p mutex is locked
+   *
+   * \sa pip_mutex_init
+   */
+  int pip_mutex_fin( pip_mutex_t *mutex );
+  /** @} */
+
+  /**
+   * \defgroup pip_cond_init pip_cond_init
+   * @{ */
+  /**
+   * \description
+   * Initialize a PiP condition variable to be used with a PiP mutex.
+   *
+   * \param[out] cond pointer to a PiP condition variable
+   *
+   * \return Return 0 on success. Return an error code on error.
+   * \retval EINVAL \p cond is \p NULL
+   *
+   * \sa pip_cond_wait
+   * \sa pip_cond_signal
+   * \sa pip_cond_broadcast
+   * \sa pip_cond_fin
+   */
+  int pip_cond_init( pip_cond_t *cond );
+  /** @} */
+
+  /**
+   * \defgroup pip_cond_wait pip_cond_wait
+   * @{ */
+  /**
+   * \description
+   * Unlock \p mutex and wait until \p cond is signaled, and then
+   * lock \p mutex again. As with \c pthread_cond_wait, the calling
+   * task may wake up spuriously and must check its condition again.
+   *
+   * \param[in] cond pointer to a PiP condition variable
+   * \param[in] mutex pointer to a PiP mutex locked by the calling task
+   *
+   * \return Return 0 on success. Return an error code on error.
+   * \retval EINVAL \p cond or \p mutex is \p NULL
+   *
+   * \sa pip_cond_timedwait
+   * \sa pip_cond_signal
+   * \sa pip_cond_broadcast
+   */
+  int pip_cond_wait( pip_cond_t *cond, pip_mutex_t *mutex );
+  /** @} */
+
+  /**
+   * \defgroup pip_cond_timedwait pip_cond_timedwait
+   * @{ */
+  /**
+   * \description
+   * Same as \ref pip_cond_wait but waits at most for \p timeout.
+   *
+   * \param[in] cond pointer to a PiP condition variable
+   * \param[in] mutex pointer to a PiP mutex locked by the calling task
+   * \param[in] timeout relative time to wait. If this is \p NULL,
+   * the calling task waits forever.
+   *
+   * \return Return 0 on success. Return an error code on error.
+   * \retval EINVAL \p cond or \p mutex is \p NULL
+   * \retval ETIMEDOUT \p cond is not signaled within \p timeout
+   *
+   * \sa pip_cond_wait
+   */
+  int pip_cond_timedwait( pip_cond_t *cond,
+			  pip_mutex_t *mutex,
+			  const struct timespec *timeout );
+  /** @} */
+
+  /**
+   * \defgroup pip_cond_signal pip_cond_signal
+   * @{ */
+  /**
+   * \description
+   * Wake up one of the tasks waiting on \p cond.
+   *
+   * \param[in] cond pointer to a PiP condition variable
+   *
+   * \return Return 0 on success. Return an error code on error.
+   * \retval EINVAL \p cond is \p NULL
+   *
+   * \sa pip_cond_wait
+   * \sa pip_cond_broadcast
+   */
+  int pip_cond_signal( pip_cond_t *cond );
+  /** @} */
+
+  /**
+   * \defgroup pip_cond_broadcast pip_cond_broadcast
+   * @{ */
+  /**
+   * \description
+   * Wake up all the tasks waiting on \p cond at once.
+   *
+   * \param[in] cond pointer to a PiP condition variable
+   *
+   * \return Return 0 on success. Return an error code on error.
+   * \retval EINVAL \p cond is \p NULL
+   *
+   * \sa pip_cond_wait
+   * \sa pip_cond_signal
+   */
+  int pip_cond_broadcast( pip_cond_t *cond );
+  /** @} */
+
+  /**
+   * \defgroup pip_cond_fin pip_cond_fin
+   * @{ */
+  /**
+   * \description
+   * Finalize a PiP condition variable.
+   *
+   * \param[in] cond pointer to a PiP condition variable
+   *
+   * \return Return 0 on success. Return an error code on error.
+   * \retval EINVAL \p cond is \p NULL
+   *
+   * \sa pip_cond_init
+   */
+  int pip_cond_fin( pip_cond_t *cond );
+  /** @} */
+
+  /**
+   * \defgroup pip_semaphore_init pip_semaphore_init
+   * @{ */
+  /**
+   * \description
+   * Initialize a PiP counting semaphore built on a futex word.
+   *
+   * \param[out] sem pointer to a PiP semaphore
+   * \param[in] value initial value
+   *
+   * \return Return 0 on success. Return an error code on error.
+   * \retval EINVAL \p sem is \p NULL, or \p value is too large
+   *
+   * \sa pip_semaphore_post
+   * \sa pip_semaphore_wait
+   * \sa pip_semaphore_fin
+   */
+  int pip_semaphore_init( pip_semaphore_t *sem, unsigned int value );
+  /** @} */
+
+  /**
+   * \defgroup pip_semaphore_post pip_semaphore_post
+   * @{ */
+  /**
+   * \description
+   * Increment a PiP semaphore and wake up one of the waiting tasks,
+   * if any.
+   *
+   * \param[in] sem pointer to a PiP semaphore
+   *
+   * \return Return 0 on success. Return an error code on error.
+   * \retval EINVAL \p sem is \p NULL
+   *
+   * \sa pip_semaphore_wait
+   */
+  int pip_semaphore_post( pip_semaphore_t *sem );
+  /** @} */
+
+  /**
+   * \defgroup pip_semaphore_wait pip_semaphore_wait
+   * @{ */
+  /**
+   * \description
+   * Decrement a PiP semaphore. If the value is zero, the calling task
+   * is blocked until it becomes positive.
+   *
+   * \param[in] sem pointer to a PiP semaphore
+   *
+   * \return Return 0 on success. Return an error code on error.
+   * \retval EINVAL \p sem is \p NULL
+   *
+   * \sa pip_semaphore_trywait
+   * \sa pip_semaphore_timedwait
+   * \sa pip_semaphore_post
+   */
+  int pip_semaphore_wait( pip_semaphore_t *sem );
+  /** @} */
+
+  /**
+   * \defgroup pip_semaphore_trywait pip_semaphore_trywait
+   * @{ */
+  /**
+   * \description
+   * Decrement a PiP semaphore if its value is positive.
+   *
+   * \param[in] sem pointer to a PiP semaphore
+   *
+   * \return Return 0 on success. Return an error code on error.
+   * \retval EINVAL \p sem is \p NULL
+   * \retval EAGAIN the value is zero
+   *
+   * \sa pip_semaphore_wait
+   */
+  int pip_semaphore_trywait( pip_semaphore_t *sem );
+  /** @} */
+
+  /**
+   * \defgroup pip_semaphore_timedwait pip_semaphore_timedwait
+   * @{ */
+  /**
+   * \description
+   * Same as \ref pip_semaphore_wait but waits at most for \p timeout.
+   *
+   * \param[in] sem pointer to a PiP semaphore
+   * \param[in] timeout relative time to wait
+   *
+   * \return Return 0 on success. Return an error code on error.
+   * \retval EINVAL \p sem or \p timeout is \p NULL
+   * \retval ETIMEDOUT the value did not become positive within \p timeout
+   *
+   * \sa pip_semaphore_wait
+   */
+  int pip_semaphore_timedwait( pip_semaphore_t *sem,
+			       const struct timespec *timeout );
+  /** @} */
+
+  /**
+   * \defgroup pip_semaphore_fin pip_semaphore_fin
+   * @{ */
+  /**
+   * \description
+   * Finalize a PiP semaphore.
+   *
+   * \param[in] sem pointer to a PiP semaphore
+   *
+   * \return Return 0 on success. Return an error code on error.
+   * \retval EINVAL \p sem is \p NULL
+   * \retval EBUSY some tasks are waiting on \p sem
+   *
+   * \sa pip_semaphore_init
+   */
+  int pip_semaphore_fin( pip_semaphore_t *sem );
+  /** @} */
+
+  /**
+   * \defgroup pip_rwlock_init pip_rwlock_init
+   * @{ */
+  /**
+   * \description
+   * Initialize a PiP reader-writer lock. While a writer is waiting, new
+   * readers are blocked so that writers are not starved. Thus a reader
+   * must not lock it again recursively.
+   *
+   * \param[out] rwlock pointer to a PiP reader-writer lock
+   *
+   * \return Return 0 on success. Return an error code on error.
+   * \retval EINVAL \p rwlock is \p NULL
+   *
+   * \sa pip_rwlock_rdlock
+   * \sa pip_rwlock_wrlock
+   * \sa pip_rwlock_unlock
+   * \sa pip_rwlock_fin
+   */
+  int pip_rwlock_init( pip_rwlock_t *rwlock );
+  /** @} */
+
+  /**
+   * \defgroup pip_rwlock_rdlock pip_rwlock_rdlock
+   * @{ */
+  /**
+   * \description
+   * Lock a PiP reader-writer lock for reading.
+   *
+   * \param[in] rwlock pointer to a PiP reader-writer lock
+   *
+   * \return Return 0 on success. Return an error code on error.
+   * \retval EINVAL \p rwlock is \p NULL
+   *
+   * \sa pip_rwlock_tryrdlock
+   * \sa pip_rwlock_unlock
+   */
+  int pip_rwlock_rdlock( pip_rwlock_t *rwlock );
+  /** @} */
+
+  /**
+   * \defgroup pip_rwlock_tryrdlock pip_rwlock_tryrdlock
+   * @{ */
+  /**
+   * \description
+   * Lock a PiP reader-writer lock for reading if it can be done without
+   * blocking.
+   *
+   * \param[in] rwlock pointer to a PiP reader-writer lock
+   *
+   * \return Return 0 on success. Return an error code on error.
+   * \retval EINVAL \p rwlock is \p NULL
+   * \retval EBUSY it is write-locked or a writer is waiting
+   *
+   * \sa pip_rwlock_rdlock
+   */
+  int pip_rwlock_tryrdlock( pip_rwlock_t *rwlock );
+  /** @} */
+
+  /**
+   * \defgroup pip_rwlock_wrlock pip_rwlock_wrlock
+   * @{ */
+  /**
+   * \description
+   * Lock a PiP reader-writer lock for writing.
+   *
+   * \param[in] rwlock pointer to a PiP reader-writer lock
+   *
+   * \return Return 0 on success. Return an error code on error.
+   * \retval EINVAL \p rwlock is \p NULL
+   *
+   * \sa pip_rwlock_trywrlock
+   * \sa pip_rwlock_unlock
+   */
+  int pip_rwlock_wrlock( pip_rwlock_t *rwlock );
+  /** @} */
+
+  /**
+   * \defgroup pip_rwlock_trywrlock pip_rwlock_trywrlock
+   * @{ */
+  /**
+   * \description
+   * Lock a PiP reader-writer lock for writing if it is not locked.
+   *
+   * \param[in] rwlock pointer to a PiP reader-writer lock
+   *
+   * \return Return 0 on success. Return an error code on error.
+   * \retval EINVAL \p rwlock is \p NULL
+   * \retval EBUSY it is locked
+   *
+   * \sa pip_rwlock_wrlock
+   */
+  int pip_rwlock_trywrlock( pip_rwlock_t *rwlock );
+  /** @} */
+
+  /**
+   * \defgroup pip_rwlock_unlock pip_rwlock_unlock
+   * @{ */
+  /**
+   * \description
+   * Unlock a PiP reader-writer lock locked for reading or writing.
+   *
+   * \param[in] rwlock pointer to a PiP reader-writer lock
+   *
+   * \return Return 0 on success. Return an error code on error.
+   * \retval EINVAL \p rwlock is \p NULL
+   * \retval EPERM it is not locked
+   *
+   * \sa pip_rwlock_rdlock
+   * \sa pip_rwlock_wrlock
+   */
+  int pip_rwlock_unlock( pip_rwlock_t *rwlock );
+  /** @} */
+
+  /**
+   * \defgroup pip_rwlock_fin pip_rwlock_fin
+   * @{ */
+  /**
+   * \description
+   * Finalize a PiP reader-writer lock.
+   *
+   * \param[in] rwlock pointer to a PiP reader-writer lock
+   *
+   * \return Return 0 on success. Return an error code on error.
+   * \retval EINVAL \p rwlock is \p NULL
+   * \retval EBUSY it is locked or some tasks are waiting
+   *
+   * \sa pip_rwlock_init
+   */
+  int pip_rwlock_fin( pip_rwlock_t *rwlock );
+  /** @} */
+  /** @} */
+
+  /**
+   * \defgroup PiP-API7-shmpool API: Shared Memory Pool
+   * @{
+   */
+
+  /**
+   * \defgroup pip_shmpool_create pip_shmpool_create
+   * @{ */
+  /**
+   * \description
+   * Create a pool of fixed-size memory blocks. Since all PiP tasks
+   * share the same address space, the pool can be passed to the other
+   * tasks, by calling \ref pip_named_export for example, and then any
+   * PiP task can allocate and free the blocks of the pool without
+   * locking and without copying the block contents.
+   *
+   * \param[out] poolp pointer to the created pool
+   * \param[in] blksz size of a block in bytes. This is rounded up to
+   * the cache block size.
+   * \param[in] nblks number of blocks in the pool
+   *
+   * \return Return 0 on success. Return an error code on error.
+   * \retval EPERM PiP library is not yet initialized or already
+   * finalized
+   * \retval EINVAL \p poolp is \p NULL, \p blksz is zero or
+   * \p nblks is invalid
+   * \retval ENOMEM Not enough memory
+   *
+   * \sa pip_shmpool_alloc
+   * \sa pip_shmpool_free
+   * \sa pip_shmpool_destroy
+   */
+  int pip_shmpool_create( pip_shmpool_t **poolp, size_t blksz, int nblks );
+  /** @} */
+
+  /**
+   * \defgroup pip_shmpool_alloc pip_shmpool_alloc
+   * @{ */
+  /**
+   * \description
+   * Allocate a block from the pool. This function never blocks.
+   *
+   * \param[in] pool pointer to a pool
+   * \param[out] blkp allocated block
+   *
+   * \return Return 0 on success. Return an error code on error.
+   * \retval EINVAL \p pool is not a valid pool or \p blkp is \p NULL
+   * \retval EAGAIN All blocks in the pool are in use
+   *
+   * \sa pip_shmpool_create
+   * \sa pip_shmpool_free
+   */
+  int pip_shmpool_alloc( pip_shmpool_t *pool, void **blkp );
+  /** @} */
+
+  /**
+   * \defgroup pip_shmpool_free pip_shmpool_free
+   * @{ */
+  /**
+   * \description
+   * Return a block to the pool. The block can be freed by any PiP
+   * task, not only by the task which allocated it.
+   *
+   * \param[in] pool pointer to a pool
+   * \param[in] blk block allocated by \ref pip_shmpool_alloc
+   *
+   * \return Return 0 on success. Return an error code on error.
+   * \retval EINVAL \p pool is not a valid pool or \p blk is not a
+   * block of the pool
+   *
+   * \sa pip_shmpool_create
+   * \sa pip_shmpool_alloc
+   */
+  int pip_shmpool_free( pip_shmpool_t *pool, void *blk );
+  /** @} */
+
+  /**
+   * \defgroup pip_shmpool_size pip_shmpool_size
+   * @{ */
+  /**
+   * \description
+   * Get the block size and the number of blocks of the pool.
+   *
+   * \param[in] pool pointer to a pool
+   * \param[out] blkszp block size in bytes (if not \p NULL)
+   * \param[out] nblksp number of blocks (if not \p NULL)
+   *
+   * \return Return 0 on success. Return an error code on error.
+   * \retval EINVAL \p pool is not a valid pool
+   *
+   * \sa pip_shmpool_create
+   */
+  int pip_shmpool_size( pip_shmpool_t *pool, size_t *blkszp, int *nblksp );
+  /** @} */
+
+  /**
+   * \defgroup pip_shmpool_destroy pip_shmpool_destroy
+   * @{ */
+  /**
+   * \description
+   * Destroy the pool. No PiP task may access the pool while this
+   * function is being called.
+   *
+   * \param[in] pool pointer to a pool
+   *
+   * \return Return 0 on success. Return an error code on error.
+   * \retval EINVAL \p pool is not a valid pool
+   * \retval EBUSY Some blocks are not yet freed
+   *
+   * \sa pip_shmpool_create
+   */
+  int pip_shmpool_destroy( pip_shmpool_t *pool );
+  /** @} */
+  /** @} */
+
+  /**
+   * \defgroup PiP-API8-taskpool API: Task Pool
+   * @{
+   */
+
+  /**
+   * \defgroup pip_task_pool_create pip_task_pool_create
+   * @{ */
+  /**
+   * \description
+   * Spawn \p ntasks PiP tasks of the program specified by \p progp and
+   * park them in a pool. Instead of calling \c main or the start
+   * function, each pool task waits for a function dispatched by
+   * \ref pip_task_pool_dispatch, runs it and then waits for the next
+   * one. Since the program is already loaded, dispatching a function
+   * costs no name space loading.
+   *
+   * \param[out] poolp pointer to the created pool
+   * \param[in] progp program of the pool tasks. The dispatched
+   * functions are looked up in this program.
+   * \param[in] ntasks number of the pool tasks
+   * \param[in] coreno CPU core number for the first pool task, as in
+   * \ref pip_task_spawn_n
+   *
+   * \return Return 0 on success. Return an error code on error.
+   * \retval EPERM PiP library is not yet initialized, or PiP task
+   * calls this function
+   * \retval EINVAL \p poolp or \p progp is \p NULL, or \p ntasks is
+   * invalid
+   * \retval EAGAIN not enough free PiP IDs
+   *
+   * \note
+   * The pool tasks occupy PiP IDs until \ref pip_task_pool_destroy
+   * is called, and they must not be waited for by \ref pip_wait and
+   * its friends.
+   *
+   * \sa pip_task_pool_dispatch
+   * \sa pip_task_pool_destroy
+   */
+  int pip_task_pool_create( pip_task_pool_t **poolp,
+			    pip_spawn_program_t *progp,
+			    int ntasks,
+			    uint32_t coreno );
+  /** @} */
+
+  /**
+   * \defgroup pip_task_pool_dispatch pip_task_pool_dispatch
+   * @{ */
+  /**
+   * \description
+   * Let an idle pool task call the function named \p funcname with
+   * the argument \p arg. This function does not block.
+   *
+   * \param[in] pool pointer to a pool
+   * \param[in] funcname name of the function of type
+   * \p pip_task_pool_func_t. It must be visible by \c dlsym in the
+   * program of the pool, e.g., linked with the \c -rdynamic option.
+   * The name is resolved here, by the \c dlsym of the PiP root. If
+   * it is not found, the pool task is not woken up and
+   * \ref pip_task_pool_wait or \ref pip_task_pool_wait_any of the
+   * task returns \c ENOENT.
+   * \param[in] arg argument passed to the function
+   * \param[out] pipidp PiP ID of the pool task running the function
+   * (if not \p NULL)
+   *
+   * \return Return 0 on success. Return an error code on error.
+   * \retval EINVAL \p pool is not a valid pool or \p funcname is
+   * \p NULL
+   * \retval ENAMETOOLONG \p funcname is longer than
+   * \p PIP_TASK_POOL_FUNCNAME_MAX
+   * \retval EAGAIN no pool task is idle
+   *
+   * \sa pip_task_pool_wait
+   * \sa pip_task_pool_wait_any
+   */
+  int pip_task_pool_dispatch( pip_task_pool_t *pool,
+			      const char *funcname,
+			      void *arg,
+			      int *pipidp );
+  /** @} */
+
+  /**
+   * \defgroup pip_task_pool_wait pip_task_pool_wait
+   * @{ */
+  /**
+   * \description
+   * Wait for the function dispatched to the pool task \p pipid to
+   * return. The pool task becomes idle again.
+   *
+   * \param[in] pool pointer to a pool
+   * \param[in] pipid PiP ID of the pool task
+   * \param[out] retvalp return value of the function (if not \p NULL)
+   *
+   * \return Return 0 on success. Return an error code on error.
+   * \retval EINVAL \p pool is not a valid pool
+   * \retval ESRCH \p pipid is not a task of the pool
+   * \retval ECHILD no function is dispatched to the task
+   * \retval ENOENT the dispatched function is not found
+   *
+   * \sa pip_task_pool_dispatch
+   * \sa pip_task_pool_wait_any
+   */
+  int pip_task_pool_wait( pip_task_pool_t *pool, int pipid, int *retvalp );
+  /** @} */
+
+  /**
+   * \defgroup pip_task_pool_wait_any pip_task_pool_wait_any
+   * @{ */
+  /**
+   * \description
+   * Wait for any of the dispatched functions of the pool to return.
+   *
+   * \param[in] pool pointer to a pool
+   * \param[out] pipidp PiP ID of the pool task (if not \p NULL)
+   * \param[out] retvalp return value of the function (if not \p NULL)
+   *
+   * \return Return 0 on success. Return an error code on error.
+   * \retval EINVAL \p pool is not a valid pool
+   * \retval ECHILD no function is dispatched
+   * \retval ENOENT the dispatched function is not found
+   *
+   * \sa pip_task_pool_dispatch
+   * \sa pip_task_pool_wait
+   */
+  int pip_task_pool_wait_any( pip_task_pool_t *pool,
+			      int *pipidp,
+			      int *retvalp );
+  /** @} */
+
+  /**
+   * \defgroup pip_task_pool_destroy pip_task_pool_destroy
+   * @{ */
+  /**
+   * \description
+   * Terminate all pool tasks, wait for them and free the pool.
+   *
+   * \param[in] pool pointer to a pool
+   *
+   * \return Return 0 on success. Return an error code on error.
+   * \retval EINVAL \p pool is not a valid pool
+   * \retval EBUSY a dispatched function is still running
+   *
+   * \sa pip_task_pool_create
+   */
+  int pip_task_pool_destroy( pip_task_pool_t *pool );
+  /** @} */
+  /** @} */
+
+  /**
+   * \defgroup PiP-API9-coll API: Collective Operations
+   * @{
+   */
+
+  /**
+   * \defgroup pip_coll_create pip_coll_create
    * @{ */
   /**
    * \description
-   * Obtain the current PiP execution mode
+   * Create a collective context for \p n PiP tasks. The context is
+   * passed to the participating tasks, by calling
+   * \ref pip_named_export for example, and each task calls the
+   * collective operations with its distinct rank ranging from 0 to
+   * \p n - 1. Since PiP tasks share the same address space, the
+   * collective operations load from and store to the user buffers
+   * of the other tasks directly, without any intermediate copy.
    *
-   * \param[out] modep Returned PiP execution mode
+   * \param[out] collp pointer to the created context
+   * \param[in] n number of participating tasks
    *
    * \return Return 0 on success. Return an error code on error.
-   * \retval EPERM PiP library is not yet initialized
+   * \retval EPERM PiP library is not yet initialized or already
+   * finalized
+   * \retval EINVAL \p collp is \p NULL or \p n is invalid
+   * \retval ENOMEM not enough memory
    *
-   * \sa pip_get_mode_str
+   * \note
+   * All participants must call the same collective operations in the
+   * same order, and the buffers must not be modified by the others
+   * during the operations.
    *
-   * \author Atsushi Hori
+   * \sa pip_coll_destroy
+   * \sa pip_tree_barrier_create
    */
-  int pip_get_mode( int *modep );
+  int pip_coll_create( pip_coll_t **collp, int n );
   /** @} */
 
   /**
-   * \defgroup pip_get_mode_str pip_get_mode_str
+   * \defgroup pip_coll_destroy pip_coll_destroy
    * @{ */
   /**
    * \description
-   * Obtain the current PiP execution mode in character string
+   * Destroy a collective context. No participant may be in a
+   * collective operation of the context.
    *
-   * \return Return the name string of the current execution mode. If
-   * PiP library is not initialized yet, then this returns \p NULL.
+   * \param[in] coll pointer to a collective context
    *
-   * \sa pip_get_mode
+   * \return Return 0 on success. Return an error code on error.
+   * \retval EINVAL \p coll is not a valid context
+   * \retval EBUSY some participants are in a collective operation
    *
-   * \author Atsushi Hori
+   * \sa pip_coll_create
    */
-  const char *pip_get_mode_str( void );
+  int pip_coll_destroy( pip_coll_t *coll );
   /** @} */
 
   /**
-   * \defgroup pip_get_system_id pip_get_system_id
+   * \defgroup pip_coll_barrier pip_coll_barrier
    * @{ */
   /**
    * \description
-   * The returned object depends on the PiP execution mode. In the process
-   * mode it returns TID (Thread ID, not PID) and in the thread mode
-   * it returns thread (\p pthread_t) associated with the PiP task
-   * This function can be used regardless to the PiP execution
-   * mode.
+   * Barrier synchronization of the participants.
    *
-   * \param[out] pipid PiP ID of a target PiP task
-   * \param[out] idp a pointer to store the ID value
+   * \param[in] coll pointer to a collective context
+   * \param[in] rank rank of the calling task
    *
    * \return Return 0 on success. Return an error code on error.
-   * \retval EPERM The PiP library is not initialized yet
+   * \retval EINVAL \p coll is not a valid context
+   * \retval ERANGE \p rank is out of range
    *
-   * \sa getpid(Linux 2)
-   * \sa pthread_self(Linux 3)
-   *
-   * \author Atsushi Hori
+   * \sa pip_tree_barrier_wait
    */
-  int pip_get_system_id( int pipid, pip_id_t *idp );
+  int pip_coll_barrier( pip_coll_t *coll, int rank );
   /** @} */
 
   /**
-   * \defgroup pip_isa_root pip_isa_root
+   * \defgroup pip_coll_bcast pip_coll_bcast
    * @{ */
   /**
    * \description
-   * a predicate if the calling task is the PiP root or not
+   * Copy \p size bytes of the \p buf of the \p root to the \p buf of
+   * all the other participants.
    *
-   * \return Return a non-zero value if the caller is the PiP
-   * root. Otherwise this returns zero.
+   * \param[in] coll pointer to a collective context
+   * \param[in] rank rank of the calling task
+   * \param[in,out] buf buffer to broadcast or to receive
+   * \param[in] size size of the buffer in bytes
+   * \param[in] root rank of the broadcasting task
    *
-   * \sa pip_init
+   * \return Return 0 on success. Return an error code on error.
+   * \retval EINVAL \p coll is not a valid context
+   * \retval ERANGE \p rank or \p root is out of range
    *
-   * \author Atsushi Hori
+   * \sa pip_coll_allgather
    */
-  int pip_isa_root( void );
+  int pip_coll_bcast( pip_coll_t *coll,
+		      int rank,
+		      void *buf,
+		      size_t size,
+		      int root );
   /** @} */
 
   /**
-   * \defgroup pip_isa_task pip_isa_task
+   * \defgroup pip_coll_reduce pip_coll_reduce
    * @{ */
   /**
    * \description
-   * a predicate if the calling task is a PiP task or not
-   *
-   * \return Return a non-zero value if the caller is the PiP
-   * task. Otherwise this returns zero.
+   * Reduce the \p count elements of \p sbuf of all the participants
+   * into \p rbuf of the \p root. The elements are divided among the
+   * participants and each participant reduces its part with SIMD
+   * instructions and stores the result into the \p rbuf of the
+   * \p root directly.
+   *
+   * \param[in] coll pointer to a collective context
+   * \param[in] rank rank of the calling task
+   * \param[in] sbuf send buffer
+   * \param[out] rbuf receive buffer, used only at the \p root. This
+   * can be the same as \p sbuf.
+   * \param[in] count number of elements
+   * \param[in] type data type, one of \p PIP_COLL_INT32,
+   * \p PIP_COLL_INT64, \p PIP_COLL_FLOAT and \p PIP_COLL_DOUBLE
+   * \param[in] op operation, one of \p PIP_COLL_SUM,
+   * \p PIP_COLL_PROD, \p PIP_COLL_MIN and \p PIP_COLL_MAX
+   * \param[in] root rank of the receiving task
    *
-   * \sa pip_init
+   * \return Return 0 on success. Return an error code on error.
+   * \retval EINVAL \p coll is not a valid context, or \p type or
+   * \p op is invalid
+   * \retval ERANGE \p rank or \p root is out of range
    *
-   * \author Atsushi Hori
+   * \sa pip_coll_allreduce
    */
-  int pip_isa_task( void );
+  int pip_coll_reduce( pip_coll_t *coll,
+		       int rank,
+		       const void *sbuf,
+		       void *rbuf,
+		       size_t count,
+		       int type,
+		       int op,
+		       int root );
   /** @} */
 
   /**
-   * \defgroup pip_is_threaded pip_is_threaded
+   * \defgroup pip_coll_allreduce pip_coll_allreduce
    * @{ */
   /**
    * \description
-   * a predicate if the current PiP execution mode is thread or not.
-   *
-   * \param[out] flagp set to a non-zero value if PiP execution mode is
-   * Pthread
+   * Reduce the \p count elements of \p sbuf of all the participants
+   * into \p rbuf of all the participants. Each participant reduces
+   * its part into its own \p rbuf and then copies the other parts
+   * from their owners.
+   *
+   * \param[in] coll pointer to a collective context
+   * \param[in] rank rank of the calling task
+   * \param[in] sbuf send buffer
+   * \param[out] rbuf receive buffer. This can be the same as \p sbuf.
+   * \param[in] count number of elements
+   * \param[in] type data type (see \ref pip_coll_reduce)
+   * \param[in] op operation (see \ref pip_coll_reduce)
    *
    * \return Return 0 on success. Return an error code on error.
-   * \retval EPERM The PiP library is not initialized yet
+   * \retval EINVAL \p coll is not a valid context, or \p type or
+   * \p op is invalid
+   * \retval ERANGE \p rank is out of range
    *
-   * \sa pip_init
-   *
-   * \author Atsushi Hori
+   * \sa pip_coll_reduce
    */
-  int pip_is_threaded( int *flagp );
+  int pip_coll_allreduce( pip_coll_t *coll,
+			  int rank,
+			  const void *sbuf,
+			  void *rbuf,
+			  size_t count,
+			  int type,
+			  int op );
   /** @} */
 
   /**
-   * \defgroup pip_is_shared_fd pip_is_shared_fd
+   * \defgroup pip_coll_allgather pip_coll_allgather
    * @{ */
   /**
    * \description
-   * a predicate if the FDs (file descriptors) are shared among PiP
-   * tasks or not
+   * Gather \p size bytes of \p sbuf of all the participants into
+   * \p rbuf of all the participants in the order of the ranks.
    *
-   * \param[out] flagp set to a non-zero value if FDs are shared
+   * \param[in] coll pointer to a collective context
+   * \param[in] rank rank of the calling task
+   * \param[in] sbuf send buffer
+   * \param[in] size size of the send buffer in bytes
+   * \param[out] rbuf receive buffer of \p n times \p size bytes
    *
    * \return Return 0 on success. Return an error code on error.
-   * \retval EPERM The PiP library is not initialized yet
-   *
-   * \sa pip_init
+   * \retval EINVAL \p coll is not a valid context
+   * \retval ERANGE \p rank is out of range
    *
-   * \author Atsushi Hori
+   * \sa pip_coll_alltoall
    */
-  int pip_is_shared_fd( int *flagp );
+  int pip_coll_allgather( pip_coll_t *coll,
+			  int rank,
+			  const void *sbuf,
+			  size_t size,
+			  void *rbuf );
   /** @} */
 
   /**
-   * \defgroup pip_gettime pip_gettime
+   * \defgroup pip_coll_alltoall pip_coll_alltoall
    * @{ */
   /**
    * \description
-   * returning the result of \b gettimeofday in double.
+   * Each participant sends the i-th block of \p size bytes of
+   * \p sbuf to the participant of rank i, which receives it as the
+   * block of the sender rank in \p rbuf.
    *
-   * \return The current time in double [sec].
+   * \param[in] coll pointer to a collective context
+   * \param[in] rank rank of the calling task
+   * \param[in] sbuf send buffer of \p n blocks
+   * \param[in] size size of a block in bytes
+   * \param[out] rbuf receive buffer of \p n blocks
    *
-   * \sa gettimeofday(Linux 3)
+   * \return Return 0 on success. Return an error code on error.
+   * \retval EINVAL \p coll is not a valid context
+   * \retval ERANGE \p rank is out of range
    *
-   * \author Atsushi Hori
+   * \sa pip_coll_allgather
    */
-  double pip_gettime( void );
+  int pip_coll_alltoall( pip_coll_t *coll,
+			 int rank,
+			 const void *sbuf,
+			 size_t size,
+			 void *rbuf );
   /** @} */
   /** @} */
 
   /**
-   * \defgroup PiP-API5-exit API: termination and signaling
+   * \defgroup PiP-API10-channel API: Channels
    * @{
    */
 
   /**
-   * \defgroup pip_exit pip_exit
+   * \defgroup pip_channel_create pip_channel_create
    * @{ */
   /**
    * \description
-   * When the main function or the start function of a PiP task
-   * returns with an integer value, then it has the same effect of
-   * calling \ref pip_exit with the returned value.
-   *
-   * \param[in] status This status is returned to PiP root.
-   *
-   * \note
-   * This function can be used regardless to the PiP execution mode.
-   * \p exit(3) is called in the process mode and \p pthread_exit(3)
-   * is called in the pthread mode.
+   * Create a bounded channel passing messages of \p msgsz bytes
+   * among PiP tasks. A channel created with \p PIP_CHANNEL_SPSC
+   * must have only one sender and only one receiver at a time,
+   * and no atomic read-modify-write operation is involved. A channel
+   * created with \p PIP_CHANNEL_MPMC can be shared by any number of
+   * senders and receivers. If \p PIP_CHANNEL_BLOCK is specified,
+   * the blocking operations sleep on a futex after spinning for a
+   * while, otherwise they spin and yield.
+   *
+   * \param[out] chp pointer to the created channel
+   * \param[in] msgsz size of a message in bytes
+   * \param[in] nmsgs capacity of the channel in messages, rounded
+   * up to a power of two
+   * \param[in] flags \p PIP_CHANNEL_SPSC or \p PIP_CHANNEL_MPMC,
+   * optionally ORed with \p PIP_CHANNEL_BLOCK
+   * \param[in] name if not \p NULL, the channel is exported under
+   * this name so that the other tasks can attach to it by calling
+   * \ref pip_channel_attach
    *
-   * \sa pip_wait
-   * \sa pip_trywait
-   * \sa pip_wait_any
-   * \sa pip_trywait_any
-   * \sa exit(Linux 3)
-   * \sa pthread_exit(Linux 3)
+   * \return Return 0 on success. Return an error code on error.
+   * \retval EPERM PiP library is not yet initialized or already
+   * finalized
+   * \retval EINVAL an argument is invalid
+   * \retval ENAMETOOLONG \p name is too long
+   * \retval ENOMEM not enough memory
+   * \retval EBUSY \p name is already exported by the calling task
    *
-   * \author Atsushi Hori
+   * \sa pip_channel_attach
+   * \sa pip_channel_destroy
    */
-  void pip_exit( int status );
+  int pip_channel_create( pip_channel_t **chp,
+			  size_t msgsz,
+			  int nmsgs,
+			  int flags,
+			  const char *name );
   /** @} */
 
   /**
-   * \defgroup pip_kill_all_child_tasks pip_kill_all_child_tasks
+   * \defgroup pip_channel_attach pip_channel_attach
    * @{ */
   /**
    * \description
-   * kill all PiP tasks (excluding PiP root)
+   * Attach to the channel created and named by the PiP task
+   * \p pipid. This blocks until the channel is created.
    *
-   * \note
-   * This function must be called from PiP root.
+   * \param[out] chp pointer to the channel
+   * \param[in] pipid PiP ID of the task which created the channel
+   * \param[in] name name of the channel
    *
    * \return Return 0 on success. Return an error code on error.
-   * \retval EPERM The PiP library is not initialized yet or not called from root
+   * \retval EINVAL \p chp or \p name is \p NULL
+   * \retval ECANCELED the target task terminated
    *
-   * \author Atsushi Hori
+   * \sa pip_channel_create
    */
-  int pip_kill_all_child_tasks( void );
+  int pip_channel_attach( pip_channel_t **chp, int pipid, const char *name );
   /** @} */
 
   /**
-   * \defgroup pip_abort pip_abort
+   * \defgroup pip_channel_destroy pip_channel_destroy
    * @{ */
   /**
-   * \description Kill all PiP tasks and then kill PiP root by the
-   * SIGABRT signal.
+   * \description
+   * Destroy the channel. A named channel is unexported when it is
+   * destroyed by the task which created it. No task may use the
+   * channel after this.
    *
-   * \author Atsushi Hori
+   * \param[in] ch channel
+   *
+   * \return Return 0 on success. Return an error code on error.
+   * \retval EINVAL \p ch is not a valid channel
+   * \retval EBUSY a task is sleeping on the channel
    */
-  void pip_abort(void);
+  int pip_channel_destroy( pip_channel_t *ch );
   /** @} */
 
   /**
-   * \defgroup pip_kill pip_kill
+   * \defgroup pip_channel_send pip_channel_send
    * @{ */
   /**
-   * \description 
-   * deliver a signal to PiP task
+   * \description
+   * Send a message, waiting while the channel is full.
+   * \ref pip_channel_trysend returns \p EAGAIN instead of waiting.
    *
-   * \param[out] pipid PiP ID of a target PiP task to deliver the signal
-   * \param[out] signal signal number to be delivered
+   * \param[in] ch channel
+   * \param[in] msg message to send
    *
    * \return Return 0 on success. Return an error code on error.
-   * \retval EPERM PiP library is not yet initialized
-   * \retval EINVAL An invalid signal number or invalid PiP ID is
-   * specified
+   * \retval EINVAL an argument is invalid
+   * \retval EAGAIN the channel is full (\ref pip_channel_trysend)
    *
-   * \sa tkill(Luinux 2)
-   *
-   * \author Atsushi Hori
+   * \sa pip_channel_recv
    */
-  int pip_kill( int pipid, int signal );
+  int pip_channel_send( pip_channel_t *ch, const void *msg );
+  int pip_channel_trysend( pip_channel_t *ch, const void *msg );
   /** @} */
 
   /**
-   * \defgroup pip_sigmask pip_sigmask
+   * \defgroup pip_channel_recv pip_channel_recv
    * @{ */
   /**
    * \description
-   * set signal mask of the current PiP task
-   * 
-   * \note
-   * This function is agnostic to the PiP execution mode.
+   * Receive a message, waiting while the channel is empty.
+   * \ref pip_channel_tryrecv returns \p EAGAIN instead of waiting.
    *
-   * \param[in] how see \b sigprogmask or \b pthread_sigmask
-   * \param[in] sigmask signal mask
-   * \param[out] oldmask old signal mask
+   * \param[in] ch channel
+   * \param[out] msg buffer to store the received message
    *
    * \return Return 0 on success. Return an error code on error.
-   * \retval EPERM PiP library is not yet initialized
-   * \retval EINVAL An invalid signal number or invalid PiP ID is
-   * specified
-   *
-   * \sa sigprocmask(Linux 2)
-   * \sa pthread_sigmask(Linux 3)
+   * \retval EINVAL an argument is invalid
+   * \retval EAGAIN the channel is empty (\ref pip_channel_tryrecv)
    *
-   * \author Atsushi Hori
+   * \sa pip_channel_send
    */
-  int pip_sigmask( int how, const sigset_t *sigmask, sigset_t *oldmask );
+  int pip_channel_recv( pip_channel_t *ch, void *msg );
+  int pip_channel_tryrecv( pip_channel_t *ch, void *msg );
   /** @} */
 
   /**
-   * \defgroup pip_signal_wait pip_signal_wait
+   * \defgroup pip_channel_send_n pip_channel_send_n
    * @{ */
   /**
    * \description
-   * This function is agnostic to the PiP execution mode.
+   * Send up to \p n consecutive messages at once without waiting.
+   * On an SPSC channel the sent messages are published to the
+   * receiver by a single store.
    *
-   * \param[in] signal signal to wait
+   * \param[in] ch channel
+   * \param[in] msgs array of messages to send
+   * \param[in] n number of messages
+   * \param[out] nsentp number of messages actually sent, if not
+   * \p NULL
    *
    * \return Return 0 on success. Return an error code on error.
+   * \retval EINVAL an argument is invalid
+   * \retval EAGAIN no message could be sent
    *
-   * \note This function does NOT return the \p EINTR error. This case
-   * is treated as normal return;
+   * \sa pip_channel_recv_n
+   */
+  int pip_channel_send_n( pip_channel_t *ch,
+			  const void *msgs,
+			  int n,
+			  int *nsentp );
+  /** @} */
+
+  /**
+   * \defgroup pip_channel_recv_n pip_channel_recv_n
+   * @{ */
+  /**
+   * \description
+   * Receive up to \p n messages at once without waiting.
    *
-   * \sa sigwait(Linux 3)
-   * \sa sigsuspend(Linux 2)
+   * \param[in] ch channel
+   * \param[out] msgs buffer to store the received messages
+   * \param[in] n maximum number of messages
+   * \param[out] nrecvp number of messages actually received, if
+   * not \p NULL
    *
-   * \author Atsushi Hori
+   * \return Return 0 on success. Return an error code on error.
+   * \retval EINVAL an argument is invalid
+   * \retval EAGAIN no message was available
+   *
+   * \sa pip_channel_send_n
    */
-  int pip_signal_wait( int signal );
+  int pip_channel_recv_n( pip_channel_t *ch,
+			  void *msgs,
+			  int n,
+			  int *nrecvp );
   /** @} */
   /** @} */
 
   /**
-   * \defgroup PiP-API6-sync API: Synchronization
+   * \defgroup PiP-API11-rndv API: Rendezvous Transfer
    * @{
    */
 
   /**
-   * \defgroup pip_yield pip_yield
+   * \defgroup pip_rndv_post pip_rndv_post
    * @{ */
   /**
-   * \description yield
+   * \description
+   * Post a receive buffer under the specified name. A sender calling
+   * \ref pip_rndv_send with the same name copies its message into
+   * \p buf directly, without any intermediate buffer. The posting
+   * is completed by calling \ref pip_rndv_wait.
    *
-   * \param[in] flag to specify the behavior of yielding. Unused and
-   * reserved for BLT/ULP (in PiP-v3)
+   * \param[out] rndvp pointer to the posted rendezvous
+   * \param[in] buf receive buffer
+   * \param[in] size size of the receive buffer in bytes
+   * \param[in] name name of the posting
    *
-   * \return Thuis function always succeeds and returns zero.
+   * \return Return 0 on success. Return an error code on error.
+   * \retval EPERM PiP library is not yet initialized or already
+   * finalized
+   * \retval EINVAL an argument is invalid
+   * \retval ENAMETOOLONG \p name is too long
+   * \retval ENOMEM not enough memory
+   * \retval EBUSY \p name is already posted by the calling task
    *
-   * \sa sched_yield(Linux 2)
-   * \sa pthread_yield(Linux 3)
+   * \note
+   * Only one sender may send to a posting. A posting which no sender
+   * has taken yet can be withdrawn by \ref pip_rndv_cancel.
    *
-   * \author Atsushi Hori
+   * \sa pip_rndv_send
+   * \sa pip_rndv_wait
+   * \sa pip_rndv_cancel
    */
-  int pip_yield( int flag );
+  int pip_rndv_post( pip_rndv_t **rndvp,
+		     void *buf,
+		     size_t size,
+		     const char *name );
   /** @} */
 
   /**
-   * \defgroup pip_barrier_init pip_barrier_init
+   * \defgroup pip_rndv_send pip_rndv_send
    * @{ */
   /**
-   * \description 
-   * initialize barrier synchronization structure
+   * \description
+   * Send a message to the receive buffer posted by the PiP task
+   * \p pipid. This blocks until the buffer is posted and returns
+   * when the whole message is copied. A large message is copied in
+   * chunks by both the sender and the waiting receiver, with
+   * non-temporal stores (see \ref pip_memcpy_nt).
    *
-   * \param[in] barrp pointer to a PiP barrier structure
-   * \param[in] n number of participants of this barrier synchronization
+   * \param[in] pipid PiP ID of the receiver
+   * \param[in] name name of the posting
+   * \param[in] buf message to send
+   * \param[in] size size of the message in bytes
    *
    * \return Return 0 on success. Return an error code on error.
+   * \retval EINVAL an argument is invalid
+   * \retval EMSGSIZE the message is larger than the receive buffer
+   * \retval EBUSY another sender is sending to the posting
+   * \retval ECANCELED the receiver terminated
    *
-   * \retval EPERM PiP library is not yet initialized or already
-   * finalized
-   * \retval EINAVL \c n is invalid
+   * \sa pip_rndv_post
+   */
+  int pip_rndv_send( int pipid,
+		     const char *name,
+		     const void *buf,
+		     size_t size );
+  /** @} */
+
+  /**
+   * \defgroup pip_rndv_wait pip_rndv_wait
+   * @{ */
+  /**
+   * \description
+   * Wait for the posted receive buffer to be filled. The posting is
+   * released and \p rndv must not be used after this.
    *
-   * \sa pip_barrier_wait
-   * \sa pip_barrier_fin
+   * \param[in] rndv posted rendezvous
+   * \param[out] sizep size of the received message, if not \p NULL
    *
-   * \author Atsushi Hori
+   * \return Return 0 on success. Return an error code on error.
+   * \retval EINVAL \p rndv is invalid
+   * \retval EPERM the calling task did not post \p rndv
+   *
+   * \sa pip_rndv_post
    */
-  int pip_barrier_init( pip_barrier_t *barrp, int n );
+  int pip_rndv_wait( pip_rndv_t *rndv, size_t *sizep );
   /** @} */
 
   /**
-   * \defgroup pip_barrier_wait pip_barrier_wait
+   * \defgroup pip_rndv_cancel pip_rndv_cancel
    * @{ */
   /**
-   * \description wait on barrier synchronization
+   * \description
+   * Withdraw the posted receive buffer which no sender has taken.
+   * The posting is released and \p rndv must not be used after this.
    *
-   * \param[in] barrp pointer to a PiP barrier structure
+   * \param[in] rndv posted rendezvous
    *
    * \return Return 0 on success. Return an error code on error.
+   * \retval EINVAL \p rndv is invalid
+   * \retval EPERM the calling task did not post \p rndv
+   * \retval EBUSY a sender has already taken the posting, call
+   * \ref pip_rndv_wait to complete it
    *
-   * \retval EPERM PiP library is not yet initialized or already
-   * finalized
+   * \sa pip_rndv_post
+   * \sa pip_rndv_wait
+   */
+  int pip_rndv_cancel( pip_rndv_t *rndv );
+  /** @} */
+
+  /**
+   * \defgroup pip_memcpy_nt pip_memcpy_nt
+   * @{ */
+  /**
+   * \description
+   * Same as \p memcpy, but large copies are done with non-temporal
+   * stores so that the destination does not pollute the caches of
+   * the calling core. This suits a copy to a buffer of another PiP
+   * task which is not read soon by the calling task.
    *
-   * \sa pip_barrier_init
-   * \sa pip_barrier_fin
+   * \param[out] dst destination
+   * \param[in] src source
+   * \param[in] sz number of bytes to copy
    *
-   * \author Atsushi Hori
+   * \return Return \p dst.
    */
-  int pip_barrier_wait( pip_barrier_t *barrp );
+  void *pip_memcpy_nt( void *dst, const void *src, size_t sz );
+  /** @} */
   /** @} */
 
   /**
-   * \defgroup pip_barrier_fin pip_barrier_fin
+   * \defgroup PiP-API12-event API: Event Loop Integration
+   * @{
+   */
+
+  /**
+   * \defgroup pip_get_wait_fd pip_get_wait_fd
    * @{ */
   /**
    * \description
-   * finalize barrier synchronization structure
+   * Get a file descriptor which becomes readable when a PiP task
+   * terminates or posts an event by \ref pip_post_event. The root
+   * can add this to its own \p poll, \p select or \p epoll set
+   * to manage PiP tasks without a dedicated thread. When it becomes
+   * readable, the root should call \ref pip_trywait_any until it
+   * returns \p ECHILD, and \ref pip_get_events. The descriptor must
+   * not be read or closed by the caller.
    *
-   * \param[in] barrp pointer to a PiP barrier structure
+   * \note
+   * In the process mode, a task is watched through a pidfd. If the
+   * pidfd cannot be opened, e.g., because of \p RLIMIT_NOFILE, the
+   * termination of that task does not make the descriptor readable
+   * and it is found only by \ref pip_wait_any or
+   * \ref pip_trywait_any.
+   *
+   * \param[out] fdp pointer to the file descriptor
+   *
+   * \return Return 0 on success. Return an error code on error.
+   * \retval EPERM the caller is not the PiP root
+   * \retval EINVAL \p fdp is \p NULL
+   * \retval ENOSYS the system does not support it
+   *
+   * \sa pip_post_event
+   * \sa pip_get_events
+   */
+  int pip_get_wait_fd( int *fdp );
+  /** @} */
+
+  /**
+   * \defgroup pip_post_event pip_post_event
+   * @{ */
+  /**
+   * \description
+   * Post an event to the PiP root. The root receives it by calling
+   * \ref pip_get_events, and the descriptor returned by
+   * \ref pip_get_wait_fd becomes readable.
+   *
+   * \param[in] value user-defined value of the event
    *
    * \return Return 0 on success. Return an error code on error.
    * \retval EPERM PiP library is not yet initialized or already
    * finalized
-   * \retval EBUSY there are some tasks wating for barrier
-   * synchronization
+   * \retval EAGAIN too many events are not yet received
    *
-   * \sa pip_barrier_init
-   * \sa pip_barrier_wait
+   * \note
+   * In process mode, the calling task must not close the file
+   * descriptors inherited from the root.
    *
-   * \author Atsushi Hori
+   * \sa pip_get_events
    */
-  int pip_barrier_fin( pip_barrier_t *barrp );
+  int pip_post_event( uint64_t value );
+  /** @} */
+
+  /**
+   * \defgroup pip_get_events pip_get_events
+   * @{ */
+  /**
+   * \description
+   * Receive the events posted by PiP tasks without blocking, in the
+   * order they are posted.
+   *
+   * \param[out] events array to store the received events
+   * \param[in] n maximum number of events to receive
+   * \param[out] neventsp number of received events, if not \p NULL
+   *
+   * \return Return 0 on success. Return an error code on error.
+   * \retval EPERM the caller is not the PiP root
+   * \retval EINVAL an argument is invalid
+   *
+   * \sa pip_post_event
+   * \sa pip_get_wait_fd
+   */
+  int pip_get_events( pip_event_t *events, int n, int *neventsp );
   /** @} */
   /** @} */
 
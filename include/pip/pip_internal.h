@@ -88,6 +88,7 @@ struct pip_spawn_args;
 #include <pip/pip.h>
 #include <pip/pip_libc_tab.h>
 #include <pip/pip_machdep.h>
+#include <pip/pip_sync.h>
 #include <pip/pip_clone.h>
 #include <pip/pip_debug.h>
 #include <pip/pip_dlfcn.h>
@@ -164,7 +165,7 @@ typedef struct pip_symbols {
   /* PiP-glibc */
   void			*pip_set_opts;
   /* reserved for future use */
-  void			*__reserved__[16]; /* reserved for future use */
+  void			*__reserved__[2]; /* reserved for future use */
 } pip_symbols_t;
 
 typedef struct pip_char_vec {
@@ -172,6 +173,24 @@ typedef struct pip_char_vec {
   char			*strs;
 } pip_char_vec_t;
 
+/* checked user program, cached by the root and looked up by the */
+/* name given to spawn (and PATH when the name has no slash)      */
+typedef struct pip_prog_cache {
+  struct pip_prog_cache	*next;
+  char			*prog;	    /* as specified */
+  char			*paths;	    /* PATH searched, or NULL */
+  char			*prog_full; /* realpath() */
+  char			*prog_base; /* basename */
+  dev_t			dev;
+  ino_t			ino;
+  struct timespec	mtime;
+  struct timespec	ctime;
+  /* start symbol, set by the root and resolved by ldpip */
+  char			*symbol;
+  int			sym_status; /* >0 if resolved */
+  intptr_t		sym_value;  /* offset from the load address */
+} pip_prog_cache_t;
+
 typedef struct pip_spawn_args {
   int			pipid;
   int			coreno;
@@ -186,9 +205,19 @@ typedef struct pip_spawn_args {
   pip_char_vec_t	envvec;
   struct pip_root	*pip_root;
   struct pip_task	*pip_task;
-  void			*__reserved__[14]; /* reserved for future use */
+  int			sync_deferred; /* root waits sync_spawn later */
+  pip_prog_cache_t	*prog_cache;
+  void			*__reserved__[2]; /* reserved for future use */
 } pip_spawn_args_t;
 
+/* name space loaded in advance by pip_task_spawn_prepare() */
+typedef struct pip_ns_template {
+  struct pip_ns_template	*next;
+  void			*loaded; /* ldpip */
+  Lmid_t		lmid;
+  pip_spawn_args_t	args;	 /* prog, env and start function */
+} pip_ns_template_t;
+
 /* The following env vars must be copied */
 /* if a PiP may have different env set.  */
 typedef struct pip_env {
@@ -214,7 +243,13 @@ typedef struct pip_env {
 struct pip_gdbif_task;
 struct pip_root;
 
+/* The fields written while the task is running, possibly by the */
+/* other tasks, are on their own cache blocks, apart from the     */
+/* read-mostly ones and from the adjacent tasks in tasks[].       */
+#define PIP_CACHE_ALIGNED	__attribute__((aligned(PIP_CACHEBLK_SZ)))
+
 typedef struct pip_task {
+  /* read-mostly, set when spawned */
   int			pipid;	 /* PiP ID */
   int			type;	 /* PIP_TYPE_TASK or PIP_TYPE_ULP */
   pid_t			pid;	/* PID in process mode */
@@ -234,9 +269,7 @@ typedef struct pip_task {
 
   pip_libc_ftab_t	*libc_ftabp;
 
-  int			flag_exit;
-  volatile int		flag_sigchld; /* termination in thread mode */
-  volatile int32_t	status;	   /* exit value */
+  int			pidfd;	      /* process mode, or -1 */
   int			retval;
 
   cpu_set_t 		cpuset;
@@ -249,19 +282,30 @@ typedef struct pip_task {
   char			*onstart_script;
   /* PiP-gdb interface */
   struct pip_gdbif_task	*gdbif_task;
-  /* malloc free list */
-  pip_atomic_t		malloc_free_list;
 
   sigset_t		*debug_signals;
-  /* reserved for future use */
   pip_start_task_t 	start_task;
-  void			*__reserved__[15];
+  /* memory placement */
+  int			numa_node;
+  void			*stack_map;
+  size_t		stack_mapsz;
+  /* task pool mailbox (see pip_taskpool.c) */
+  void			*pool_slot;
+  /* reserved for future use */
+  void			*__reserved__[2];
+
+  /* malloc free list, pushed by the other tasks */
+  pip_atomic_t		malloc_free_list PIP_CACHE_ALIGNED;
+
+  /* termination, written by the task and read by the root */
+  int			flag_exit PIP_CACHE_ALIGNED;
+  volatile int		flag_sigchld; /* termination in thread mode */
+  volatile int		flag_cq;      /* pushed onto the wait queue */
+  volatile int32_t	status;	   /* exit value */
 } pip_task_t;
 
 #define PIP_FILLER_SZ	(PIP_CACHE_SZ-sizeof(pip_spinlock_t))
 
-typedef sem_t		pip_sem_t;
-
 typedef struct pip_clone {
   pip_spinlock_t lock;	     /* lock */
 } pip_clone_t;
@@ -273,26 +317,6 @@ typedef struct pip_recursive_lock {
   pip_sem_t	semaphore;
 } pip_recursive_lock_t;
 
-INLINE void pip_sem_init( pip_sem_t *sem ) {
-  (void) sem_init( sem, 1, 0 );
-}
-
-INLINE void pip_sem_post( pip_sem_t *sem ) {
-  errno = 0;
-  (void) sem_post( sem );
-  ASSERTD( errno == 0 );
-}
-
-INLINE void pip_sem_wait( pip_sem_t *sem ) {
-  errno = 0;
-  (void) sem_wait( sem );
-  ASSERTD( errno == 0 || errno == EINTR );
-}
-
-INLINE void pip_sem_fin( pip_sem_t *sem ) {
-  (void) sem_destroy( sem );
-}
-
 INLINE void pip_recursive_lock_init( pip_recursive_lock_t *lock ) {
   memset( lock, 0, sizeof(pip_recursive_lock_t) );
   pip_sem_init( &lock->semaphore );
@@ -331,7 +355,11 @@ pip_recursive_lock_fin( pip_recursive_lock_t *lock ) {
   memset( lock, 0, sizeof(pip_recursive_lock_t) );
 }
 
+/* number of words of pip_root_t.tasks_busy for N tasks */
+#define PIP_BITMAP_NWORDS(N)	( ( (N) + 63 ) / 64 )
+
 typedef struct pip_root {
+  /* read-mostly, set by pip_init() */
   char			magic[PIP_MAGIC_LEN];
   unsigned int		version;
   size_t		size_whole;
@@ -342,45 +370,84 @@ typedef struct pip_root {
   unsigned int		opts;
   unsigned int		actual_mode;
   int			ntasks;
-  int			ntasks_count;
-  int			ntasks_curr;
-  int			ntasks_accum;
-  int			pipid_curr;
-
-  pip_sem_t		lock_clone;   /* lock for clone */
-  pip_sem_t		sync_spawn;   /* Spawn synch */
-
-  /* environments */
-  //pip_env_t		envs;
+  int			flag_quiet;
+  uint64_t		*tasks_busy; /* bitmap of occupied task slots */
   /* GDB Interface */
   struct pip_gdbif_root	*gdbif_root;
-
-  pip_spinlock_t	lock_bt; /* lock for backtrace */
   size_t		stack_size;
   pip_task_t		*task_root; /* points to tasks[ntasks] */
-  pip_spinlock_t	lock_tasks; /* lock for finding a new task id */
-
   char			*prefixdir;
+  /* environments */
+  //pip_env_t		envs;
+  cpu_set_t		maxset;
+  pip_clone_mostly_pthread_t pip_pthread_create;
+  /* glibc functions */
+  pip_libc_ftab_t	libc_ftab;
+  /* per-task malloc arenas (see pip_malloc.c) */
+  void			*arena_base;
+  size_t		arena_size; /* size of an arena per task */
+  unsigned int		mem_policy; /* PIP_MEM_* in pip_mem.h */
+  /* checked user programs (see pip_check_user_prog) */
+  pip_prog_cache_t	*prog_cache;
+  /* name spaces loaded in advance */
+  pip_ns_template_t	*ns_templates;
+  /* pipids of terminating tasks (see pip_wait.c) */
+  void			*wait_cq;
+  volatile uint32_t	wait_cq_nlost; /* pushes dropped by overflow */
+  /* events posted by pip_post_event() */
+  void			*event_q;
+  /* epoll set of pidfds and the eventfd, or -1 (see pip_wait.c) */
+  int			wait_epfd;
+  int			wait_evfd;
+  /* live tasks whose pidfd could not be opened */
+  int			ntasks_nopidfd;
+  /* reserved for future use */
+  void			*__reserved__[1];
 
-  int			flag_quiet;
+  /* task slots, written at spawn and termination */
+  pip_spinlock_t	lock_tasks PIP_CACHE_ALIGNED; /* finding a new task id */
+  int			ntasks_count;
+  int			ntasks_curr; /* live tasks, but the root */
+  int			ntasks_accum;
+  int			pipid_curr;
 
+  /* semaphores used while spawning */
+  pip_sem_t		lock_clone PIP_CACHE_ALIGNED; /* lock for clone */
+  pip_sem_t		sync_spawn;   /* Spawn synch */
   pip_sem_t		lock_sighand;
   pip_sem_t		lock_universal;
-  pip_recursive_lock_t	libc_lock; /* 5 64-bit words */
 
-  cpu_set_t		maxset;
+  pip_recursive_lock_t	libc_lock PIP_CACHE_ALIGNED; /* 5 64-bit words */
 
-  pip_clone_mostly_pthread_t pip_pthread_create;
+  pip_spinlock_t	lock_bt PIP_CACHE_ALIGNED; /* lock for backtrace */
 
-  /* glibc functions */
-  pip_libc_ftab_t	libc_ftab;
+  /* stacks of terminated tasks */
+  pip_spinlock_t	lock_stack PIP_CACHE_ALIGNED;
+  int			nstacks_pooled;
+  void			*stack_pool;
+
+  /* released rendezvous objects (see pip_rndv.c) */
+  pip_spinlock_t	lock_rndv PIP_CACHE_ALIGNED;
+  void			*rndv_pool;
 
-  /* reserved for future use */
-  void			*__reserved__[9];
   /* tasks */
   pip_task_t		tasks[];
 } pip_root_t;
 
+/* the first occupied task slot at or after from, or -1 */
+INLINE int pip_next_busy_task( pip_root_t *root, int from ) {
+  uint64_t	bits;
+  int		w = from / 64;
+
+  if( from >= root->ntasks ) return -1;
+  bits = root->tasks_busy[w] & ( ~0UL << ( from % 64 ) );
+  while( bits == 0 ) {
+    if( ++w >= PIP_BITMAP_NWORDS( root->ntasks ) ) return -1;
+    bits = root->tasks_busy[w];
+  }
+  return w * 64 + __builtin_ctzl( bits );
+}
+
 #ifndef __W_EXITCODE
 #define __W_EXITCODE(retval,signal)	( (retval) << 8 | (signal) )
 #endif
@@ -395,10 +462,22 @@ extern int  pip_is_effective( void ) PIP_PRIVATE;
 extern int  pip_is_finalized( void ) PIP_PRIVATE;
 extern int  pip_fin_task_implicitly( void );
 extern void pip_free_all( void ) PIP_PRIVATE;
+extern void pip_arena_init_root( pip_root_t* ) PIP_PRIVATE;
+extern void pip_arena_attach( pip_task_t* ) PIP_PRIVATE;
 extern void *pip_dlopen_unsafe( const char*, int ) PIP_PRIVATE;
 extern void *pip_dlsym_unsafe( void*, const char* ) PIP_PRIVATE;
 extern void pip_do_exit( pip_task_t*, int, uintptr_t ) PIP_PRIVATE;
 extern void pip_named_export_fin_all( pip_root_t* ) PIP_PRIVATE;
+extern void pip_named_export_reset( pip_task_t* ) PIP_PRIVATE;
+extern void pip_task_slot_release( pip_task_t* ) PIP_PRIVATE;
+extern void pip_wait_cq_init( pip_root_t* ) PIP_PRIVATE;
+extern void pip_wait_cq_fin( pip_root_t* ) PIP_PRIVATE;
+extern void pip_wait_cq_push( pip_root_t*, pip_task_t* ) PIP_PRIVATE;
+extern void pip_wait_fd_init( pip_root_t* ) PIP_PRIVATE;
+extern void pip_wait_fd_fin( pip_root_t* ) PIP_PRIVATE;
+extern void pip_wait_fd_add( pip_root_t*, pip_task_t* ) PIP_PRIVATE;
+extern void pip_wait_fd_notify( pip_root_t* ) PIP_PRIVATE;
+extern void pip_rndv_pool_fin( pip_root_t* ) PIP_PRIVATE;
 
 extern void pip_reset_task_struct( pip_task_t* ) PIP_PRIVATE;
 extern int  pip_tkill( int, int );
@@ -423,6 +502,11 @@ extern void pip_abort_handler( int ) PIP_PRIVATE;
 extern int  pip_kill_all_children_( int ) PIP_PRIVATE;
 
 extern void pip_onstart( pip_task_t* ) PIP_PRIVATE;
+extern int  pip_do_task_spawn_n( pip_spawn_program_t*, int, uint32_t,
+				 uint32_t, int*, pip_spawn_hook_t*,
+				 void(*)(pip_task_t*,int,void*),
+				 void* ) PIP_PRIVATE;
+extern int  pip_task_pool_serve( pip_task_t* ) PIP_PRIVATE;
 extern void pip_set_exit_status( pip_task_t*, int, int ) PIP_PRIVATE;
 extern void pip_annul_task( pip_task_t* ) PIP_PRIVATE;
 extern void pip_pthread_exit( void* ) PIP_PRIVATE;
@@ -431,7 +515,8 @@ extern int pip_debug_env( void ) PIP_PRIVATE;
 
 extern pid_t pip_gettid( void );
 extern int  pip_is_threaded_( void );
-extern void pip_page_alloc( size_t, void** );
+extern int  pip_page_alloc( size_t, void** );
+extern void pip_page_free( void* );
 extern int  pip_raise_signal( pip_task_t*, int );
 extern void pip_debug_on_exceptions( pip_root_t*, pip_task_t* );
 
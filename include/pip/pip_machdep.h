@@ -100,6 +100,12 @@ INLINE void pip_memory_barrier( void ) {
 }
 #endif
 
+#ifndef PIP_STREAM_COPY_BLOCK
+INLINE void pip_stream_copy_block( void *dst, const void *src ) {
+  __builtin_memcpy( dst, src, PIP_CACHEBLK_SZ );
+}
+#endif
+
 #ifndef PIP_SPIN_TRYLOCK_WV
 INLINE int pip_spin_trylock_wv( pip_spinlock_t *lock, pip_spinlock_t lv ) {
   return __sync_val_compare_and_swap( lock, 0, lv );
@@ -66,6 +66,27 @@ inline static void pip_memory_barrier(void) {
 }
 #define PIP_MEMORY_BARRIER
 
+/**** Non-temporal Copy ****/
+
+#include <emmintrin.h>
+
+/* copy a cache block bypassing the caches, dst must be aligned */
+inline static void pip_stream_copy_block( void *dst, const void *src ) {
+  __m128i	*d = (__m128i*) dst;
+  const __m128i	*s = (const __m128i*) src;
+  __m128i	x0, x1, x2, x3;
+
+  x0 = _mm_loadu_si128( s + 0 );
+  x1 = _mm_loadu_si128( s + 1 );
+  x2 = _mm_loadu_si128( s + 2 );
+  x3 = _mm_loadu_si128( s + 3 );
+  _mm_stream_si128( d + 0, x0 );
+  _mm_stream_si128( d + 1, x1 );
+  _mm_stream_si128( d + 2, x2 );
+  _mm_stream_si128( d + 3, x3 );
+}
+#define PIP_STREAM_COPY_BLOCK
+
 #include <asm/prctl.h>
 #include <sys/prctl.h>
 #include <stdio.h>
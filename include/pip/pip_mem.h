@@ -0,0 +1,153 @@
+/*
+ * $PIP_license: <Simplified BSD License>
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *     Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ * 
+ *     Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ * $
+ * $RIKEN_copyright: Riken Center for Computational Sceience (R-CCS),
+ * System Software Development Team, 2016-2022
+ * $
+ * $PIP_VERSION: Version 2.4.1$
+ *
+ * $Author: Atsushi Hori 
+ * Query:   procinproc-info@googlegroups.com
+ * User ML: procinproc-users@googlegroups.com
+ * $
+ */
+
+#ifndef _pip_mem_h_
+#define _pip_mem_h_
+
+#ifndef DOXYGEN_INPROGRESS
+
+/* memory placement policy (PIP_HUGEPAGE and PIP_NUMA environments) */
+#define PIP_MEM_THP		(0x1U)
+#define PIP_MEM_HUGETLB		(0x2U)
+#define PIP_MEM_NUMA		(0x4U)
+
+#define PIP_HUGEPAGE_SZ		(2UL*1024*1024)
+#define PIP_STACK_PREFAULT_SZ	(256UL*1024)
+
+#define PIP_NUMA_NONE		(-1)
+#define PIP_NUMA_INTERLEAVE	(-2)
+#define PIP_NUMA_NODES_MAX	(1024)
+
+unsigned int pip_mem_policy_env( void ) PIP_PRIVATE;
+int  pip_numa_node_of_cpu( int ) PIP_PRIVATE;
+int  pip_numa_node_of_cpuset( cpu_set_t* ) PIP_PRIVATE;
+void pip_mem_place( void*, size_t, unsigned int, int ) PIP_PRIVATE;
+void *pip_stack_alloc( size_t, unsigned int, int, size_t* ) PIP_PRIVATE;
+
+INLINE void pip_stack_free( void *map, size_t mapsz ) {
+  if( map != NULL ) (void) munmap( map, mapsz );
+}
+
+/* touch the top of a new stack where TLS and the first frames go */
+INLINE void pip_stack_prefault( void *map, size_t mapsz ) {
+  size_t pgsz = sysconf( _SC_PAGESIZE );
+  size_t sz   = ( mapsz - pgsz < PIP_STACK_PREFAULT_SZ ) ?
+    mapsz - pgsz : PIP_STACK_PREFAULT_SZ;
+  void   *top = map + mapsz - sz;
+  size_t off;
+
+#ifdef MADV_POPULATE_WRITE
+  if( madvise( top, sz, MADV_POPULATE_WRITE ) == 0 ) return;
+#endif
+  for( off=0; off<sz; off+=pgsz ) *(volatile char*)( top + off ) = 0;
+}
+
+/* free stacks are kept by the root, the descriptor is put */
+/* at the lowest usable address of the stack               */
+typedef struct pip_stack_desc {
+  struct pip_stack_desc	*next;
+  size_t		mapsz;
+  int			node;
+} pip_stack_desc_t;
+
+INLINE void *pip_stack_get( pip_root_t *root,
+			    size_t size,
+			    int node,
+			    size_t *mapszp ) {
+  size_t	   pgsz = sysconf( _SC_PAGESIZE );
+  pip_stack_desc_t *desc, **prevp;
+  void		   *map;
+
+  pip_spin_lock( &root->lock_stack );
+  for( prevp = (pip_stack_desc_t**) &root->stack_pool;
+       ( desc = *prevp ) != NULL;
+       prevp = &desc->next ) {
+    if( desc->mapsz - pgsz >= size &&
+	( !( root->mem_policy & PIP_MEM_NUMA ) || desc->node == node ) ) {
+      *prevp = desc->next;
+      root->nstacks_pooled --;
+      break;
+    }
+  }
+  pip_spin_unlock( &root->lock_stack );
+
+  if( desc != NULL ) {
+    *mapszp = desc->mapsz;
+    return (void*) desc - pgsz;
+  }
+  if( ( map = pip_stack_alloc( size, root->mem_policy, node, mapszp ) )
+      != NULL ) {
+    pip_stack_prefault( map, *mapszp );
+  }
+  return map;
+}
+
+INLINE void pip_stack_put( pip_root_t *root,
+			   void *map,
+			   size_t mapsz,
+			   int node ) {
+  size_t	   pgsz = sysconf( _SC_PAGESIZE );
+  pip_stack_desc_t *desc;
+
+  if( map == NULL ) return;
+  pip_spin_lock( &root->lock_stack );
+  if( root->nstacks_pooled < root->ntasks ) {
+    desc = (pip_stack_desc_t*) ( map + pgsz );
+    desc->mapsz = mapsz;
+    desc->node  = node;
+    desc->next  = root->stack_pool;
+    root->stack_pool = desc;
+    root->nstacks_pooled ++;
+    map = NULL;
+  }
+  pip_spin_unlock( &root->lock_stack );
+  pip_stack_free( map, mapsz );
+}
+
+INLINE void pip_stack_pool_fin( pip_root_t *root ) {
+  size_t	   pgsz = sysconf( _SC_PAGESIZE );
+  pip_stack_desc_t *desc, *next;
+
+  for( desc = root->stack_pool; desc != NULL; desc = next ) {
+    next = desc->next;
+    pip_stack_free( (void*) desc - pgsz, desc->mapsz );
+  }
+  root->stack_pool     = NULL;
+  root->nstacks_pooled = 0;
+}
+
+#endif /* DOXYGEN_INPROGRESS */
+
+#endif /* _pip_mem_h_ */
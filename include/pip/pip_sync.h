@@ -0,0 +1,186 @@
+/*
+ * $PIP_license: <Simplified BSD License>
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *     Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ * 
+ *     Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ * $
+ * $RIKEN_copyright: Riken Center for Computational Sceience (R-CCS),
+ * System Software Development Team, 2016-2022
+ * $
+ * $PIP_VERSION: Version 2.4.1$
+ *
+ * $Author: Atsushi Hori 
+ * Query:   procinproc-info@googlegroups.com
+ * User ML: procinproc-users@googlegroups.com
+ * $
+ */
+
+#ifndef _pip_sync_h_
+#define _pip_sync_h_
+
+#ifndef DOXYGEN_INPROGRESS
+
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <unistd.h>
+#include <limits.h>
+#include <time.h>
+
+#include <pip/pip.h>
+#include <pip/pip_machdep.h>
+
+/* spins before sleeping in the kernel */
+#define PIP_SYNC_SPIN		(100)
+
+#define PIP_RWLOCK_WRITER	(0x80000000U)
+
+/* All PiP tasks share the same address space in both of the thread */
+/* and process modes, so that the private futexes work among them   */
+
+INLINE int pip_futex_wait( volatile uint32_t *addr,
+			   uint32_t val,
+			   const struct timespec *timeout ) {
+  if( syscall( SYS_futex, addr, FUTEX_WAIT_PRIVATE, val,
+	       timeout, NULL, 0 ) < 0 ) return errno;
+  return 0;
+}
+
+/* deadline is an absolute CLOCK_MONOTONIC time, or NULL */
+INLINE int pip_futex_wait_until( volatile uint32_t *addr,
+				 uint32_t val,
+				 const struct timespec *deadline ) {
+  if( syscall( SYS_futex, addr, FUTEX_WAIT_BITSET_PRIVATE, val,
+	       deadline, NULL, FUTEX_BITSET_MATCH_ANY ) < 0 ) return errno;
+  return 0;
+}
+
+INLINE void pip_futex_wake( volatile uint32_t *addr, int n ) {
+  (void) syscall( SYS_futex, addr, FUTEX_WAKE_PRIVATE, n, NULL, NULL, 0 );
+}
+
+INLINE void pip_futex_wake_all( volatile uint32_t *addr ) {
+  pip_futex_wake( addr, INT_MAX );
+}
+
+/* convert a relative timeout to a deadline */
+INLINE struct timespec *pip_sync_deadline( const struct timespec *timeout,
+					   struct timespec *deadline ) {
+  if( timeout == NULL ) return NULL;
+  clock_gettime( CLOCK_MONOTONIC, deadline );
+  deadline->tv_sec  += timeout->tv_sec;
+  deadline->tv_nsec += timeout->tv_nsec;
+  if( deadline->tv_nsec >= 1000000000L ) {
+    deadline->tv_sec  ++;
+    deadline->tv_nsec -= 1000000000L;
+  }
+  return deadline;
+}
+
+/* semaphore, this is also used internally as pip_sem_t */
+
+typedef pip_semaphore_t		pip_sem_t;
+
+INLINE void pip_sem_init_n( pip_sem_t *sem, uint32_t n ) {
+  sem->count    = n;
+  sem->nwaiters = 0;
+}
+
+INLINE void pip_sem_init( pip_sem_t *sem ) {
+  pip_sem_init_n( sem, 0 );
+}
+
+INLINE int pip_sem_trywait( pip_sem_t *sem ) {
+  uint32_t c;
+  while( ( c = sem->count ) > 0 ) {
+    if( __sync_bool_compare_and_swap( &sem->count, c, c - 1 ) ) return 0;
+  }
+  return EAGAIN;
+}
+
+INLINE int pip_sem_wait_until( pip_sem_t *sem,
+			       const struct timespec *deadline ) {
+  int i, err = 0;
+
+  for( i=0; i<PIP_SYNC_SPIN; i++ ) {
+    if( pip_sem_trywait( sem ) == 0 ) return 0;
+    pip_pause();
+  }
+  (void) __sync_fetch_and_add( &sem->nwaiters, 1 );
+  while( pip_sem_trywait( sem ) != 0 ) {
+    if( pip_futex_wait_until( &sem->count, 0, deadline ) == ETIMEDOUT ) {
+      err = ETIMEDOUT;
+      break;
+    }
+  }
+  (void) __sync_fetch_and_sub( &sem->nwaiters, 1 );
+  return err;
+}
+
+INLINE void pip_sem_wait( pip_sem_t *sem ) {
+  (void) pip_sem_wait_until( sem, NULL );
+}
+
+INLINE void pip_sem_post( pip_sem_t *sem ) {
+  (void) __sync_fetch_and_add( &sem->count, 1 );
+  if( sem->nwaiters > 0 ) pip_futex_wake( &sem->count, 1 );
+}
+
+INLINE void pip_sem_fin( pip_sem_t *sem ) {
+  (void) sem;
+}
+
+/* mutex, 0:unlocked 1:locked 2:locked and maybe contended */
+
+INLINE void pip_mutex_init_( pip_mutex_t *mutex ) {
+  mutex->word = 0;
+}
+
+INLINE int pip_mutex_trylock_( pip_mutex_t *mutex ) {
+  return __sync_bool_compare_and_swap( &mutex->word, 0, 1 ) ? 0 : EBUSY;
+}
+
+INLINE void pip_mutex_lock_contended( pip_mutex_t *mutex ) {
+  while( __sync_lock_test_and_set( &mutex->word, 2 ) != 0 ) {
+    (void) pip_futex_wait( &mutex->word, 2, NULL );
+  }
+}
+
+INLINE void pip_mutex_lock_( pip_mutex_t *mutex ) {
+  int i;
+
+  for( i=0; i<PIP_SYNC_SPIN; i++ ) {
+    if( mutex->word == 0 && pip_mutex_trylock_( mutex ) == 0 ) return;
+    pip_pause();
+  }
+  pip_mutex_lock_contended( mutex );
+}
+
+INLINE void pip_mutex_unlock_( pip_mutex_t *mutex ) {
+  if( __sync_fetch_and_sub( &mutex->word, 1 ) != 1 ) {
+    mutex->word = 0;
+    pip_memory_barrier();
+    pip_futex_wake( &mutex->word, 1 );
+  }
+}
+
+#endif /* DOXYGEN_INPROGRESS */
+
+#endif /* _pip_sync_h_ */
@@ -37,6 +37,7 @@
 
 #include <pip/pip_internal.h>
 #include <pip/pip_common.h>
+#include <pip/pip_mem.h>
 
 #define CLONE_SYSCALL	"__clone"
 
@@ -152,6 +153,13 @@ static void *ldpip_dlsym( void *handle, const char *symbol ) {
   return addr;
 }
 
+static int ldpip_dlinfo( void *handle, int request, void *info ) {
+  ldpip_libc_lock();
+  int rv = dlinfo( handle, request, info );
+  ldpip_libc_unlock();
+  return rv;
+}
+
 static void ldpip_set_name( pip_root_t *root, pip_task_t *task ) {
   SET_NAME_BODY(root,task);
 }
@@ -416,6 +424,24 @@ static int ldpip_search_libpip_itr( struct dl_phdr_info *info,
   return 0;
 }
 
+/* without CLONE_FILES, a task inherits the pidfds of the other tasks */
+/* opened by the root (see pip_wait.c). They are closed here, before  */
+/* the root resumes, not to keep the others in the epoll set and not  */
+/* to consume the file descriptors of this task                       */
+static void ldpip_close_pidfds( pip_root_t *root, pip_task_t *task ) {
+  pip_task_t	*t;
+  int		i;
+
+  if( ( root->opts & PIP_MODE_MASK ) == PIP_MODE_PTHREAD ) return;
+  for( i = pip_next_busy_task( root, 0 );
+       i >= 0;
+       i = pip_next_busy_task( root, i + 1 ) ) {
+    t = &root->tasks[i];
+    if( t != task && t->pidfd >= 0 ) (void) close( t->pidfd );
+  }
+  if( root->wait_epfd >= 0 ) (void) close( root->wait_epfd );
+}
+
 static void *ldpip_load( void *vargs ) {
   pip_spawn_args_t *args = vargs;
   pip_root_t *root = args->pip_root;
@@ -432,6 +458,7 @@ static void *ldpip_load( void *vargs ) {
   task->pid    = getpid();
   task->tid    = ldpip_gettid();
   ldpip_set_name( root, task );
+  ldpip_close_pidfds( root, task );
   /* resume root after setting above variables */
   pip_sem_post( &root->sync_spawn );
   {
@@ -518,49 +545,43 @@ static size_t ldpip_stack_size( void ) {
   return sz;
 }
 
-static int ldpip_search_symbol( char*, void** );
+static int ldpip_search_symbol( char*, pip_spawn_args_t*, void*, void** );
 
-int __ldpip_load_prog( pip_root_t *root, 
-		       pip_task_t *task, 
-		       pip_spawn_args_t *args,
-		       char **warn_mesg,
-		       char **err_mesg ) {
+static pip_start_task_t	ldpip_start_task;
+static void		*ldpip_loaded;
+
+/* load libpip and the user program into this name space and */
+/* find the start function. no task is involved at this point */
+static int ldpip_prepare_prog( pip_spawn_args_t *args,
+			       char **warn_mesg,
+			       char **err_mesg ) {
   extern char **environ;
-  pip_clone_mostly_pthread_t libc_clone;
-  pip_start_task_t start_task;
   char **envv = args->envvec.vec;
   char *start_func;
   void *loaded;
   void *start;
-  size_t stack_size;
-  pid_t pid;
-  int narena, i, rv, err = 0;
-
-  ldpip_root = root;
-  ldpip_task = task;
+  int i, rv, err = 0;
 
   environ = NULL;
   for( i=0; envv[i]!=NULL; i++ ) putenv( envv[i] );
   /* from now on, getenv() can be called */
-  SETUP_MALLOC_ARENA_ENV( root->ntasks );
+  SETUP_MALLOC_ARENA_ENV( ldpip_root->ntasks );
   /* from now on, malloc() can be called */
   ldpip_libc_setup( args );
-  ldpip_set_libc_ftab( ldpip_task );
-  ldpip_print_maps( "LDPIP", ldpip_task->loaded );
+  ldpip_print_maps( "LDPIP", NULL );
 #ifdef PIP_PRELOAD
   ldpip_preload( getenv( PIP_ENV_PRELOAD ) );
 #endif
   ASSERT( ( loaded = ldpip_load_libpip() ) != NULL );
-  ASSERT( ( start_task = (pip_start_task_t) 
+  ASSERT( ( ldpip_start_task = (pip_start_task_t) 
 	    ldpip_dlsym( loaded, "__pip_start_task" ) ) != NULL );
-  ldpip_task->start_task = start_task;
   if( ( loaded =
 	ldpip_dlopen( args->prog_full, DLOPEN_FLAGS ) ) == NULL ) {
     err = ELIBEXEC;
     goto error;
   }
   ldpip_print_maps( "dlopen", loaded );
-  ldpip_task->loaded = loaded;
+  ldpip_loaded = loaded;
   /* in the following code, we cannot call dlsym() because the */
   /* dlsym() call in some glibc versions aborts, not returning */
   /* an error, when a symbol is not found. this happens when   */
@@ -570,7 +591,7 @@ int __ldpip_load_prog( pip_root_t *root,
   } else {
     start_func = args->funcname;
   }
-  rv = ldpip_search_symbol( start_func, &start );
+  rv = ldpip_search_symbol( start_func, args, loaded, &start );
   switch( rv ) {
   case LDPIP_ELF_GLOBAL:
     if( args->funcname == NULL ) {
@@ -609,8 +630,23 @@ int __ldpip_load_prog( pip_root_t *root,
     err = ENOEXEC;
     break;
   }
-  if( err ) goto error;
 
+ error:
+  return err;
+}
+
+/* create the task running the prepared program */
+static int ldpip_start_prog( pip_task_t *task, pip_spawn_args_t *args ) {
+  pip_root_t *root = ldpip_root;
+  pip_clone_mostly_pthread_t libc_clone;
+  size_t stack_size;
+  pid_t pid;
+  int err = 0;
+
+  ldpip_task = task;
+  ldpip_set_libc_ftab( task );
+  task->start_task = ldpip_start_task;
+  task->loaded     = ldpip_loaded;
   args->pip_root = root;
   args->pip_task = task;
 
@@ -639,7 +675,23 @@ int __ldpip_load_prog( pip_root_t *root,
     ASSERTD( pthread_attr_init( &attr )                             == 0 );
     ASSERTD( pthread_attr_setdetachstate( &attr, 
 					  PTHREAD_CREATE_JOINABLE ) == 0 );
-    ASSERTD( pthread_attr_setstacksize( &attr, stack_size )         == 0 );
+    {
+      /* stack from the root's pool, placed on the NUMA node */
+      /* and/or backed by hugepages if specified             */
+      size_t pgsz = sysconf( _SC_PAGESIZE );
+      void  *map;
+      size_t mapsz;
+
+      map = pip_stack_get( root, stack_size, task->numa_node, &mapsz );
+      if( map != NULL ) {
+	task->stack_map   = map;
+	task->stack_mapsz = mapsz;
+	ASSERTD( pthread_attr_setstack( &attr, map + pgsz, mapsz - pgsz )
+		 == 0 );
+      } else {
+	ASSERTD( pthread_attr_setstacksize( &attr, stack_size )     == 0 );
+      }
+    }
       
     DBGF( "tid=%d", tid );
       
@@ -656,181 +708,343 @@ int __ldpip_load_prog( pip_root_t *root,
 			  (void*) args );
     DBGF( "pthread_create()=%d", err );
   }
-  /* for synching */
-  pip_sem_wait( &ldpip_root->sync_spawn );
+  if( !err ) {
+    /* for synching, unless the root waits for a bunch of tasks */
+    if( !args->sync_deferred ) pip_sem_wait( &ldpip_root->sync_spawn );
+  } else if( task->stack_map != NULL ) {
+    pip_stack_put( root, task->stack_map, task->stack_mapsz,
+		   task->numa_node );
+    task->stack_map = NULL;
+  }
+  return err;
+}
 
- error:
+int __ldpip_load_prog( pip_root_t *root, 
+		       pip_task_t *task, 
+		       pip_spawn_args_t *args,
+		       char **warn_mesg,
+		       char **err_mesg ) {
+  int err;
+
+  ldpip_root = root;
+  ldpip_task = task;
+  if( ( err = ldpip_prepare_prog( args, warn_mesg, err_mesg ) ) == 0 ) {
+    err = ldpip_start_prog( task, args );
+  }
   return err;
 }
 
+/* the following two are for the name spaces loaded in advance */
+/* by pip_task_spawn_prepare()                                  */
+int __ldpip_prepare_prog( pip_root_t *root, 
+			  pip_spawn_args_t *args,
+			  char **warn_mesg,
+			  char **err_mesg ) {
+  ldpip_root = root;
+  return ldpip_prepare_prog( args, warn_mesg, err_mesg );
+}
+
+int __ldpip_start_prog( pip_root_t *root, 
+			pip_task_t *task, 
+			pip_spawn_args_t *args ) {
+  ldpip_root = root;
+  return ldpip_start_prog( task, args );
+}
+
 /* ---------------------------------------------------- */
 
-static int ldpip_read_elf64_header( int fd, Elf64_Ehdr *ehdr ) {
-  if( read( fd, ehdr, sizeof(Elf64_Ehdr) ) != sizeof(Elf64_Ehdr) ) {
-    return -1;
-  } else if( ehdr->e_ident[EI_MAG0] != ELFMAG0 ||
-	     ehdr->e_ident[EI_MAG1] != ELFMAG1 ||
-	     ehdr->e_ident[EI_MAG2] != ELFMAG2 ||
-	     ehdr->e_ident[EI_MAG3] != ELFMAG3 ) {
+/* the ELF file is mmap()ed read-only so that no section is copied */
+typedef struct {
+  void		*image;
+  size_t	size;
+  Elf64_Ehdr	*ehdr;
+} ldpip_elf64_t;
+
+static int ldpip_elf64_map( const char *fname, ldpip_elf64_t *elf ) {
+  struct stat stbuf;
+  Elf64_Ehdr  *ehdr;
+  int fd;
+
+  if( ( fd = open( fname, O_RDONLY ) ) < 0 ) return -1;
+  if( fstat( fd, &stbuf ) != 0 || stbuf.st_size < sizeof(Elf64_Ehdr) ) {
+    (void) close( fd );
     return -1;
-  } else if( ehdr->e_ident[EI_CLASS] != ELFCLASS64 ) {
+  }
+  elf->size  = stbuf.st_size;
+  elf->image = mmap( NULL, elf->size, PROT_READ, MAP_PRIVATE, fd, 0 );
+  (void) close( fd );
+  if( elf->image == MAP_FAILED ) return -1;
+
+  ehdr = elf->ehdr = (Elf64_Ehdr*) elf->image;
+  if( ehdr->e_ident[EI_MAG0]  != ELFMAG0            ||
+      ehdr->e_ident[EI_MAG1]  != ELFMAG1            ||
+      ehdr->e_ident[EI_MAG2]  != ELFMAG2            ||
+      ehdr->e_ident[EI_MAG3]  != ELFMAG3            ||
+      ehdr->e_ident[EI_CLASS] != ELFCLASS64         ||
+      ehdr->e_shentsize       != sizeof(Elf64_Shdr) ||
+      ehdr->e_shoff + sizeof(Elf64_Shdr) * ehdr->e_shnum > elf->size ) {
+    (void) munmap( elf->image, elf->size );
     return -1;
   }
   return 0;
 }
 
-static int ldpip_read_elf64_section_header( int fd,
-					    int nth,
-					    Elf64_Ehdr *ehdr,
-					    Elf64_Shdr *shdr ) {
-  off_t off = ehdr->e_shoff + ( ehdr->e_shentsize * nth );
-  if( pread( fd, shdr, sizeof(Elf64_Shdr), off ) != sizeof(Elf64_Shdr) ) {
-    return -1;
-  }
-  return 0;
+static void ldpip_elf64_unmap( ldpip_elf64_t *elf ) {
+  (void) munmap( elf->image, elf->size );
 }
 
-static int ldpip_read_elf64_dynamic_section( int fd,
-					     off_t offset,
-					     size_t size,
-					     Elf64_Dyn *dyns ) {
-  if( pread( fd, dyns, size, offset ) != size ) return -1;
-  return 0;
+static Elf64_Shdr *ldpip_elf64_section( ldpip_elf64_t *elf, int nth ) {
+  Elf64_Shdr *shdr;
+
+  if( nth <= 0 || nth >= elf->ehdr->e_shnum ) return NULL;
+  shdr = (Elf64_Shdr*) ( elf->image + elf->ehdr->e_shoff ) + nth;
+  if( shdr->sh_type == SHT_NOBITS ||
+      shdr->sh_offset + shdr->sh_size > elf->size ) return NULL;
+  return shdr;
 }
 
-static int ldpip_read_elf64_symbol_value( int fd,
-					  Elf64_Ehdr *ehdr,
-					  Elf64_Sym *sym,
-					  intptr_t *valp ) {
-  Elf64_Shdr 	shdr;
-  intptr_t 	val;
-  int 		err = 0;
-  
-  ldpip_read_elf64_section_header( fd, sym->st_shndx, ehdr, &shdr );
-  if( pread( fd, &val, sym->st_size, shdr.sh_offset+sym->st_value ) !=
-      sym->st_size ) {
-    err = -1;
-  } else {
-    *valp = val;
+static Elf64_Shdr *ldpip_elf64_find_section( ldpip_elf64_t *elf, int type ) {
+  Elf64_Shdr *shdr;
+  int i;
+
+  for( i=1; i<elf->ehdr->e_shnum; i++ ) {
+    shdr = (Elf64_Shdr*) ( elf->image + elf->ehdr->e_shoff ) + i;
+    if( shdr->sh_type == type ) return ldpip_elf64_section( elf, i );
   }
-  return err;
+  return NULL;
 }
 
-typedef struct {
-  char	*symbol;
-  void	*addr; 
-  int 	status;
-} ldpip_search_symbol_arg_t;
+#define LDPIP_ELF64_DATA(E,S)	((E)->image + (S)->sh_offset)
 
-static int ldpip_read_elf64( struct dl_phdr_info *info, size_t size, void *varg ) {
-  ldpip_search_symbol_arg_t *arg = (ldpip_search_symbol_arg_t*) varg;
-  Elf64_Ehdr 	ehdr;
-  Elf64_Shdr	shdr;
-  Elf64_Sym	*symtab, *sym;
-  const char 	*fname = info->dlpi_name;
-  char		*p, *strtab;
-  intptr_t	val;
-  void		*addr;
-  int		fd, i, j, nsyms, ith_sec, retv;
+static uint32_t ldpip_gnu_hash( const char *name ) {
+  uint32_t h = 5381;
 
-  ENTERF( "%s", fname );
-  p = strrchr( fname, '/' );
-  if( p != NULL ) {
-    /* ldpip itself has also main. so ignore this */
-    if( strcmp( p+1, LDPIP_NAME  ) == 0 ||
-	strcmp( p+1, PIPLIB_NAME ) == 0 ) {
-      RETURN_NE( 0 );
-    }
+  for( ; *name!='\0'; name++ ) h = ( h << 5 ) + h + (unsigned char) *name;
+  return h;
+}
+
+static uint32_t ldpip_sysv_hash( const char *name ) {
+  uint32_t h = 0, g;
+
+  for( ; *name!='\0'; name++ ) {
+    h = ( h << 4 ) + (unsigned char) *name;
+    if( ( g = h & 0xf0000000 ) != 0 ) h ^= g >> 24;
+    h &= ~g;
   }
-  if( ( fd = open( fname, O_RDONLY ) )     <  0 ||
-      ldpip_read_elf64_header( fd, &ehdr ) != 0 ) {
-    arg->status = LDPIP_ELF_ERROR;
-    RETURN_NE( 0 );
+  return h;
+}
+
+/* look up an exported symbol by .gnu.hash, or .hash if no .gnu.hash */
+static Elf64_Sym *ldpip_elf64_lookup_dynsym( ldpip_elf64_t *elf,
+					     const char *name ) {
+  Elf64_Shdr	*hsec, *symsec, *strsec;
+  Elf64_Sym	*syms, *sym;
+  uint32_t	*hdr, *buckets, *chain, h, i;
+  char		*strs;
+  size_t	nsyms;
+
+  if( ( hsec = ldpip_elf64_find_section( elf, SHT_GNU_HASH ) ) == NULL &&
+      ( hsec = ldpip_elf64_find_section( elf, SHT_HASH     ) ) == NULL ) {
+    return NULL;
   }
-  symtab = NULL;
-  strtab = NULL;
-  retv   = 0;
-  nsyms  = 0;
-  for( i=0; i<ehdr.e_shnum; i++ ) {
-    if( ldpip_read_elf64_section_header( fd, i, &ehdr, &shdr ) != 0 ) {
-      goto try_next;
-    }
-    if( shdr.sh_type != SHT_SYMTAB ) continue;
-    
-    nsyms  = shdr.sh_size / sizeof(Elf64_Sym);
-    symtab = (Elf64_Sym*) malloc( shdr.sh_size );
-    ASSERT( symtab != NULL );
-    if( pread( fd, symtab, shdr.sh_size, shdr.sh_offset ) !=
-	shdr.sh_size ) {
-      goto try_next;
-    }
-    if( ldpip_read_elf64_section_header( fd,
-					 shdr.sh_link,
-					 &ehdr,
-					 &shdr ) != 0 ) {
-      goto try_next;
+  if( ( symsec = ldpip_elf64_section( elf, hsec->sh_link   ) ) == NULL ||
+      ( strsec = ldpip_elf64_section( elf, symsec->sh_link ) ) == NULL ||
+      symsec->sh_type != SHT_DYNSYM ||
+      hsec->sh_size < sizeof(uint32_t) * 4 ) {
+    return NULL;
+  }
+  syms  = (Elf64_Sym*) LDPIP_ELF64_DATA( elf, symsec );
+  nsyms = symsec->sh_size / sizeof(Elf64_Sym);
+  strs  = (char*)      LDPIP_ELF64_DATA( elf, strsec );
+  hdr   = (uint32_t*)  LDPIP_ELF64_DATA( elf, hsec   );
+
+  if( hsec->sh_type == SHT_GNU_HASH ) {
+    uint32_t nbuckets    = hdr[0];
+    uint32_t symoffset   = hdr[1];
+    uint32_t bloom_size  = hdr[2];
+    uint32_t bloom_shift = hdr[3];
+    uint64_t *bloom      = (uint64_t*) &hdr[4];
+    uint64_t word, mask;
+
+    if( nbuckets == 0 || bloom_size == 0 ) return NULL;
+    buckets = (uint32_t*) &bloom[bloom_size];
+    chain   = &buckets[nbuckets];
+    if( (void*) chain > (void*) hdr + hsec->sh_size ) return NULL;
+
+    h    = ldpip_gnu_hash( name );
+    word = bloom[ ( h / 64 ) % bloom_size ];
+    mask = ( 1UL << ( h % 64 ) ) | ( 1UL << ( ( h >> bloom_shift ) % 64 ) );
+    if( ( word & mask ) != mask ) return NULL; /* surely not here */
+    if( ( i = buckets[ h % nbuckets ] ) < symoffset ) return NULL;
+    for( ; i<nsyms; i++ ) {
+      uint32_t h2 = chain[ i - symoffset ];
+      sym = &syms[i];
+      if( ( h | 1 ) == ( h2 | 1 ) &&
+	  sym->st_name < strsec->sh_size &&
+	  strcmp( name, strs + sym->st_name ) == 0 ) return sym;
+      if( h2 & 1 ) break;	/* end of chain */
     }
-    strtab = (char*) malloc( shdr.sh_size );
-    ASSERT( strtab != NULL );
-    if( pread( fd, strtab, shdr.sh_size, shdr.sh_offset ) != shdr.sh_size ) {
-      goto try_next;
+  } else {
+    uint32_t nbucket = hdr[0];
+    uint32_t nchain  = hdr[1];
+
+    if( nbucket == 0 ) return NULL;
+    buckets = &hdr[2];
+    chain   = &buckets[nbucket];
+    if( (void*) &chain[nchain] > (void*) hdr + hsec->sh_size ) return NULL;
+    for( i = buckets[ ldpip_sysv_hash( name ) % nbucket ];
+	 i != STN_UNDEF && i < nchain && i < nsyms;
+	 i = chain[i] ) {
+      sym = &syms[i];
+      if( sym->st_name < strsec->sh_size &&
+	  strcmp( name, strs + sym->st_name ) == 0 ) return sym;
     }
-    break;
   }
-  if( symtab == NULL || strtab == NULL ) {
-    arg->status = LDPIP_ELF_ERROR;
-    goto try_next;
+  return NULL;
+}
+
+typedef struct {
+  char		*symbol;
+  char		*prog_full;
+  void		*addr; 
+  intptr_t	value;
+  int 		status;
+  int		in_prog;
+} ldpip_search_symbol_arg_t;
+
+static void ldpip_elf64_found( ldpip_search_symbol_arg_t *arg,
+			       struct dl_phdr_info *info,
+			       Elf64_Sym *sym,
+			       int status ) {
+  arg->value   = (intptr_t) sym->st_value;
+  arg->addr    = (void*) info->dlpi_addr + arg->value;
+  arg->in_prog = ( strcmp( info->dlpi_name, arg->prog_full ) == 0 );
+  arg->status  = status;
+}
+
+/* linear scan of .symtab to find a symbol not exported (local, */
+/* or global but not linked with the '-rdynamic' option)        */
+static int ldpip_elf64_scan_symtab( ldpip_elf64_t *elf,
+				    struct dl_phdr_info *info,
+				    ldpip_search_symbol_arg_t *arg ) {
+  Elf64_Shdr	*symsec, *strsec;
+  Elf64_Sym	*sym;
+  char		*strtab, *name;
+  int		j, nsyms;
+
+  if( ( symsec = ldpip_elf64_find_section( elf, SHT_SYMTAB ) ) == NULL ||
+      ( strsec = ldpip_elf64_section( elf, symsec->sh_link ) ) == NULL ) {
+    if( arg->status == 0 ) arg->status = LDPIP_ELF_ERROR;
+    return 0;
   }
+  sym    = (Elf64_Sym*) LDPIP_ELF64_DATA( elf, symsec );
+  nsyms  = symsec->sh_size / sizeof(Elf64_Sym);
+  strtab = (char*)      LDPIP_ELF64_DATA( elf, strsec );
 
-  sym = symtab;
   for( j=0; j<nsyms; j++,sym++ ) {
     if( ELF64_ST_TYPE(sym->st_info) != STT_FUNC ) continue;
-    char *name = strtab + sym->st_name;
+    if( sym->st_name >= strsec->sh_size ) continue;
+    name = strtab + sym->st_name;
     if( *name == '\0' ) continue;
-    //DBGF( "%s : '%s' : %d", fname, name, ELF64_ST_TYPE(sym->st_info) );
     if( strcmp( name, arg->symbol ) != 0 ) continue;
-    val  = (intptr_t) sym->st_value;
-    addr = (void*) info->dlpi_addr + val;
-      
+
     switch( ELF64_ST_BIND(sym->st_info) ) {
     case STB_GLOBAL:
-      //DBGF( "%s : '%s' : GLOBAL (%p)", fname, name, (void*)val );
-      arg->addr   = addr;
-      arg->status = LDPIP_ELF_GLOBAL;
-      retv = 1;		/* discontinue */
-      break;
+      ldpip_elf64_found( arg, info, sym, LDPIP_ELF_GLOBAL );
+      return 1;			/* discontinue */
     case STB_LOCAL:
-      //DBGF( "%s : '%s' : LOCAL", fname, name );
       if( arg->status == LDPIP_ELF_LOCAL ) {
 	/* another symbol found */
 	arg->addr   = NULL;
 	arg->status = LDPIP_ELF_MULTI_LOCAL;
-	retv = 1;		/* discontinue */
-      } else {
-	arg->addr   = addr;
-	arg->status = LDPIP_ELF_LOCAL;
-	/* continue to check if multiple defined */
+	return 1;		/* discontinue */
       }
+      ldpip_elf64_found( arg, info, sym, LDPIP_ELF_LOCAL );
+      /* continue to check if multiple defined */
       break;
     default:
-      DBGF( "%s : '%s' : (something else)", fname, name );
+      DBGF( "%s : '%s' : (something else)", info->dlpi_name, name );
     }
-    if( retv ) break;;
   }
- try_next:
-  free( symtab );
-  free( strtab );
-  (void) close( fd );
+  return 0;
+}
+
+static int ldpip_read_elf64( struct dl_phdr_info *info, size_t size, void *varg ) {
+  ldpip_search_symbol_arg_t *arg = (ldpip_search_symbol_arg_t*) varg;
+  ldpip_elf64_t	elf;
+  Elf64_Sym	*sym;
+  const char 	*fname = info->dlpi_name;
+  char		*p;
+  int		retv;
+
+  ENTERF( "%s", fname );
+  p = strrchr( fname, '/' );
+  if( p != NULL ) {
+    /* ldpip itself has also main. so ignore this */
+    if( strcmp( p+1, LDPIP_NAME  ) == 0 ||
+	strcmp( p+1, PIPLIB_NAME ) == 0 ) {
+      RETURN_NE( 0 );
+    }
+  }
+  if( ldpip_elf64_map( fname, &elf ) != 0 ) {
+    if( arg->status == 0 ) arg->status = LDPIP_ELF_ERROR;
+    RETURN_NE( 0 );
+  }
+  sym = ldpip_elf64_lookup_dynsym( &elf, arg->symbol );
+  if( sym != NULL &&
+      sym->st_shndx != SHN_UNDEF &&
+      ELF64_ST_TYPE(sym->st_info) == STT_FUNC &&
+      ELF64_ST_BIND(sym->st_info) == STB_GLOBAL ) {
+    ldpip_elf64_found( arg, info, sym, LDPIP_ELF_GLOBAL );
+    retv = 1;			/* discontinue */
+  } else {
+    retv = ldpip_elf64_scan_symtab( &elf, info, arg );
+  }
+  ldpip_elf64_unmap( &elf );
   RETURN_NE( retv );
 }
 
-static int ldpip_search_symbol( char *symbol, void **addrp ) {
+static int ldpip_search_symbol( char *symbol,
+				pip_spawn_args_t *args,
+				void *loaded,
+				void **addrp ) {
+  pip_prog_cache_t *pc = args->prog_cache;
   ldpip_search_symbol_arg_t arg;
-  arg.symbol = symbol;
-  arg.addr   = NULL;
-  arg.status = 0;
+  struct link_map *lm;
+
+  /* the same program has been spawned and the symbol found in */
+  /* the program itself, only the load address differs         */
+  if( pc != NULL && pc->sym_status > 0 &&
+      ldpip_dlinfo( loaded, RTLD_DI_LINKMAP, &lm ) == 0 ) {
+    DBGF( "cached: %s %p+%p", symbol, (void*) lm->l_addr,
+	  (void*) pc->sym_value );
+    *addrp = (void*) lm->l_addr + pc->sym_value;
+    return pc->sym_status;
+  }
+  arg.symbol    = symbol;
+  arg.prog_full = args->prog_full;
+  arg.addr      = NULL;
+  arg.value     = 0;
+  arg.status    = 0;
+  arg.in_prog   = 0;
+#ifdef DEBUG
+  struct timespec ts0, ts1;
+  clock_gettime( CLOCK_MONOTONIC, &ts0 );
+#endif
   dl_iterate_phdr( ldpip_read_elf64, (void*) &arg );
-  if( arg.status > 0 ) *addrp = arg.addr;
+#ifdef DEBUG
+  clock_gettime( CLOCK_MONOTONIC, &ts1 );
+  DBGF( "%s: status:%d  %ld usec", symbol, arg.status,
+	( ts1.tv_sec  - ts0.tv_sec  ) * 1000000L +
+	( ts1.tv_nsec - ts0.tv_nsec ) / 1000L );
+#endif
+  if( arg.status > 0 ) {
+    *addrp = arg.addr;
+    if( pc != NULL && arg.in_prog ) {
+      pc->sym_value  = arg.value;
+      pc->sym_status = arg.status;
+    }
+  }
   return arg.status;
 }
 
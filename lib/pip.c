@@ -35,6 +35,7 @@
 
 #include <pip/pip_internal.h>
 #include <pip/pip_common.h>
+#include <pip/pip_mem.h>
 #include <pip/pip_util.h>
 #include <pip/pip_gdbif.h>
 
@@ -64,22 +65,83 @@ static void pip_init_section( void ) {
 #endif
 
 #define ROUNDUP(X,Y)		((((X)+(Y)-1)/(Y))*(Y))
-void pip_page_alloc( size_t sz, void **allocp ) {
-  size_t pgsz;
+/* the header of a pip_page_alloc()ed region, put on the page */
+/* just below the returned address                             */
+typedef struct pip_page_hdr {
+  void		*map;
+  size_t	mapsz;
+} pip_page_hdr_t;
+
+/* Fresh pages are mapped so that the placement policy is */
+/* applied before the first touch, the memory allocated by */
+/* the (pip_)malloc may have been touched already          */
+int pip_page_alloc( size_t sz, void **allocp ) {
+  pip_page_hdr_t *hdr;
+  unsigned int	policy;
+  size_t	pgsz, align, mapsz;
+  void		*map, *addr;
 
   if( pip_root == NULL ) {
     pgsz = sysconf( _SC_PAGESIZE );
     pgsz = ( pgsz <= 0 ) ? 4096 : pgsz;
+    policy = pip_mem_policy_env();
   } else if ( pip_root->page_size == 0 ) {
     pgsz = sysconf( _SC_PAGESIZE );
     pgsz = ( pgsz <= 0 ) ? 4096 : pgsz;
     pip_root->page_size = pgsz;
+    policy = pip_root->mem_policy;
   } else {
     pgsz = pip_root->page_size;
+    policy = pip_root->mem_policy;
   }
-  sz = ROUNDUP( sz, pgsz );
-  ASSERT( pip_posix_memalign( allocp, pgsz, sz ) == 0 &&
-	  *allocp != NULL );
+  align = pgsz;
+  if( ( policy & PIP_MEM_THP ) && sz >= PIP_HUGEPAGE_SZ ) {
+    align = PIP_HUGEPAGE_SZ;
+  }
+  sz = ROUNDUP( sz, align );
+  /* one more page for the header, and the room for the alignment */
+  mapsz = sz + pgsz + ( align - pgsz );
+  map = mmap( NULL, mapsz, PROT_READ | PROT_WRITE,
+	      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+  if( map == MAP_FAILED ) return ENOMEM;
+  addr = (void*) ROUNDUP( (uintptr_t) map + pgsz, align );
+  hdr  = (pip_page_hdr_t*) addr - 1;
+  hdr->map   = map;
+  hdr->mapsz = mapsz;
+  /* tables shared by all tasks are interleaved, */
+  /* this must be done before the first touch    */
+  pip_mem_place( addr, sz, policy, PIP_NUMA_INTERLEAVE );
+  *allocp = addr;
+  return 0;
+}
+
+void pip_page_free( void *addr ) {
+  pip_page_hdr_t *hdr;
+
+  if( addr == NULL ) return;
+  hdr = (pip_page_hdr_t*) addr - 1;
+  (void) munmap( hdr->map, hdr->mapsz );
+}
+
+static void pip_stack_pool_init( pip_root_t *root ) {
+  char	 *env = getenv( PIP_ENV_STACK_POOL );
+  void	 *map;
+  size_t mapsz;
+  int	 n;
+
+  pip_spin_init( &root->lock_stack );
+  if( env == NULL ) return;
+  n = strtol( env, NULL, 10 );
+  if( n > root->ntasks ) n = root->ntasks;
+  for( ; n>0; n-- ) {
+    if( ( map = pip_stack_alloc( root->stack_size,
+				 root->mem_policy,
+				 PIP_NUMA_NONE,
+				 &mapsz ) ) == NULL ) break;
+    pip_stack_prefault( map, mapsz );
+    pip_stack_put( root, map, mapsz, PIP_NUMA_NONE );
+  }
+  DBGF( "%d stacks are pooled", root->nstacks_pooled );
 }
 
 static int pip_count_vec( char **vecsrc ) {
@@ -94,12 +156,17 @@ static void pip_set_magic( pip_root_t *root ) {
 
 void pip_reset_task_struct( pip_task_t *task ) {
   pip_root_t	*root = task->task_root;
-  void		*namexp = task->named_exptab;
+  void		*namexp;
+
+  pip_named_export_reset( task );
+  namexp = task->named_exptab;
   memset( (void*) task, 0, sizeof(pip_task_t) );
   task->pipid        = PIP_PIPID_NULL;
   task->type         = PIP_TYPE_NULL;
   task->task_root    = root;
   task->named_exptab = namexp;
+  task->numa_node    = PIP_NUMA_NONE;
+  task->pidfd        = -1;
 }
 
 const char *pip_get_mode_str( void ) {
@@ -306,7 +373,6 @@ static void pip_max_cpuset( pip_root_t *root ) {
 }
 
 int pip_init( int *pipidp, int *ntasksp, void **rt_expp, int opts ) {
-  void pip_named_export_init( pip_task_t* );
   pip_root_t	*root;
   size_t	sz;
   int		ntasks;
@@ -321,7 +387,7 @@ int pip_init( int *pipidp, int *ntasksp, void **rt_expp, int opts ) {
     DBGF( "ROOT ROOT ROOT" );
     /* root process */
     if( ntasksp == NULL ) {
-      ntasks = PIP_NTASKS_MAX;
+      ntasks = PIP_NTASKS_DEFAULT;
     } else {
       ntasks = *ntasksp;
     }
@@ -329,8 +395,9 @@ int pip_init( int *pipidp, int *ntasksp, void **rt_expp, int opts ) {
     if( ntasks > PIP_NTASKS_MAX ) RETURN( EOVERFLOW );
     if( ( err = pip_check_opt_and_env( &opts ) ) != 0 ) RETURN( err );
 
-    sz = sizeof( pip_root_t ) + sizeof( pip_task_t ) * ( ntasks + 1 );
-    pip_page_alloc( sz, (void**) &root );
+    sz = sizeof( pip_root_t ) + sizeof( pip_task_t ) * ( ntasks + 1 ) +
+      sizeof( uint64_t ) * PIP_BITMAP_NWORDS( ntasks );
+    if( ( err = pip_page_alloc( sz, (void**) &root ) ) != 0 ) RETURN( err );
     (void) memset( root, 0, sz );
     pip_set_magic( root );
     root->size_whole = sz;
@@ -338,6 +405,7 @@ int pip_init( int *pipidp, int *ntasksp, void **rt_expp, int opts ) {
     root->size_task  = sizeof( pip_task_t );
 
     pip_spin_init( &root->lock_tasks   );
+    pip_spin_init( &root->lock_rndv    );
     pip_recursive_lock_init( &root->libc_lock );
     pip_sem_init( &root->lock_clone );
     pip_sem_post( &root->lock_clone );
@@ -348,6 +416,8 @@ int pip_init( int *pipidp, int *ntasksp, void **rt_expp, int opts ) {
     pip_sem_post( &root->lock_universal );
 
     pip_max_cpuset( root );
+    root->mem_policy   = pip_mem_policy_env();
+    root->stack_size   = PIP_STACK_SIZE;
     root->prefixdir    = pip_prefix_dir();
     root->flag_quiet   = ( getenv( PIP_ENV_QUIET ) != NULL );
     root->version      = PIP_API_VERSION;
@@ -356,12 +426,12 @@ int pip_init( int *pipidp, int *ntasksp, void **rt_expp, int opts ) {
     root->opts         = opts;
     root->page_size    = sysconf( _SC_PAGESIZE );
     root->task_root    = &root->tasks[ntasks];
+    root->tasks_busy   = (uint64_t*) &root->tasks[ntasks+1];
     if( rt_expp != NULL ) {
       root->export_root  = *rt_expp;
     }
     for( i=0; i<ntasks+1; i++ ) {
       pip_reset_task_struct( &root->tasks[i] );
-      pip_named_export_init( &root->tasks[i] );
     }
     pipid = PIP_PIPID_ROOT;
     root->task_root->pipid      = pipid;
@@ -376,6 +446,10 @@ int pip_init( int *pipidp, int *ntasksp, void **rt_expp, int opts ) {
     pip_root = root;
 
     pip_set_name( pip_root, pip_task );
+    pip_arena_init_root( root );
+    pip_stack_pool_init( root );
+    pip_wait_cq_init( root );
+    pip_wait_fd_init( root );
     pip_dont_wrap_malloc = 0;
 
     if( opts & PIP_MODE_PTHREAD ) {
@@ -591,13 +665,22 @@ static int pip_copy_env( char **envsrc, int pipid, pip_char_vec_t *vecp ) {
   return pip_copy_vec( addenv, envsrc, vecp );
 }
 
+static void pip_prog_cache_fin( pip_root_t* );
+static void pip_ns_template_fin( pip_root_t* );
+
 void pip_finalize_root( pip_root_t *root ) {
   if( root != NULL ) {
     pip_named_export_fin_all( root );
+    pip_stack_pool_fin( root );
+    pip_rndv_pool_fin( root );
+    pip_ns_template_fin( root );
+    pip_prog_cache_fin( root );
+    pip_wait_cq_fin( root );
+    pip_wait_fd_fin( root );
   }
   pip_unset_signal_handlers();
 
-  pip_free( root );
+  pip_page_free( root );
   pip_root = NULL;
   pip_task = NULL;
 }
@@ -654,9 +737,24 @@ static char *pip_onstart_target( pip_task_t *task, char *env ) {
   return NULL;
 }
 
+INLINE int pip_task_slot_is_busy( int pipid ) {
+  return ( pip_root->tasks_busy[ pipid / 64 ] >> ( pipid % 64 ) ) & 1;
+}
+
+/* called when the task slot becomes free */
+void pip_task_slot_release( pip_task_t *task ) {
+  int pipid = task->pipid;
+
+  if( pip_root == NULL || pipid < 0 || pipid >= pip_root->ntasks ) return;
+  (void) __sync_fetch_and_and( &pip_root->tasks_busy[ pipid / 64 ],
+			       ~( 1UL << ( pipid % 64 ) ) );
+}
+
 static int pip_find_a_free_task( int *pipidp ) {
-  int pipid = *pipidp;
-  int err = 0;
+  uint64_t	bits;
+  int		pipid = *pipidp;
+  int		nwords, w0, w, k;
+  int		err = 0;
 
   if( pipid < PIP_PIPID_ANY || pipid >= pip_root->ntasks ) {
     DBGF( "pipid=%d", pipid );
@@ -667,29 +765,31 @@ static int pip_find_a_free_task( int *pipidp ) {
   /*** begin lock region ***/
   do {
     if( pipid != PIP_PIPID_ANY ) {
-      if( pip_root->tasks[pipid].type != PIP_TYPE_NULL ) {
+      if( pip_root->tasks[pipid].type != PIP_TYPE_NULL ||
+	  pip_task_slot_is_busy( pipid ) ) {
 	err = EAGAIN;
 	goto unlock;
       }
     } else {
-      int i;
-
-      for( i=pip_root->pipid_curr; i<pip_root->ntasks; i++ ) {
-	if( pip_root->tasks[i].type == PIP_TYPE_NULL ) {
-	  pipid = i;
-	  goto found;
-	}
-      }
-      for( i=0; i<pip_root->pipid_curr; i++ ) {
-	if( pip_root->tasks[i].type == PIP_TYPE_NULL ) {
-	  pipid = i;
-	  goto found;
+      /* look for a free slot 64 slots at a time, starting from */
+      /* the one next to the last allocated, and wrapping around */
+      nwords = PIP_BITMAP_NWORDS( pip_root->ntasks );
+      w0     = pip_root->pipid_curr / 64;
+      for( k=0; k<=nwords; k++ ) {
+	w    = ( w0 + k ) % nwords;
+	bits = ~pip_root->tasks_busy[w];
+	if( k == 0 ) bits &= ~0UL << ( pip_root->pipid_curr % 64 );
+	if( bits != 0 ) {
+	  pipid = w * 64 + __builtin_ctzl( bits );
+	  if( pipid < pip_root->ntasks ) goto found;
 	}
       }
       err = EAGAIN;
       goto unlock;
     }
   found:
+    (void) __sync_fetch_and_or( &pip_root->tasks_busy[ pipid / 64 ],
+				1UL << ( pipid % 64 ) );
     pip_root->tasks[pipid].pipid = pipid;	/* mark it as occupied */
     pip_root->pipid_curr = pipid + 1;
     *pipidp = pipid;
@@ -745,7 +845,11 @@ pip_check_prog( char *rprog, pip_spawn_args_t *args, char **pathp, int verbose )
       }
     }
   }
-  if( !err ) *pathp = prog;
+  if( !err ) {
+    *pathp = prog;
+  } else {
+    free( prog );
+  }
   return err;
 }
 
@@ -812,14 +916,131 @@ static int pip_check_pie( char *prog ) {
   return err;
 }
 
+static void pip_prog_cache_free( pip_prog_cache_t *pc ) {
+  free( pc->prog      );
+  free( pc->paths     );
+  free( pc->prog_full );
+  free( pc->prog_base );
+  free( pc->symbol    );
+  free( pc );
+}
+
+static void pip_prog_cache_fin( pip_root_t *root ) {
+  pip_prog_cache_t *pc, *next;
+
+  for( pc=root->prog_cache; pc!=NULL; pc=next ) {
+    next = pc->next;
+    pip_prog_cache_free( pc );
+  }
+  root->prog_cache = NULL;
+}
+
+static int pip_prog_cache_same_file( pip_prog_cache_t *pc,
+				     struct stat *stbufp ) {
+  return pc->dev           == stbufp->st_dev          &&
+         pc->ino           == stbufp->st_ino          &&
+         pc->mtime.tv_sec  == stbufp->st_mtim.tv_sec  &&
+         pc->mtime.tv_nsec == stbufp->st_mtim.tv_nsec &&
+         pc->ctime.tv_sec  == stbufp->st_ctim.tv_sec  &&
+         pc->ctime.tv_nsec == stbufp->st_ctim.tv_nsec;
+}
+
+/* only the root spawns tasks, no lock is needed */
+static pip_prog_cache_t *pip_prog_cache_lookup( char *prog, char *paths ) {
+  pip_prog_cache_t *pc, **pcp;
+  struct stat stbuf;
+
+  for( pcp=&pip_root->prog_cache; ( pc = *pcp ) != NULL; pcp=&pc->next ) {
+    if( strcmp( pc->prog, prog ) != 0 ) continue;
+    if( ( pc->paths == NULL ) != ( paths == NULL ) ) continue;
+    if( paths != NULL && strcmp( pc->paths, paths ) != 0 ) continue;
+    if( stat( pc->prog_full, &stbuf ) == 0 &&
+	pip_prog_cache_same_file( pc, &stbuf ) ) {
+      DBGF( "hit: %s -> %s", prog, pc->prog_full );
+      return pc;
+    }
+    /* the file has been modified, replaced or removed */
+    DBGF( "stale: %s -> %s", prog, pc->prog_full );
+    *pcp = pc->next;
+    pip_prog_cache_free( pc );
+    break;
+  }
+  return NULL;
+}
+
+static pip_prog_cache_t *
+pip_prog_cache_add( char *prog, char *paths, char *prog_full, char *base ) {
+  pip_prog_cache_t *pc;
+  struct stat stbuf;
+
+  if( stat( prog_full, &stbuf ) != 0 ) return NULL;
+  if( ( pc = (pip_prog_cache_t*) calloc( 1, sizeof(*pc) ) ) == NULL ) {
+    return NULL;
+  }
+  pc->prog      = strdup( prog );
+  pc->paths     = ( paths != NULL ) ? strdup( paths ) : NULL;
+  pc->prog_full = strdup( prog_full );
+  pc->prog_base = strdup( base );
+  if( pc->prog == NULL || pc->prog_full == NULL || pc->prog_base == NULL ||
+      ( paths != NULL && pc->paths == NULL ) ) {
+    pip_prog_cache_free( pc );
+    return NULL;
+  }
+  pc->dev   = stbuf.st_dev;
+  pc->ino   = stbuf.st_ino;
+  pc->mtime = stbuf.st_mtim;
+  pc->ctime = stbuf.st_ctim;
+  pc->next  = pip_root->prog_cache;
+  pip_root->prog_cache = pc;
+  return pc;
+}
+
+/* ldpip resolves the start symbol only if it differs from the last one */
+static void pip_prog_cache_symbol( pip_prog_cache_t *pc, char *funcname ) {
+  char *symbol = ( funcname == NULL ) ? "main" : funcname;
+
+  if( pc->symbol == NULL || strcmp( pc->symbol, symbol ) != 0 ) {
+    free( pc->symbol );
+    pc->symbol     = strdup( symbol );
+    pc->sym_status = 0;
+    pc->sym_value  = 0;
+  }
+}
+
+/* on success, args->prog and args->prog_full are malloc()ed and */
+/* owned by args. on failure, both are left NULL. progp->prog is  */
+/* only borrowed for the path search and never freed by callers  */
 static int pip_check_user_prog( pip_spawn_program_t *progp,
 				pip_spawn_args_t *args ) {
   char *prog = args->prog = progp->prog;
   char *paths = getenv( "PATH" );
-  char *path;
-  int err = 0;
+  char *path, *key_paths = NULL;
+  pip_prog_cache_t *pc = NULL;
+  int cacheable, err = 0;
 
   DBGF( "prog = '%s'", prog );
+  /* a relative path name depends on the current directory */
+  cacheable = ( *prog == '/' );
+  if( strchr( prog, '/' ) == NULL && paths != NULL && *paths != '\0' ) {
+    cacheable = 1;
+    key_paths = paths;
+  }
+  if( cacheable && 
+      ( pc = pip_prog_cache_lookup( prog, key_paths ) ) != NULL ) {
+    args->prog_full = strdup( pc->prog_full );
+    args->prog      = strdup( pc->prog_base );
+    if( args->prog_full == NULL || args->prog == NULL ) {
+      free( args->prog_full );
+      free( args->prog      );
+      args->prog_full = NULL;
+      args->prog      = NULL;
+      return ENOMEM;
+    }
+    pip_prog_cache_symbol( pc, progp->funcname );
+    args->prog_cache = pc;
+    return 0;
+  }
+
   if( *prog == '\0' ) {
     err = ENOENT;
   } else if( strchr( prog, '/' ) == NULL &&
@@ -829,17 +1050,30 @@ static int pip_check_user_prog( pip_spawn_program_t *progp,
   } else {
     err = pip_check_prog( prog, args, &path, 1 );
   }
-  if( !err ) err = pip_check_pie( path );
+  if( !err && ( err = pip_check_pie( path ) ) != 0 ) free( path );
 
-  if( !err ) {
+  if( err ) {
+    /* do not leave the borrowed progp->prog to be freed by the caller */
+    args->prog = NULL;
+  } else {
     char *p;
-    args->prog_full = path;	/* malloec()ed by realpath() */
     if( ( p = strrchr( path, '/' ) ) != NULL ) {
       args->prog = strdup( p+1 );
     } else {
       args->prog = strdup( path );
     }
-    ASSERTD( args->prog != NULL );
+    if( args->prog == NULL ) {
+      free( path );
+      return ENOMEM;
+    }
+    args->prog_full = path;	/* malloec()ed by realpath() */
+    if( cacheable ) {
+      pc = pip_prog_cache_add( prog, key_paths, path, args->prog );
+      if( pc != NULL ) {
+	pip_prog_cache_symbol( pc, progp->funcname );
+	args->prog_cache = pc;
+      }
+    }
   }
   return err;
 }
@@ -883,28 +1117,23 @@ static int pip_corebind( pip_task_t *task, uint32_t coreno ) {
       }
     }
   }
+  if( pip_root->mem_policy & PIP_MEM_NUMA ) {
+    task->numa_node = pip_numa_node_of_cpuset( cpuset );
+    DBGF( "NUMA node:%d", task->numa_node );
+  }
   RETURN( 0 );
 }
 
-static int pip_do_task_spawn( pip_spawn_program_t *progp,
-			      int pipid,
-			      int coreno,
-			      uint32_t opts,
-			      pip_task_t **tskp,
-			      pip_spawn_hook_t *hookp ) {
-  pip_spawn_args_t	*args = NULL;
-  pip_task_t		*task = NULL;
-  char			*env_stop;
-  int 			err = 0;
-
-  ENTER;
-  if( !pip_is_effective() )                  RETURN( EPERM   );
-  if( pip_root == NULL )                     RETURN( EPERM );
-  if( progp == NULL || progp->prog == NULL ) RETURN( EINVAL );
+static int pip_check_spawn_params( pip_spawn_program_t *progp,
+				   int pipid,
+				   int coreno ) {
+  if( !pip_is_effective() )                  return EPERM;
+  if( pip_root == NULL )                     return EPERM;
+  if( progp == NULL || progp->prog == NULL ) return EINVAL;
   /* starting from main */
   if( progp->funcname == NULL &&
       ( progp->argv == NULL || progp->argv[0] == NULL ) ) {
-    RETURN( EINVAL );
+    return EINVAL;
   }
   /* starting from an arbitrary func */
   if( progp->funcname == NULL && progp->prog == NULL ) {
@@ -913,20 +1142,47 @@ static int pip_do_task_spawn( pip_spawn_program_t *progp,
   /* checking pipid */
   if( pipid == PIP_PIPID_MYSELF ||
       pipid == PIP_PIPID_NULL ) {
-    RETURN( EINVAL );
+    return EINVAL;
   }
   if( pipid != PIP_PIPID_ANY ) {
-    if( pipid < 0 || pipid > pip_root->ntasks ) RETURN( EINVAL );
+    if( pipid < 0 || pipid > pip_root->ntasks ) return EINVAL;
   }
   /* checking coreno */
   if( coreno != PIP_CPUCORE_ASIS ) {
     int flags = coreno & PIP_CPUCORE_FLAG_MASK;
     int value = coreno & PIP_CPUCORE_CORENO_MASK;
-    if( ( flags & PIP_CPUCORE_ABS ) != flags ) RETURN( EINVAL );
-    if( value >= PIP_CPUCORE_CORENO_MAX      ) RETURN( EINVAL );
+    if( ( flags & PIP_CPUCORE_ABS ) != flags ) return EINVAL;
+    if( value >= PIP_CPUCORE_CORENO_MAX      ) return EINVAL;
   }
+  return 0;
+}
 
-  if( ( err = pip_find_a_free_task( &pipid ) ) != 0 ) ERRJ_ERR( err );
+static void pip_free_args_vecs( pip_spawn_args_t* );
+
+static void pip_undo_task_spawn( pip_task_t *task ) {
+  pip_free_args_vecs( &task->args );
+  if( task->loaded != NULL ) (void) pip_dlclose( task->loaded );
+  pip_gdbif_finalize_task( task );
+  pip_task_slot_release( task );
+  pip_reset_task_struct( task );
+}
+
+/* occupy a task slot and set up everything but loading the */
+/* program. if checked is not NULL, then the user program   */
+/* has already been checked and the result is copied        */
+static int pip_prepare_task_spawn( pip_spawn_program_t *progp,
+				   int pipid,
+				   int coreno,
+				   pip_spawn_hook_t *hookp,
+				   pip_spawn_args_t *checked,
+				   pip_task_t **tskp ) {
+  pip_spawn_args_t	*args = NULL;
+  pip_task_t		*task = NULL;
+  char			*env_stop;
+  int 			err = 0;
+
+  ENTER;
+  if( ( err = pip_find_a_free_task( &pipid ) ) != 0 ) RETURN( err );
   task = &pip_root->tasks[pipid];
   pip_reset_task_struct( task );
   task->pipid     = pipid;	/* mark it as occupied */
@@ -935,7 +1191,14 @@ static int pip_do_task_spawn( pip_spawn_program_t *progp,
 
   /* checking user program */
   args = &task->args;
-  if( ( err = pip_check_user_prog( progp, args) ) ) ERRJ_ERR( err );
+  if( checked == NULL ) {
+    if( ( err = pip_check_user_prog( progp, args ) ) ) ERRJ_ERR( err );
+  } else {
+    args->prog_full = strdup( checked->prog_full );
+    args->prog      = strdup( checked->prog      );
+    if( args->prog_full == NULL || args->prog == NULL ) ERRJ_ERR( ENOMEM );
+    args->prog_cache = checked->prog_cache;
+  }
 
   args->pipid  = pipid;
   args->coreno = coreno;
@@ -973,76 +1236,242 @@ static int pip_do_task_spawn( pip_spawn_program_t *progp,
   DBGF( "ONSTART: '%s'", task->onstart_script );
 
   pip_gdbif_task_new( task );
-  {
-    char *libdir = "/lib/";
-    int l = strlen( pip_root->prefixdir ) + strlen( libdir ) +
-      strlen( LDPIP_NAME ) + 1;
-    char *p = alloca( l );
-    char *q, *warn_mesg = NULL, *err_mesg = NULL;
-    Lmid_t lmid;
-    int(*ldpip_load)( pip_root_t*, 
-		      pip_task_t*, 
-		      pip_spawn_args_t *arg,
-		      char **,
-		      char **);
-    q = p;
-    q = stpcpy( q, pip_root->prefixdir );
-    q = stpcpy( q, "/lib/" );
-    q = stpcpy( q, LDPIP_NAME );
-
-    void *loaded = pip_dlmopen( LM_ID_NEWLM, p, DLOPEN_FLAGS );
-    DBGF( "%s : %p : %s", p, loaded, dlerror() );
-    if( loaded == NULL ) {
-      pip_err_mesg( "Unable to load %s - %s", p, pip_dlerror() );
-      err = ENOEXEC;
-      goto error;
-    }
-    ASSERT( pip_dlinfo( loaded, RTLD_DI_LMID, &lmid ) == 0 );
-    DBGF( "lmid:%d", (int) lmid );
-    task->loaded = loaded;
-    task->lmid   = lmid;
+  *tskp = task;
+  RETURN( 0 );
+
+ error:
+  pip_undo_task_spawn( task );
+  RETURN( err );
+}
+
+static void pip_ldpip_mesg( char *warn_mesg, char *err_mesg ) {
+  if( warn_mesg != NULL ) {
+    pip_warn_mesg( "%s", warn_mesg );
+    free( warn_mesg );
+  }
+  if( err_mesg != NULL ) {
+    pip_err_mesg( "%s", err_mesg );
+    free( err_mesg );
+  }
+}
+
+/* load ldpip into a new name space */
+static int pip_load_ldpip( void **loadedp, Lmid_t *lmidp ) {
+  char *libdir = "/lib/";
+  int l = strlen( pip_root->prefixdir ) + strlen( libdir ) +
+    strlen( LDPIP_NAME ) + 1;
+  char *p = alloca( l );
+  char *q;
+  void *loaded;
+
+  ENTER;
+  q = p;
+  q = stpcpy( q, pip_root->prefixdir );
+  q = stpcpy( q, "/lib/" );
+  q = stpcpy( q, LDPIP_NAME );
+
+  loaded = pip_dlmopen( LM_ID_NEWLM, p, DLOPEN_FLAGS );
+  DBGF( "%s : %p : %s", p, loaded, dlerror() );
+  if( loaded == NULL ) {
+    pip_err_mesg( "Unable to load %s - %s", p, pip_dlerror() );
+    RETURN( ENOEXEC );
+  }
+  ASSERT( pip_dlinfo( loaded, RTLD_DI_LMID, lmidp ) == 0 );
+  DBGF( "lmid:%d", (int) *lmidp );
+  *loadedp = loaded;
 
 #ifdef DEBUG_AHA
-    pip_print_maps();
+  pip_print_maps();
 #endif
+  RETURN( 0 );
+}
 
-    ASSERT( ( ldpip_load = pip_dlsym( loaded, "__ldpip_load_prog" ) ) != NULL );
-    if( ( err = ldpip_load( pip_root,
-			    task,
-			    args,
-			    &warn_mesg,
-			    &err_mesg ) ) != 0 ) {
-      if( warn_mesg != NULL ) {
-	pip_warn_mesg( "%s", warn_mesg );
-	free( warn_mesg );
-      }
-      if( err_mesg != NULL ) {
-	pip_err_mesg( "%s", err_mesg );
-	free( err_mesg );
-      }
-      goto error;
+static void pip_free_args_vecs( pip_spawn_args_t *args ) {
+  if( args->argvec.vec  != NULL ) free( args->argvec.vec  );
+  if( args->argvec.strs != NULL ) free( args->argvec.strs );
+  if( args->envvec.vec  != NULL ) free( args->envvec.vec  );
+  if( args->envvec.strs != NULL ) free( args->envvec.strs );
+  memset( &args->argvec, 0, sizeof(args->argvec) );
+  memset( &args->envvec, 0, sizeof(args->envvec) );
+}
+
+static int pip_same_vec( char **vec0, char **vec1 ) {
+  int i;
+
+  for( i=0; vec0[i]!=NULL && vec1[i]!=NULL; i++ ) {
+    if( strcmp( vec0[i], vec1[i] ) != 0 ) return 0;
+  }
+  return vec0[i] == NULL && vec1[i] == NULL;
+}
+
+static void pip_ns_template_free( pip_ns_template_t *tmpl ) {
+  if( tmpl->loaded != NULL ) (void) pip_dlclose( tmpl->loaded );
+  pip_free_args_vecs( &tmpl->args );
+  free( tmpl->args.funcname  );
+  free( tmpl->args.prog      );
+  free( tmpl->args.prog_full );
+  free( tmpl );
+}
+
+static void pip_ns_template_fin( pip_root_t *root ) {
+  pip_ns_template_t *tmpl, *next;
+
+  for( tmpl=root->ns_templates; tmpl!=NULL; tmpl=next ) {
+    next = tmpl->next;
+    pip_ns_template_free( tmpl );
+  }
+  root->ns_templates = NULL;
+}
+
+/* find a name space prepared for the same program, the same */
+/* start function and the same environment variables         */
+static pip_ns_template_t *pip_ns_template_take( pip_spawn_args_t *args ) {
+  pip_ns_template_t *tmpl, **tmplp;
+
+  for( tmplp=&pip_root->ns_templates; 
+       ( tmpl = *tmplp ) != NULL; 
+       tmplp=&tmpl->next ) {
+    if( strcmp( tmpl->args.prog_full, args->prog_full ) != 0 ) continue;
+    if( ( tmpl->args.funcname == NULL ) != ( args->funcname == NULL ) ) {
+      continue;
     }
+    if( args->funcname != NULL &&
+	strcmp( tmpl->args.funcname, args->funcname ) != 0 ) continue;
+    if( !pip_same_vec( tmpl->args.envvec.vec, args->envvec.vec ) ) continue;
+    *tmplp = tmpl->next;
+    return tmpl;
   }
-  if( err == 0 ) {
-    pip_root->ntasks_count ++;
-    pip_root->ntasks_curr  ++;
-    *tskp = task;
+  return NULL;
+}
 
-    if( task->onstart_script != NULL ) pip_onstart( task );
+/* load ldpip into a new name space and let it start the task */
+static int pip_load_task( pip_task_t *task ) {
+  pip_spawn_args_t *args = &task->args;
+  pip_ns_template_t *tmpl;
+  char *warn_mesg = NULL, *err_mesg = NULL;
+  int(*ldpip_load)( pip_root_t*, 
+		    pip_task_t*, 
+		    pip_spawn_args_t *arg,
+		    char **,
+		    char **);
+  int(*ldpip_start)( pip_root_t*, pip_task_t*, pip_spawn_args_t* );
+  int err = 0;
 
-  } else {
-  error:			/* undo */
-    if( args != NULL ) {
-      if( args->argvec.vec  != NULL ) free( args->argvec.vec  );
-      if( args->argvec.strs != NULL ) free( args->argvec.strs );
-      if( args->envvec.vec  != NULL ) free( args->envvec.vec  );
-      if( args->envvec.strs != NULL ) free( args->envvec.strs );
+  ENTER;
+  if( ( tmpl = pip_ns_template_take( args ) ) != NULL ) {
+    DBGF( "prepared name space: lmid:%d", (int) tmpl->lmid );
+    task->loaded = tmpl->loaded;
+    task->lmid   = tmpl->lmid;
+    /* environ of the name space points to the strings of the template */
+    free( args->envvec.vec  );
+    free( args->envvec.strs );
+    args->envvec    = tmpl->args.envvec;
+    args->func_main = tmpl->args.func_main;
+    args->func_user = tmpl->args.func_user;
+    /* __progname and __progname_full also do, they are left as they are */
+    free( tmpl->args.funcname );
+    free( tmpl );
+
+    ASSERT( ( ldpip_start = pip_dlsym( task->loaded, "__ldpip_start_prog" ) )
+	    != NULL );
+    err = ldpip_start( pip_root, task, args );
+    RETURN( err );
+  }
+
+  if( ( err = pip_load_ldpip( &task->loaded, &task->lmid ) ) != 0 ) {
+    RETURN( err );
+  }
+  ASSERT( ( ldpip_load = pip_dlsym( task->loaded, "__ldpip_load_prog" ) )
+	  != NULL );
+  if( ( err = ldpip_load( pip_root,
+			  task,
+			  args,
+			  &warn_mesg,
+			  &err_mesg ) ) != 0 ) {
+    pip_ldpip_mesg( warn_mesg, err_mesg );
+  }
+  RETURN( err );
+}
+
+int pip_task_spawn_prepare( pip_spawn_program_t *progp, int n ) {
+  pip_ns_template_t *tmpl;
+  char *warn_mesg, *err_mesg;
+  int(*ldpip_prepare)( pip_root_t*, pip_spawn_args_t*, char**, char** );
+  int i, err = 0;
+
+  ENTER;
+  if( progp == NULL       ) RETURN( EINVAL );
+  if( n <= 0              ) RETURN( EINVAL );
+  if( !pip_is_effective() ) RETURN( EPERM );
+  if( pip_task != NULL && !PIP_ISA_ROOT( pip_task ) ) RETURN( EPERM );
+  err = pip_check_spawn_params( progp, PIP_PIPID_ANY, PIP_CPUCORE_ASIS );
+  if( err ) RETURN( err );
+
+  for( i=0; i<n; i++ ) {
+    if( ( tmpl = (pip_ns_template_t*) calloc( 1, sizeof(*tmpl) ) ) == NULL ) {
+      RETURN( ENOMEM );
     }
-    if( task != NULL ) {
-      if( task->loaded != NULL ) (void) pip_dlclose( task->loaded );
-      pip_gdbif_finalize_task( task );
-      pip_reset_task_struct( task );
+    tmpl->args.pipid  = PIP_PIPID_NULL;
+    tmpl->args.coreno = PIP_CPUCORE_ASIS;
+    if( ( err = pip_check_user_prog( progp, &tmpl->args ) ) != 0 ) goto error;
+    err = pip_copy_env( progp->envv, PIP_PIPID_NULL, &tmpl->args.envvec );
+    if( err ) goto error;
+    if( progp->funcname != NULL &&
+	( tmpl->args.funcname = strdup( progp->funcname ) ) == NULL ) {
+      err = ENOMEM;
+      goto error;
+    }
+    if( ( err = pip_load_ldpip( &tmpl->loaded, &tmpl->lmid ) ) != 0 ) {
+      goto error;
     }
+    ASSERT( ( ldpip_prepare = 
+	      pip_dlsym( tmpl->loaded, "__ldpip_prepare_prog" ) ) != NULL );
+    warn_mesg = err_mesg = NULL;
+    err = ldpip_prepare( pip_root, &tmpl->args, &warn_mesg, &err_mesg );
+    if( err ) {
+      pip_ldpip_mesg( warn_mesg, err_mesg );
+      goto error;
+    }
+    tmpl->next = pip_root->ns_templates;
+    pip_root->ns_templates = tmpl;
+  }
+  RETURN( 0 );
+
+ error:
+  /* only the failed one is freed. the name spaces already queued */
+  /* are complete and usable, so that they are not rolled back     */
+  pip_ns_template_free( tmpl );
+  RETURN( err );
+}
+
+static void pip_commit_task_spawn( pip_task_t *task ) {
+  pip_root->ntasks_count ++;
+  pip_root->ntasks_curr  ++;
+  pip_wait_fd_add( pip_root, task );
+  if( task->onstart_script != NULL ) pip_onstart( task );
+}
+
+static int pip_do_task_spawn( pip_spawn_program_t *progp,
+			      int pipid,
+			      int coreno,
+			      uint32_t opts,
+			      pip_task_t **tskp,
+			      pip_spawn_hook_t *hookp ) {
+  pip_task_t		*task = NULL;
+  int 			err = 0;
+
+  ENTER;
+  if( ( err = pip_check_spawn_params( progp, pipid, coreno ) ) != 0 ) {
+    RETURN( err );
+  }
+  err = pip_prepare_task_spawn( progp, pipid, coreno, hookp, NULL, &task );
+  if( err ) RETURN( err );
+
+  if( ( err = pip_load_task( task ) ) == 0 ) {
+    *tskp = task;
+    pip_commit_task_spawn( task );
+  } else {
+    pip_undo_task_spawn( task );
   }
   RETURN( err );
 }
@@ -1071,6 +1500,94 @@ int pip_task_spawn( pip_spawn_program_t *progp,
   RETURN( err );
 }
 
+static int pip_nth_coreno( uint32_t coreno, int nth ) {
+  if( coreno == PIP_CPUCORE_ASIS ) return coreno;
+  return ( coreno & PIP_CPUCORE_FLAG_MASK ) |
+    ( ( ( coreno & PIP_CPUCORE_CORENO_MASK ) + nth ) 
+      & PIP_CPUCORE_CORENO_MASK );
+}
+
+/* setup is called for each task after it is prepared and before */
+/* it is loaded                                                     */
+int pip_do_task_spawn_n( pip_spawn_program_t *progp,
+			 int ntasks,
+			 uint32_t coreno,
+			 uint32_t opts,
+			 int *pipids,
+			 pip_spawn_hook_t *hookp,
+			 void(*setup)( pip_task_t*, int, void* ),
+			 void *setup_arg ) {
+  pip_spawn_args_t	checked;
+  pip_task_t		**tasks = NULL;
+  int			pipid, nprep = 0, nload = 0, i, err = 0;
+
+  ENTER;
+  if( ( err = pip_check_spawn_params( progp, PIP_PIPID_ANY, coreno ) ) ) {
+    RETURN( err );
+  }
+  /* never fits, and ntasks is given by the user */
+  if( ntasks > pip_root->ntasks ) RETURN( EINVAL );
+  tasks = alloca( sizeof(pip_task_t*) * ntasks );
+  /* the program is looked up and checked only once */
+  memset( &checked, 0, sizeof(checked) );
+  if( ( err = pip_check_user_prog( progp, &checked ) ) ) RETURN( err );
+
+  /* prepare all task structures before loading anything, so */
+  /* that running out of slots does not leave a partial spawn */
+  for( i=0; i<ntasks; i++ ) {
+    pipid = ( pipids == NULL ) ? PIP_PIPID_ANY : pipids[i];
+    if( ( err = pip_check_spawn_params( progp, pipid, coreno ) ) ) break;
+    err = pip_prepare_task_spawn( progp,
+				  pipid,
+				  pip_nth_coreno( coreno, i ),
+				  hookp,
+				  &checked,
+				  &tasks[i] );
+    if( err ) break;
+    tasks[i]->args.sync_deferred = 1;
+    if( setup != NULL ) setup( tasks[i], i, setup_arg );
+    nprep ++;
+  }
+  if( !err ) {
+    /* the root does not wait for each task to be started.  */
+    /* loading the next name space overlaps with the start- */
+    /* up of the tasks already created                      */
+    for( i=0; i<ntasks; i++ ) {
+      if( ( err = pip_load_task( tasks[i] ) ) != 0 ) break;
+      nload ++;
+    }
+    /* each started task posts exactly once */
+    for( i=0; i<nload; i++ ) pip_sem_wait( &pip_root->sync_spawn );
+  }
+  for( i=0; i<nload; i++ ) {
+    tasks[i]->args.sync_deferred = 0;
+    pip_commit_task_spawn( tasks[i] );
+    if( pipids != NULL ) pipids[i] = tasks[i]->pipid;
+  }
+  for( i=nload; i<nprep; i++ ) pip_undo_task_spawn( tasks[i] );
+  if( pipids != NULL ) {
+    for( i=nload; i<ntasks; i++ ) pipids[i] = PIP_PIPID_NULL;
+  }
+  free( checked.prog_full );
+  free( checked.prog );
+  RETURN( err );
+}
+
+int pip_task_spawn_n( pip_spawn_program_t *progp,
+		      int ntasks,
+		      uint32_t coreno,
+		      uint32_t opts,
+		      int *pipids,
+		      pip_spawn_hook_t *hookp ) {
+  ENTER;
+  if( progp == NULL       ) RETURN( EINVAL );
+  if( ntasks <= 0         ) RETURN( EINVAL );
+  if( !pip_is_effective() ) RETURN( EPERM );
+  if( pip_task != NULL && !PIP_ISA_ROOT( pip_task ) ) RETURN( EPERM );
+  RETURN( pip_do_task_spawn_n( progp, ntasks, coreno, opts, pipids, hookp,
+			       NULL, NULL ) );
+}
+
 int pip_spawn( char *prog,
 	       char **argv,
 	       char **envv,
@@ -1103,15 +1620,12 @@ int pip_fin( void ) {
     if( pip_is_finalized()  ) RETURN( EBUSY );
     if( !pip_is_effective() ) RETURN( EPERM );
 
-    for( i=0; i<pip_root->ntasks; i++ ) {
-      if( pip_root->tasks[i].type != PIP_TYPE_NULL ) {
-	DBGF( "%d/%d [%d] -- BUSY", 
-	      i, 
-	      pip_root->ntasks, 
-	      pip_root->tasks[i].pipid );
-	err = EBUSY;
-	break;
-      }
+    if( ( i = pip_next_busy_task( pip_root, 0 ) ) >= 0 ) {
+      DBGF( "%d/%d [%d] -- BUSY", 
+	    i, 
+	    pip_root->ntasks, 
+	    pip_root->tasks[i].pipid );
+      err = EBUSY;
     }
     if( err == 0 ) {
       pip_finalize_root( pip_root );
@@ -1184,47 +1698,6 @@ int pip_get_pid_( int pipid, pid_t *pidp ) {
   RETURN( err );
 }
 
-int pip_barrier_init( pip_barrier_t *barrp, int n ) {
-  if( !pip_is_effective() ) return EPERM;
-  if( n <= 0 ) return EINVAL;
-  barrp->count      = n;
-  barrp->count_init = n;
-  barrp->gsense     = 0;
-  pip_sem_init( &barrp->semaphore[0] );
-  pip_sem_init( &barrp->semaphore[1] );
-  return 0;
-}
-
-int pip_barrier_wait( pip_barrier_t *barrp ) {
-  if( barrp->count_init > 1 ) {
-    int i, lsense = ( barrp->gsense + 1 ) & 1;
-    if( __sync_sub_and_fetch( &barrp->count, 1 ) == 0 ) {
-      barrp->count  = barrp->count_init;
-      pip_memory_barrier();
-      barrp->gsense = lsense;
-      DBG;
-      for( i=0; i<barrp->count_init-1; i++ ) {
-	pip_sem_post( &barrp->semaphore[lsense] );
-      }
-    } else {
-      while( barrp->gsense != lsense ) {
-	DBG;
-	pip_sem_wait( &barrp->semaphore[lsense] );
-	DBG;
-      }
-    }
-  }
-  return 0;
-}
-
-int pip_barrier_fin( pip_barrier_t *barrp ) {
-  if( !pip_is_effective()               ) return EPERM;
-  if( barrp->count != barrp->count_init ) return EBUSY;
-  pip_sem_fin( &barrp->semaphore[0] );
-  pip_sem_fin( &barrp->semaphore[1] );
-  return 0;
-}
-
 int pip_yield( int flag ) {
   if( !pip_is_effective() ) RETURN( EPERM );
   if( pip_root != NULL && pip_is_threaded_() ) {
@@ -0,0 +1,359 @@
+
+/*
+ * $PIP_license: <Simplified BSD License>
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *     Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ * 
+ *     Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ * $
+ * $RIKEN_copyright: Riken Center for Computational Sceience (R-CCS),
+ * System Software Development Team, 2016-2022
+ * $
+ * $PIP_VERSION: Version 2.4.1$
+ *
+ * $Author: Atsushi Hori 
+ * Query:   procinproc-info@googlegroups.com
+ * User ML: procinproc-users@googlegroups.com
+ * $
+ */
+
+#include <pip/pip_internal.h>
+
+/* Bounded ring buffers to pass fixed-size messages among PiP tasks. */
+/* The SPSC ring has no atomic read-modify-write operation at all,   */
+/* each side keeps a cached copy of the other side's index. The      */
+/* MPMC ring is the one by D. Vyukov, each cell has its sequence     */
+/* number. Indices of the producers and the consumers are on their   */
+/* own cache blocks.                                                 */
+
+#define PIP_CHANNEL_MAGIC	(0x5B900400U)
+#define PIP_CHANNEL_NMSGS_MAX	(1U<<30)
+#define PIP_CHANNEL_NAME_FMT	"pip_channel:%s"
+
+#define ROUNDUP(X,Y)		((((X)+(Y)-1)/(Y))*(Y))
+
+#define PIP_LOAD_ACQ(P)		__atomic_load_n( (P), __ATOMIC_ACQUIRE )
+#define PIP_STORE_REL(P,V)	__atomic_store_n( (P), (V), __ATOMIC_RELEASE )
+
+typedef struct pip_channel_side {
+  volatile uint64_t	index;
+  uint64_t		cache;	  /* SPSC: the other side's index */
+  volatile uint32_t	nsleepers;
+  volatile uint32_t	event;	  /* futex word */
+  char			__pad__[PIP_CACHEBLK_SZ - 24];
+} pip_channel_side_t;
+
+struct pip_channel {
+  /* read-only after creation */
+  uint32_t		magic;
+  int			flags;
+  size_t		msgsz;
+  size_t		cellsz;
+  uint64_t		mask;
+  void			*cells;
+  int			pipid;	/* creator */
+  char			name[PIP_NAMED_KEY_MAX];
+  char			__pad__[PIP_CACHEBLK_SZ -
+				( 48 + PIP_NAMED_KEY_MAX ) % PIP_CACHEBLK_SZ];
+  pip_channel_side_t	send;	/* tail */
+  pip_channel_side_t	recv;	/* head */
+};
+
+typedef struct pip_channel_cell {
+  volatile uint64_t	seq;	/* MPMC only */
+  char			data[];
+} pip_channel_cell_t;
+
+INLINE int pip_channel_check( pip_channel_t *ch ) {
+  return ch != NULL && ch->magic == PIP_CHANNEL_MAGIC;
+}
+
+INLINE int pip_channel_is_mpmc( pip_channel_t *ch ) {
+  return ch->flags & PIP_CHANNEL_MPMC;
+}
+
+INLINE pip_channel_cell_t *pip_channel_cell( pip_channel_t *ch, uint64_t i ) {
+  return (pip_channel_cell_t*) ( ch->cells + ch->cellsz * ( i & ch->mask ) );
+}
+
+/* wake up the other side if it sleeps */
+INLINE void pip_channel_notify( pip_channel_t *ch, pip_channel_side_t *side ) {
+  if( ch->flags & PIP_CHANNEL_BLOCK ) {
+    __atomic_thread_fence( __ATOMIC_SEQ_CST );
+    if( side->nsleepers > 0 ) {
+      (void) __sync_fetch_and_add( &side->event, 1 );
+      pip_futex_wake_all( &side->event );
+    }
+  }
+}
+
+static int pip_channel_enq( pip_channel_t *ch, const void *msgs, int n ) {
+  pip_channel_cell_t	*cell;
+  uint64_t		pos, seq, cap = ch->mask + 1;
+  int64_t		dif;
+  int			i;
+
+  if( !pip_channel_is_mpmc( ch ) ) {
+    pos = ch->send.index;
+    if( pos + n - ch->send.cache > cap ) {
+      ch->send.cache = PIP_LOAD_ACQ( &ch->recv.index );
+      if( pos + n - ch->send.cache > cap ) n = cap - ( pos - ch->send.cache );
+    }
+    for( i=0; i<n; i++ ) {
+      cell = pip_channel_cell( ch, pos + i );
+      memcpy( cell->data, msgs + ch->msgsz * i, ch->msgsz );
+    }
+    if( n > 0 ) PIP_STORE_REL( &ch->send.index, pos + n );
+  } else {
+    for( i=0; i<n; i++ ) {
+      pos = ch->send.index;
+      while( 1 ) {
+	cell = pip_channel_cell( ch, pos );
+	seq  = PIP_LOAD_ACQ( &cell->seq );
+	dif  = (int64_t) seq - (int64_t) pos;
+	if( dif == 0 ) {
+	  if( __sync_bool_compare_and_swap( &ch->send.index, pos, pos + 1 ) ) {
+	    break;
+	  }
+	} else if( dif < 0 ) {	/* full */
+	  goto done;
+	}
+	pos = ch->send.index;
+      }
+      memcpy( cell->data, msgs + ch->msgsz * i, ch->msgsz );
+      PIP_STORE_REL( &cell->seq, pos + 1 );
+    }
+  done:
+    n = i;
+  }
+  if( n > 0 ) pip_channel_notify( ch, &ch->recv );
+  return n;
+}
+
+static int pip_channel_deq( pip_channel_t *ch, void *msgs, int n ) {
+  pip_channel_cell_t	*cell;
+  uint64_t		pos, seq;
+  int64_t		dif;
+  int			i;
+
+  if( !pip_channel_is_mpmc( ch ) ) {
+    pos = ch->recv.index;
+    if( pos + n > ch->recv.cache ) {
+      ch->recv.cache = PIP_LOAD_ACQ( &ch->send.index );
+      if( pos + n > ch->recv.cache ) n = ch->recv.cache - pos;
+    }
+    for( i=0; i<n; i++ ) {
+      cell = pip_channel_cell( ch, pos + i );
+      memcpy( msgs + ch->msgsz * i, cell->data, ch->msgsz );
+    }
+    if( n > 0 ) PIP_STORE_REL( &ch->recv.index, pos + n );
+  } else {
+    for( i=0; i<n; i++ ) {
+      pos = ch->recv.index;
+      while( 1 ) {
+	cell = pip_channel_cell( ch, pos );
+	seq  = PIP_LOAD_ACQ( &cell->seq );
+	dif  = (int64_t) seq - (int64_t) ( pos + 1 );
+	if( dif == 0 ) {
+	  if( __sync_bool_compare_and_swap( &ch->recv.index, pos, pos + 1 ) ) {
+	    break;
+	  }
+	} else if( dif < 0 ) {	/* empty */
+	  goto done;
+	}
+	pos = ch->recv.index;
+      }
+      memcpy( msgs + ch->msgsz * i, cell->data, ch->msgsz );
+      PIP_STORE_REL( &cell->seq, pos + ch->mask + 1 );
+    }
+  done:
+    n = i;
+  }
+  if( n > 0 ) pip_channel_notify( ch, &ch->send );
+  return n;
+}
+
+/* spin for a while, then sleep if the channel is blocking, or yield */
+static void pip_channel_wait( pip_channel_t *ch,
+			      pip_channel_side_t *side,
+			      int(*ready)( pip_channel_t* ),
+			      int *spinp ) {
+  uint32_t	event;
+
+  if( (*spinp)++ < PIP_SYNC_SPIN ) {
+    pip_pause();
+  } else if( ch->flags & PIP_CHANNEL_BLOCK ) {
+    (void) __sync_fetch_and_add( &side->nsleepers, 1 );
+    event = side->event;
+    if( !ready( ch ) ) (void) pip_futex_wait( &side->event, event, NULL );
+    (void) __sync_fetch_and_sub( &side->nsleepers, 1 );
+  } else {
+    sched_yield();
+  }
+}
+
+static int pip_channel_not_full( pip_channel_t *ch ) {
+  uint64_t pos = PIP_LOAD_ACQ( &ch->send.index );
+  if( pip_channel_is_mpmc( ch ) ) {
+    return PIP_LOAD_ACQ( &pip_channel_cell( ch, pos )->seq ) >= pos;
+  }
+  return pos - PIP_LOAD_ACQ( &ch->recv.index ) <= ch->mask;
+}
+
+static int pip_channel_not_empty( pip_channel_t *ch ) {
+  uint64_t pos = PIP_LOAD_ACQ( &ch->recv.index );
+  if( pip_channel_is_mpmc( ch ) ) {
+    return PIP_LOAD_ACQ( &pip_channel_cell( ch, pos )->seq ) >= pos + 1;
+  }
+  return PIP_LOAD_ACQ( &ch->send.index ) != pos;
+}
+
+int pip_channel_create( pip_channel_t **chp,
+			size_t msgsz,
+			int nmsgs,
+			int flags,
+			const char *name ) {
+  pip_channel_t		*ch;
+  pip_channel_cell_t	*cell;
+  size_t		cellsz, sz_hdr;
+  uint64_t		cap, i;
+  int			err;
+
+  if( !pip_is_effective() ) RETURN( EPERM );
+  if( chp == NULL || msgsz == 0 ) RETURN( EINVAL );
+  if( nmsgs <= 0 || nmsgs > PIP_CHANNEL_NMSGS_MAX ) RETURN( EINVAL );
+  if( flags & ~( PIP_CHANNEL_MPMC | PIP_CHANNEL_BLOCK ) ) RETURN( EINVAL );
+  if( name != NULL &&
+      strlen( name ) + sizeof( PIP_CHANNEL_NAME_FMT ) > PIP_NAMED_KEY_MAX ) {
+    RETURN( ENAMETOOLONG );
+  }
+
+  for( cap=1; cap<nmsgs; cap*=2 );
+  cellsz = ROUNDUP( msgsz, sizeof(uint64_t) );
+  if( flags & PIP_CHANNEL_MPMC ) cellsz += sizeof(uint64_t);
+  sz_hdr = ROUNDUP( sizeof( pip_channel_t ), PIP_CACHEBLK_SZ );
+  if( cellsz > ( SIZE_MAX - sz_hdr ) / cap ) RETURN( ENOMEM );
+
+  if( pip_page_alloc( sz_hdr + cellsz * cap, (void**) &ch ) != 0 ) {
+    RETURN( ENOMEM );
+  }
+  memset( ch, 0, sizeof( pip_channel_t ) );
+  ch->flags  = flags;
+  ch->msgsz  = msgsz;
+  ch->cellsz = cellsz;
+  ch->mask   = cap - 1;
+  ch->cells  = (void*) ch + sz_hdr;
+  ch->pipid  = pip_task->pipid;
+  if( !( flags & PIP_CHANNEL_MPMC ) ) {
+    /* SPSC cells have no sequence number */
+    ch->cells -= offsetof( pip_channel_cell_t, data );
+  } else {
+    for( i=0; i<cap; i++ ) {
+      cell = pip_channel_cell( ch, i );
+      cell->seq = i;
+    }
+  }
+  pip_memory_barrier();
+  ch->magic = PIP_CHANNEL_MAGIC;
+
+  if( name != NULL ) {
+    strcpy( ch->name, name );
+    if( ( err = pip_named_export( ch, PIP_CHANNEL_NAME_FMT, name ) ) != 0 ) {
+      ch->magic = 0;
+      pip_page_free( ch );
+      RETURN( err );
+    }
+  }
+  *chp = ch;
+  RETURN( 0 );
+}
+
+int pip_channel_attach( pip_channel_t **chp, int pipid, const char *name ) {
+  pip_channel_t	*ch;
+  int		err;
+
+  if( chp == NULL || name == NULL ) RETURN( EINVAL );
+  err = pip_named_import( pipid, (void**) &ch, PIP_CHANNEL_NAME_FMT, name );
+  if( err ) RETURN( err );
+  if( !pip_channel_check( ch ) ) RETURN( EINVAL );
+  *chp = ch;
+  RETURN( 0 );
+}
+
+int pip_channel_destroy( pip_channel_t *ch ) {
+  if( !pip_channel_check( ch ) ) RETURN( EINVAL );
+  if( ch->send.nsleepers > 0 || ch->recv.nsleepers > 0 ) RETURN( EBUSY );
+  if( ch->name[0] != '\0' && ch->pipid == pip_task->pipid ) {
+    (void) pip_named_unexport( PIP_CHANNEL_NAME_FMT, ch->name );
+  }
+  ch->magic = 0;
+  pip_page_free( ch );
+  RETURN( 0 );
+}
+
+int pip_channel_send_n( pip_channel_t *ch,
+			const void *msgs,
+			int n,
+			int *nsentp ) {
+  if( !pip_channel_check( ch ) || msgs == NULL || n < 0 ) RETURN( EINVAL );
+  n = pip_channel_enq( ch, msgs, n );
+  if( nsentp != NULL ) *nsentp = n;
+  return ( n > 0 ) ? 0 : EAGAIN;
+}
+
+int pip_channel_recv_n( pip_channel_t *ch,
+			void *msgs,
+			int n,
+			int *nrecvp ) {
+  if( !pip_channel_check( ch ) || msgs == NULL || n < 0 ) RETURN( EINVAL );
+  n = pip_channel_deq( ch, msgs, n );
+  if( nrecvp != NULL ) *nrecvp = n;
+  return ( n > 0 ) ? 0 : EAGAIN;
+}
+
+int pip_channel_trysend( pip_channel_t *ch, const void *msg ) {
+  if( !pip_channel_check( ch ) || msg == NULL ) RETURN( EINVAL );
+  return ( pip_channel_enq( ch, msg, 1 ) > 0 ) ? 0 : EAGAIN;
+}
+
+int pip_channel_tryrecv( pip_channel_t *ch, void *msg ) {
+  if( !pip_channel_check( ch ) || msg == NULL ) RETURN( EINVAL );
+  return ( pip_channel_deq( ch, msg, 1 ) > 0 ) ? 0 : EAGAIN;
+}
+
+int pip_channel_send( pip_channel_t *ch, const void *msg ) {
+  int spin = 0;
+
+  if( !pip_channel_check( ch ) || msg == NULL ) RETURN( EINVAL );
+  while( pip_channel_enq( ch, msg, 1 ) == 0 ) {
+    pip_channel_wait( ch, &ch->send, pip_channel_not_full, &spin );
+  }
+  return 0;
+}
+
+int pip_channel_recv( pip_channel_t *ch, void *msg ) {
+  int spin = 0;
+
+  if( !pip_channel_check( ch ) || msg == NULL ) RETURN( EINVAL );
+  while( pip_channel_deq( ch, msg, 1 ) == 0 ) {
+    pip_channel_wait( ch, &ch->recv, pip_channel_not_empty, &spin );
+  }
+  return 0;
+}
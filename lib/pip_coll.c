@@ -0,0 +1,329 @@
+
+/*
+ * $PIP_license: <Simplified BSD License>
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *     Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ * 
+ *     Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ * $
+ * $RIKEN_copyright: Riken Center for Computational Sceience (R-CCS),
+ * System Software Development Team, 2016-2022
+ * $
+ * $PIP_VERSION: Version 2.4.1$
+ *
+ * $Author: Atsushi Hori 
+ * Query:   procinproc-info@googlegroups.com
+ * User ML: procinproc-users@googlegroups.com
+ * $
+ */
+
+#include <pip/pip_internal.h>
+
+/* Collective operations among PiP tasks. Since all tasks share the */
+/* same address space, each task only publishes the addresses of    */
+/* its buffers, and then the peers load from or store to the        */
+/* buffers directly. No intermediate copy is made.                  */
+
+#define PIP_COLL_MAGIC		(0x5B900300U)
+#define PIP_COLL_VECSZ		(32)	/* bytes of a reduction vector */
+
+typedef struct pip_coll_slot {
+  const void *volatile	sbuf;
+  void *volatile	rbuf;
+  char			__pad__[PIP_CACHEBLK_SZ - 2 * sizeof(void*)];
+} pip_coll_slot_t;
+
+struct pip_coll {
+  uint32_t		magic;
+  int			n;
+  pip_tree_barrier_t	*barrier;
+  char			__pad__[PIP_CACHEBLK_SZ - 16];
+  pip_coll_slot_t	slots[];
+};
+
+typedef void(*pip_coll_kernel_t)( void*, const void**, int, size_t );
+
+/* Reduction kernels. GCC vector extensions let the compiler emit */
+/* the SIMD instructions available on the target, and the scalar  */
+/* loop handles the rest. The vector types are unaligned since    */
+/* the user buffers may not be aligned.                           */
+
+#define PIP_COLL_ADD(A,B)	((A) + (B))
+#define PIP_COLL_MUL(A,B)	((A) * (B))
+#define PIP_COLL_SMIN(A,B)	(((A) < (B)) ? (A) : (B))
+#define PIP_COLL_SMAX(A,B)	(((A) > (B)) ? (A) : (B))
+/* vectors have no ?: operator in C, select with the comparison mask */
+#define PIP_COLL_VMIN(A,B)					\
+  ((vec_t)( ( (ivec_t)(A) & (ivec_t)((A) < (B)) ) |		\
+	    ( (ivec_t)(B) & ~(ivec_t)((A) < (B)) ) ))
+#define PIP_COLL_VMAX(A,B)					\
+  ((vec_t)( ( (ivec_t)(A) & (ivec_t)((A) > (B)) ) |		\
+	    ( (ivec_t)(B) & ~(ivec_t)((A) > (B)) ) ))
+
+#define PIP_COLL_KERNEL(NAME,T,IT,VOP,SOP)				\
+  static void NAME( void *dstv, const void **srcv, int nsrc, size_t count ) { \
+    typedef T  vec_t  __attribute__((vector_size(PIP_COLL_VECSZ),aligned(1))); \
+    typedef IT ivec_t __attribute__((vector_size(PIP_COLL_VECSZ),aligned(1),unused)); \
+    const T	**srcs = (const T**) srcv;				\
+    T		*dst   = (T*) dstv;					\
+    size_t	nv     = PIP_COLL_VECSZ / sizeof(T), i;			\
+    int		j;							\
+    for( i=0; i+nv<=count; i+=nv ) {					\
+      vec_t acc = *(const vec_t*)( srcs[0] + i );			\
+      for( j=1; j<nsrc; j++ ) {						\
+	vec_t x = *(const vec_t*)( srcs[j] + i );			\
+	acc = VOP( acc, x );						\
+      }									\
+      *(vec_t*)( dst + i ) = acc;					\
+    }									\
+    for( ; i<count; i++ ) {						\
+      T acc = srcs[0][i];						\
+      for( j=1; j<nsrc; j++ ) acc = SOP( acc, srcs[j][i] );		\
+      dst[i] = acc;							\
+    }									\
+  }
+
+#define PIP_COLL_KERNELS(TN,T,IT)					\
+  PIP_COLL_KERNEL(pip_coll_sum_##TN,  T,IT,PIP_COLL_ADD, PIP_COLL_ADD)	\
+  PIP_COLL_KERNEL(pip_coll_prod_##TN, T,IT,PIP_COLL_MUL, PIP_COLL_MUL)	\
+  PIP_COLL_KERNEL(pip_coll_min_##TN,  T,IT,PIP_COLL_VMIN,PIP_COLL_SMIN) \
+  PIP_COLL_KERNEL(pip_coll_max_##TN,  T,IT,PIP_COLL_VMAX,PIP_COLL_SMAX)
+
+PIP_COLL_KERNELS(int32,  int32_t, int32_t)
+PIP_COLL_KERNELS(int64,  int64_t, int64_t)
+PIP_COLL_KERNELS(float,  float,   int32_t)
+PIP_COLL_KERNELS(double, double,  int64_t)
+
+#define PIP_COLL_KERNEL_ENTRY(TN)		\
+  { pip_coll_sum_##TN, pip_coll_prod_##TN,	\
+    pip_coll_min_##TN, pip_coll_max_##TN }
+
+/* indexed by PIP_COLL_<type> and PIP_COLL_<op> */
+static const pip_coll_kernel_t pip_coll_kernels[PIP_COLL_NTYPES][PIP_COLL_NOPS] = {
+  PIP_COLL_KERNEL_ENTRY(int32),
+  PIP_COLL_KERNEL_ENTRY(int64),
+  PIP_COLL_KERNEL_ENTRY(float),
+  PIP_COLL_KERNEL_ENTRY(double),
+};
+
+static const size_t pip_coll_typesz[PIP_COLL_NTYPES] = {
+  sizeof(int32_t), sizeof(int64_t), sizeof(float), sizeof(double)
+};
+
+INLINE int pip_coll_check( pip_coll_t *coll, int rank ) {
+  if( coll == NULL || coll->magic != PIP_COLL_MAGIC ) return EINVAL;
+  if( rank < 0 || rank >= coll->n ) return ERANGE;
+  return 0;
+}
+
+INLINE void pip_coll_sync( pip_coll_t *coll, int rank ) {
+  (void) pip_tree_barrier_wait( coll->barrier, rank );
+}
+
+INLINE void pip_coll_publish( pip_coll_t *coll,
+			      int rank,
+			      const void *sbuf,
+			      void *rbuf ) {
+  coll->slots[rank].sbuf = sbuf;
+  coll->slots[rank].rbuf = rbuf;
+  pip_coll_sync( coll, rank );
+}
+
+/* the part of count elements this rank is responsible for */
+INLINE void pip_coll_chunk( pip_coll_t *coll, int rank, size_t count,
+			    size_t *startp, size_t *countp ) {
+  size_t start = ( count * rank       ) / coll->n;
+  size_t end   = ( count * (rank + 1) ) / coll->n;
+  *startp = start;
+  *countp = end - start;
+}
+
+int pip_coll_create( pip_coll_t **collp, int n ) {
+  pip_coll_t	*coll;
+  int		err;
+
+  if( !pip_is_effective() ) RETURN( EPERM );
+  if( collp == NULL || n <= 0 ) RETURN( EINVAL );
+
+  if( pip_page_alloc( sizeof( pip_coll_t ) + sizeof( pip_coll_slot_t ) * n,
+		      (void**) &coll ) != 0 ) RETURN( ENOMEM );
+  memset( coll, 0, sizeof( pip_coll_t ) + sizeof( pip_coll_slot_t ) * n );
+  if( ( err = pip_tree_barrier_create( &coll->barrier, n ) ) != 0 ) {
+    pip_page_free( coll );
+    RETURN( err );
+  }
+  coll->n = n;
+  pip_memory_barrier();
+  coll->magic = PIP_COLL_MAGIC;
+
+  *collp = coll;
+  RETURN( 0 );
+}
+
+int pip_coll_destroy( pip_coll_t *coll ) {
+  int err;
+
+  if( coll == NULL || coll->magic != PIP_COLL_MAGIC ) RETURN( EINVAL );
+  if( ( err = pip_tree_barrier_destroy( coll->barrier ) ) != 0 ) RETURN( err );
+  coll->magic = 0;
+  pip_page_free( coll );
+  RETURN( 0 );
+}
+
+int pip_coll_barrier( pip_coll_t *coll, int rank ) {
+  int err;
+
+  if( ( err = pip_coll_check( coll, rank ) ) != 0 ) RETURN( err );
+  pip_coll_sync( coll, rank );
+  return 0;
+}
+
+int pip_coll_bcast( pip_coll_t *coll,
+		    int rank,
+		    void *buf,
+		    size_t size,
+		    int root ) {
+  int err;
+
+  if( ( err = pip_coll_check( coll, rank ) ) != 0 ) RETURN( err );
+  if( root < 0 || root >= coll->n ) RETURN( ERANGE );
+
+  pip_coll_publish( coll, rank, buf, buf );
+  if( rank != root && size > 0 ) {
+    memcpy( buf, coll->slots[root].sbuf, size );
+  }
+  /* the root buffer must not be modified until all copied it */
+  pip_coll_sync( coll, rank );
+  return 0;
+}
+
+int pip_coll_reduce( pip_coll_t *coll,
+		     int rank,
+		     const void *sbuf,
+		     void *rbuf,
+		     size_t count,
+		     int type,
+		     int op,
+		     int root ) {
+  const void	**srcs;
+  size_t	start, cnt, tsz;
+  int		i, err;
+
+  if( ( err = pip_coll_check( coll, rank ) ) != 0 ) RETURN( err );
+  if( root < 0 || root >= coll->n ) RETURN( ERANGE );
+  if( type < 0 || type >= PIP_COLL_NTYPES ||
+      op   < 0 || op   >= PIP_COLL_NOPS ) RETURN( EINVAL );
+
+  tsz  = pip_coll_typesz[type];
+  srcs = (const void**) alloca( sizeof( void* ) * coll->n );
+  pip_coll_publish( coll, rank, sbuf, rbuf );
+  /* every rank reduces its own part directly into the root buffer */
+  pip_coll_chunk( coll, rank, count, &start, &cnt );
+  if( cnt > 0 ) {
+    for( i=0; i<coll->n; i++ ) {
+      srcs[i] = coll->slots[i].sbuf + start * tsz;
+    }
+    pip_coll_kernels[type][op]( coll->slots[root].rbuf + start * tsz,
+				srcs, coll->n, cnt );
+  }
+  pip_coll_sync( coll, rank );
+  return 0;
+}
+
+int pip_coll_allreduce( pip_coll_t *coll,
+			int rank,
+			const void *sbuf,
+			void *rbuf,
+			size_t count,
+			int type,
+			int op ) {
+  const void	**srcs;
+  size_t	start, cnt, tsz;
+  int		i, err;
+
+  if( ( err = pip_coll_check( coll, rank ) ) != 0 ) RETURN( err );
+  if( type < 0 || type >= PIP_COLL_NTYPES ||
+      op   < 0 || op   >= PIP_COLL_NOPS ) RETURN( EINVAL );
+
+  tsz  = pip_coll_typesz[type];
+  srcs = (const void**) alloca( sizeof( void* ) * coll->n );
+  pip_coll_publish( coll, rank, sbuf, rbuf );
+  /* reduce-scatter, every rank reduces its own part */
+  pip_coll_chunk( coll, rank, count, &start, &cnt );
+  if( cnt > 0 ) {
+    for( i=0; i<coll->n; i++ ) {
+      srcs[i] = coll->slots[i].sbuf + start * tsz;
+    }
+    pip_coll_kernels[type][op]( rbuf + start * tsz, srcs, coll->n, cnt );
+  }
+  pip_coll_sync( coll, rank );
+  /* allgather, copy the other parts from their owners */
+  for( i=0; i<coll->n; i++ ) {
+    if( i == rank ) continue;
+    pip_coll_chunk( coll, i, count, &start, &cnt );
+    if( cnt > 0 ) {
+      memcpy( rbuf + start * tsz, coll->slots[i].rbuf + start * tsz,
+	      cnt * tsz );
+    }
+  }
+  pip_coll_sync( coll, rank );
+  return 0;
+}
+
+int pip_coll_allgather( pip_coll_t *coll,
+			int rank,
+			const void *sbuf,
+			size_t size,
+			void *rbuf ) {
+  int i, j, err;
+
+  if( ( err = pip_coll_check( coll, rank ) ) != 0 ) RETURN( err );
+
+  pip_coll_publish( coll, rank, sbuf, rbuf );
+  if( size > 0 ) {
+    /* start from the next rank not to read the same buffer at once */
+    for( j=0; j<coll->n; j++ ) {
+      i = ( rank + j ) % coll->n;
+      memcpy( rbuf + size * i, coll->slots[i].sbuf, size );
+    }
+  }
+  pip_coll_sync( coll, rank );
+  return 0;
+}
+
+int pip_coll_alltoall( pip_coll_t *coll,
+		       int rank,
+		       const void *sbuf,
+		       size_t size,
+		       void *rbuf ) {
+  int i, j, err;
+
+  if( ( err = pip_coll_check( coll, rank ) ) != 0 ) RETURN( err );
+
+  pip_coll_publish( coll, rank, sbuf, rbuf );
+  if( size > 0 ) {
+    for( j=0; j<coll->n; j++ ) {
+      i = ( rank + j ) % coll->n;
+      memcpy( rbuf + size * i, coll->slots[i].sbuf + size * rank, size );
+    }
+  }
+  pip_coll_sync( coll, rank );
+  return 0;
+}
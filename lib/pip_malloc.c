@@ -34,6 +34,7 @@
  */
 
 #include <pip/pip_internal.h>
+#include <pip/pip_mem.h>
 #include <malloc.h>
 
 #ifdef DEBUG
@@ -45,6 +46,317 @@ int	pip_dont_wrap_malloc PIP_PRIVATE = 1;
 #define PIP_MALLOC
 #ifdef PIP_MALLOC
 
+/*
+ * Small blocks are allocated from a per-task arena. The root reserves
+ * one contiguous virtual address range at pip_init() and every PiP task
+ * (and the root) owns a power-of-two sized slice of it. The owner of a
+ * block is therefore found by address arithmetic only. Each arena is
+ * carved into slabs of a single size class and the slab header holds the
+ * size class. A block free()ed by a task other than its owner is put
+ * in a per-destination batch kept by the freeing task, and a batch is
+ * pushed onto the owner's remote free list of the size class with a
+ * single CAS. When the owner's free list of a size class runs dry, the
+ * whole remote list of the class becomes its free list at once.
+ *
+ * Larger blocks, aligned blocks and the blocks which cannot be served by
+ * an arena are allocated by the libc malloc with the trailer telling the
+ * owner's PIPID (the former pip_malloc implementation).
+ */
+
+#define PIP_ARENA_MAGIC		(0xA7E4A7E4U)
+#define PIP_ARENA_SLAB_MAGIC	(0x51AB51ABU)
+#define PIP_ARENA_TASK_SZ	(4UL<<30) /* must be a power of 2 */
+#define PIP_ARENA_TASK_SZ_MIN	(256UL<<20)
+#define PIP_ARENA_WHOLE_MAX	(16UL<<40) /* address space reserved */
+#define PIP_ARENA_SLAB_SZ	(256UL*1024)
+#define PIP_ARENA_SLAB_HDR	(64)
+#define PIP_ARENA_COMMIT_SZ	(4UL*1024*1024)
+#define PIP_ARENA_NCLASS	(40)
+#define PIP_ARENA_SIZE_MAX	(32UL*1024)
+#define PIP_ARENA_ALIGN		(16)
+#define PIP_ARENA_NBATCH	(64)	/* must be a power of 2 */
+#define PIP_ARENA_BATCH_MAX	(32)
+#define PIP_MALLOC_DRAIN_MAX	(16)
+
+typedef struct pip_arena_slab {
+  uint32_t		magic;
+  uint32_t		cls;
+} pip_arena_slab_t;
+
+struct pip_arena;
+
+/* blocks to be returned to another arena */
+typedef struct pip_arena_batch {
+  struct pip_arena	*dest;
+  int			cls;
+  int			count;
+  void			*head;
+  void			*tail;
+} pip_arena_batch_t;
+
+typedef struct pip_arena {
+  uint32_t		magic;
+  int			index;
+  int			nbatched;
+  size_t		bump;	   /* offset of the next fresh slab */
+  size_t		committed; /* accessible up to this offset */
+  void			*free_list[PIP_ARENA_NCLASS];
+  void			*carve[PIP_ARENA_NCLASS];
+  void			*carve_end[PIP_ARENA_NCLASS];
+  /* freed by the other tasks */
+  pip_atomic_t		remote_free[PIP_ARENA_NCLASS];
+  pip_arena_batch_t	batch[PIP_ARENA_NBATCH];
+} pip_arena_t;
+
+/* Each PiP task has its own copy of these variables */
+static uintptr_t	pip_arena_base  = 0;
+static size_t		pip_arena_whole = 0;
+static size_t		pip_arena_tsz   = 0;
+/* Only the thread attached to an arena (the task itself) allocates */
+/* from it, so that the free lists, the carving slabs and the batches */
+/* are never shared and need no lock.  The other threads created by   */
+/* the task use the libc malloc and return arena blocks through the   */
+/* lock-free remote lists, as the other tasks do.                     */
+static __thread pip_arena_t *pip_arena_mine = NULL;
+static unsigned int	pip_arena_policy = 0;
+static int		pip_arena_node   = PIP_NUMA_NONE;
+
+INLINE int pip_arena_class( size_t size ) {
+  size_t s;
+  int    b;
+
+  if( size <= 128 ) return ( size <= 16 ) ? 0 : ( ( size + 15 ) >> 4 ) - 1;
+  s = size - 1;
+  b = 63 - __builtin_clzl( s );
+  return 8 + ( b - 7 ) * 4 + ( ( s >> ( b - 2 ) ) & 3 );
+}
+
+INLINE size_t pip_arena_class_size( int cls ) {
+  int g, b;
+
+  if( cls < 8 ) return ( cls + 1 ) * 16;
+  g = ( cls - 8 ) >> 2;
+  b = 7 + g;
+  return ( 1UL << b ) + ( ( ( cls - 8 ) & 3 ) + 1 ) * ( 1UL << ( b - 2 ) );
+}
+
+INLINE pip_arena_t *pip_arena_of( void *addr ) {
+  uintptr_t off = (uintptr_t) addr - pip_arena_base;
+  if( off >= pip_arena_whole ) return NULL;
+  return (pip_arena_t*) ( pip_arena_base + ( off & ~( pip_arena_tsz - 1 ) ) );
+}
+
+INLINE pip_arena_slab_t *pip_arena_slab_of( void *addr ) {
+  return (pip_arena_slab_t*)
+    ( (uintptr_t) addr & ~( PIP_ARENA_SLAB_SZ - 1 ) );
+}
+
+void pip_arena_init_root( pip_root_t *root ) {
+  size_t tsz = PIP_ARENA_TASK_SZ;
+  size_t whole;
+  void   *region;
+
+  /* many tasks get smaller arenas not to exhaust the address space */
+  while( tsz > PIP_ARENA_TASK_SZ_MIN &&
+	 tsz * ( root->ntasks + 1 ) > PIP_ARENA_WHOLE_MAX ) tsz /= 2;
+  whole = tsz * ( root->ntasks + 1 );
+
+  if( pip_arena_base != 0 &&
+      pip_arena_tsz  == tsz &&
+      pip_arena_whole >= whole ) {
+    /* reuse the region reserved by the previous pip_init() */
+    region = (void*) pip_arena_base;
+  } else {
+    /* reserve address space only, pages are made accessible on demand */
+    region = mmap( NULL,
+		   whole + tsz,
+		   PROT_NONE,
+		   MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+		   -1,
+		   0 );
+    if( region == MAP_FAILED ) {
+      /* pip_malloc() falls back to the libc malloc */
+      root->arena_base = NULL;
+      root->arena_size = 0;
+      return;
+    }
+    region = (void*) ( ( (uintptr_t) region + tsz - 1 ) & ~( tsz - 1 ) );
+  }
+  root->arena_base = region;
+  root->arena_size = tsz;
+  pip_arena_attach( root->task_root );
+}
+
+void pip_arena_attach( pip_task_t *task ) {
+  pip_root_t  *root = task->task_root;
+  pip_arena_t *arena;
+  int         idx;
+
+  pip_arena_mine = NULL;
+  if( root == NULL || root->arena_base == NULL ) return;
+
+  pip_arena_base  = (uintptr_t) root->arena_base;
+  pip_arena_tsz   = root->arena_size;
+  pip_arena_whole = pip_arena_tsz * ( root->ntasks + 1 );
+  /* hugetlb pages cannot back an existing mapping */
+  pip_arena_policy = root->mem_policy & ~PIP_MEM_HUGETLB;
+  pip_arena_node   = task->numa_node;
+
+  idx = task - root->tasks;
+  arena = (pip_arena_t*) ( pip_arena_base + pip_arena_tsz * idx );
+  if( arena->magic != PIP_ARENA_MAGIC ) {
+    /* the first task using this slot, the arena of a terminated */
+    /* task is inherited so that blocks still in use stay valid   */
+    if( mprotect( arena, PIP_ARENA_COMMIT_SZ, PROT_READ | PROT_WRITE ) != 0 ) {
+      return;
+    }
+    pip_mem_place( arena, PIP_ARENA_COMMIT_SZ,
+		   pip_arena_policy, pip_arena_node );
+    memset( arena, 0, sizeof(pip_arena_t) );
+    arena->index     = idx;
+    arena->bump      = PIP_ARENA_SLAB_SZ; /* 1st slab holds the header */
+    arena->committed = PIP_ARENA_COMMIT_SZ;
+    arena->magic     = PIP_ARENA_MAGIC;
+  }
+  pip_arena_mine = arena;
+}
+
+/* take all blocks returned by the others, the free list must be empty */
+INLINE void *pip_arena_reclaim( pip_arena_t *arena, int cls ) {
+  pip_atomic_t *remotep = &arena->remote_free[cls];
+  pip_atomic_t list;
+
+  do {
+    list = *remotep;
+    if( list == 0 ) return NULL;
+  } while( pip_comp_and_swap( remotep, list, (pip_atomic_t) 0 ) == 0 );
+  return (void*) list;
+}
+
+static void pip_arena_flush( pip_arena_batch_t *batch ) {
+  pip_atomic_t *remotep = &batch->dest->remote_free[batch->cls];
+  pip_atomic_t list;
+
+  do {
+    list = *remotep;
+    *(pip_atomic_t*)batch->tail = list;
+  } while( pip_comp_and_swap( remotep, list, (pip_atomic_t) batch->head )
+	   == 0 );
+  batch->dest  = NULL;
+  batch->head  = NULL;
+  batch->tail  = NULL;
+  batch->count = 0;
+}
+
+static void pip_arena_flush_all( pip_arena_t *arena ) {
+  int i;
+
+  for( i=0; i<PIP_ARENA_NBATCH && arena->nbatched>0; i++ ) {
+    if( arena->batch[i].dest != NULL ) {
+      pip_arena_flush( &arena->batch[i] );
+      arena->nbatched --;
+    }
+  }
+}
+
+static int pip_arena_new_slab( pip_arena_t *arena, int cls ) {
+  pip_arena_slab_t *slab;
+  size_t	   commit;
+
+  if( arena->bump + PIP_ARENA_SLAB_SZ > arena->committed ) {
+    commit = arena->committed + PIP_ARENA_COMMIT_SZ;
+    if( commit > pip_arena_tsz ) return ENOMEM;
+    if( mprotect( (void*) arena + arena->committed,
+		  PIP_ARENA_COMMIT_SZ,
+		  PROT_READ | PROT_WRITE ) != 0 ) return errno;
+    pip_mem_place( (void*) arena + arena->committed, PIP_ARENA_COMMIT_SZ,
+		   pip_arena_policy, pip_arena_node );
+    arena->committed = commit;
+  }
+  slab = (pip_arena_slab_t*) ( (void*) arena + arena->bump );
+  arena->bump += PIP_ARENA_SLAB_SZ;
+  slab->magic = PIP_ARENA_SLAB_MAGIC;
+  slab->cls   = cls;
+  arena->carve[cls]     = (void*) slab + PIP_ARENA_SLAB_HDR;
+  arena->carve_end[cls] = (void*) slab + PIP_ARENA_SLAB_SZ;
+  return 0;
+}
+
+static void *pip_arena_alloc( size_t size ) {
+  pip_arena_t	*arena = pip_arena_mine;
+  size_t	csz;
+  void		*p;
+  int		cls;
+
+  cls = pip_arena_class( size );
+  if( ( p = arena->free_list[cls] ) != NULL ) {
+    arena->free_list[cls] = *(void**)p;
+    return p;
+  }
+  if( ( p = pip_arena_reclaim( arena, cls ) ) != NULL ) {
+    arena->free_list[cls] = *(void**)p;
+    return p;
+  }
+  csz = pip_arena_class_size( cls );
+  if( arena->carve[cls] + csz > arena->carve_end[cls] ) {
+    /* slow path, let the others have the blocks held in batches */
+    if( arena->nbatched > 0 ) pip_arena_flush_all( arena );
+    if( pip_arena_new_slab( arena, cls ) != 0 ) return NULL;
+  }
+  p = arena->carve[cls];
+  arena->carve[cls] += csz;
+  return p;
+}
+
+static void pip_arena_free( pip_arena_t *arena, void *addr ) {
+  pip_arena_t       *mine = pip_arena_mine;
+  pip_arena_batch_t *batch;
+  int               cls = pip_arena_slab_of( addr )->cls;
+
+  if( arena == mine ) {
+    *(void**)addr = arena->free_list[cls];
+    arena->free_list[cls] = addr;
+
+  } else if( mine == NULL ) {
+    pip_arena_batch_t single = { arena, cls, 1, addr, addr };
+    pip_arena_flush( &single );
+
+  } else {
+    /* return to the owner in a batch */
+    batch = &mine->batch[ ( arena->index * PIP_ARENA_NCLASS + cls ) &
+			  ( PIP_ARENA_NBATCH - 1 ) ];
+    if( batch->dest != arena || batch->cls != cls ) {
+      if( batch->dest != NULL ) {
+	pip_arena_flush( batch );
+      } else {
+	mine->nbatched ++;
+      }
+      batch->dest = arena;
+      batch->cls  = cls;
+      batch->tail = addr;
+    }
+    *(void**)addr = batch->head;
+    batch->head   = addr;
+    if( ++batch->count >= PIP_ARENA_BATCH_MAX ) {
+      pip_arena_flush( batch );
+      mine->nbatched --;
+    }
+  }
+}
+
+INLINE size_t pip_arena_usable_size( void *addr ) {
+  return pip_arena_class_size( pip_arena_slab_of( addr )->cls );
+}
+
+INLINE int pip_arena_enabled( void ) {
+  return !pip_dont_wrap_malloc &&
+    pip_arena_mine != NULL     &&
+    pip_root       != NULL     &&
+    pip_task       != NULL;
+}
+
+/* libc malloc with the trailer */
+
 typedef struct pip_malloc_info {
   uint32_t	magic;
   int		pipid;
@@ -93,6 +405,7 @@ size_t pip_malloc_usable_size( void *ptr ) {
   size_t 	sz;
 
   if( ptr == NULL ) return 0;
+  if( pip_arena_of( ptr ) != NULL ) return pip_arena_usable_size( ptr );
   sz = pip_malloc_usable_size_orig( ptr );
   pipid = pip_is_pip_malloced( ptr );
   if( pipid == PIP_PIPID_ROOT ||
@@ -123,40 +436,50 @@ static int pip_get_pipid_curr( void ) {
   return pipid;
 }
 
-void pip_free_all( void ) {
-  pip_task_t	*task = NULL;
-
-  if( pip_task != NULL ) {
-    task = pip_task;
+/* free at most max blocks returned by the others, the whole list */
+/* is taken at once so that there is no ABA even if the task has   */
+/* more than one thread, the rest is pushed back                    */
+static void pip_libc_drain( int max ) {
+  pip_atomic_t	*free_listp, free_list, list, tail, next;
+  int		i;
+
+  if( pip_task == NULL ) return;
+  free_listp = &pip_task->malloc_free_list;
+  do {
+    if( ( free_list = *free_listp ) == 0 ) return;
+  } while( pip_comp_and_swap( free_listp, free_list, (pip_atomic_t) 0 ) == 0 );
+
+  for( i=0; i<max && free_list!=0; i++ ) {
+    next = *(pip_atomic_t*)free_list;
+    DBGF( "free_list: %p", (void*)free_list );
+    __libc_free( (void*)free_list );
+    free_list = next;
   }
-
-  if( task != NULL && task->malloc_free_list != 0 ) {
-    pip_atomic_t free_list, *free_listp;
-
-    ENTER;
-    free_listp = &task->malloc_free_list;
+  if( free_list != 0 ) {
+    for( tail=free_list;
+	 *(pip_atomic_t*)tail != 0;
+	 tail=*(pip_atomic_t*)tail );
     do {
-      free_list = *free_listp;
-    } while( pip_comp2_and_swap( free_listp, free_list, (pip_atomic_t) 0 ) == 0 );
-    
-    while( free_list != 0 ) {
-      pip_atomic_t *next = *(pip_atomic_t**)free_list;
-      DBGF( "free_list: %p", (void*)free_list );
-      __libc_free( (void*)free_list );
-      free_list = (pip_atomic_t) next;
-    }
-    RETURNV;
+      list = *free_listp;
+      *(pip_atomic_t*)tail = list;
+    } while( pip_comp_and_swap( free_listp, list, free_list ) == 0 );
   }
 }
 
-void pip_free( void *addr ) {
+void pip_free_all( void ) {
+  pip_arena_t *mine = pip_arena_mine;
+
+  if( mine != NULL && mine->nbatched > 0 ) pip_arena_flush_all( mine );
+  pip_libc_drain( INT32_MAX );
+}
+
+static void pip_libc_free( void *addr ) {
   volatile pip_atomic_t free_list;
   pip_atomic_t	*free_listp;
   pip_task_t	*task;
   int 		pipid, self;
 
-  pip_free_all();
-  if( addr == NULL ) return;
+  pip_libc_drain( PIP_MALLOC_DRAIN_MAX );
   if( pip_dont_wrap_malloc ||
       pip_root == NULL     ||
       pip_task == NULL ) {
@@ -185,17 +508,13 @@ void pip_free( void *addr ) {
   }
 }
 
-void free( void *addr ) {
-  pip_free( addr );
-}
-
-void *pip_malloc( size_t size ) {
+static void *pip_libc_malloc( size_t size ) {
   void *rv;
 
   if( pip_dont_wrap_malloc ) {
     rv = __libc_malloc( size );
   } else {
-    pip_free_all();
+    pip_libc_drain( PIP_MALLOC_DRAIN_MAX );
     if( pip_root == NULL || pip_task == NULL ) {
       rv = __libc_malloc( size );
     } else {
@@ -213,14 +532,42 @@ void *pip_malloc( size_t size ) {
   return rv;
 }
 
+void pip_free( void *addr ) {
+  pip_arena_t *arena;
+
+  if( addr == NULL ) return;
+  if( ( arena = pip_arena_of( addr ) ) != NULL ) {
+    pip_arena_free( arena, addr );
+  } else {
+    pip_libc_free( addr );
+  }
+}
+
+void free( void *addr ) {
+  pip_free( addr );
+}
+
+void *pip_malloc( size_t size ) {
+  void *rv;
+
+  if( size <= PIP_ARENA_SIZE_MAX &&
+      pip_arena_enabled()        &&
+      ( rv = pip_arena_alloc( size ) ) != NULL ) {
+    return rv;
+  }
+  return pip_libc_malloc( size );
+}
+
 void *malloc( size_t size ) {
   return pip_malloc( size );
 }
 
 void *pip_calloc( size_t nmemb, size_t size ) {
-  size_t	sz = nmemb * size;
-  void 		*rv = pip_malloc( sz );
-  if( rv != NULL ) memset( rv, 0, sz );
+  size_t	sz;
+  void 		*rv;
+
+  if( __builtin_mul_overflow( nmemb, size, &sz ) ) return NULL;
+  if( ( rv = pip_malloc( sz ) ) != NULL ) memset( rv, 0, sz );
   return rv;
 }
 
@@ -229,26 +576,26 @@ void *calloc( size_t nmemb, size_t size ) {
 }
 
 void *pip_realloc( void *ptr, size_t size ) {
-  pip_malloc_info_t	info;
-  size_t		sz;
-  void			*rv;
+  size_t	sz;
+  void		*rv;
 
-  pip_free_all();
-  if( pip_root == NULL || pip_task == NULL ) {
-    rv = __libc_realloc( ptr, size );
-  } else if( ptr == NULL ) {
-    rv = pip_malloc( size );
+  if( ptr == NULL ) return pip_malloc( size );
+  if( size == 0 ) {
+    pip_free( ptr );
+    return NULL;
+  }
+  if( pip_arena_of( ptr ) != NULL ) {
+    sz = pip_arena_usable_size( ptr );
+    if( size <= sz && size > sz / 2 ) return ptr;
+  } else if( pip_root == NULL || pip_task == NULL ) {
+    return __libc_realloc( ptr, size );
   } else {
-    if( ( rv = pip_malloc( size ) ) != NULL ) {
-      sz = pip_malloc_usable_size_orig( ptr );
-      int pipid = pip_is_pip_malloced( ptr );
-      if( pipid == PIP_PIPID_ROOT || pipid >= 0 ) {
-	sz -= sizeof(info);
-      }
-      sz = ( sz > size ) ? size : sz;
-      memcpy( rv, ptr, sz );
-      pip_free( ptr );
-    }
+    sz = pip_malloc_usable_size( ptr );
+  }
+  if( ( rv = pip_malloc( size ) ) != NULL ) {
+    sz = ( sz > size ) ? size : sz;
+    memcpy( rv, ptr, sz );
+    pip_free( ptr );
   }
   return rv;
 }
@@ -260,10 +607,11 @@ void *realloc( void *ptr, size_t size ) {
 void *pip_memalign( size_t alignment, size_t size ) {
   void	*rv;
 
+  if( alignment <= PIP_ARENA_ALIGN ) return pip_malloc( size );
   if( pip_dont_wrap_malloc ) {
     rv = __libc_memalign( alignment, size );
   } else {
-    pip_free_all();
+    pip_libc_drain( PIP_MALLOC_DRAIN_MAX );
     if( pip_root == NULL || pip_task == NULL ) {
       rv = __libc_memalign( alignment, size );
     } else {
@@ -347,4 +695,11 @@ int pip_posix_memalign( void **memptr, size_t alignment, size_t size ) {
 
 void pip_free_all( void ) { return; }
 
+void pip_arena_init_root( pip_root_t *root ) {
+  root->arena_base = NULL;
+  root->arena_size = 0;
+}
+
+void pip_arena_attach( pip_task_t *task ) { return; }
+
 #endif /* PIP_MALLOC */
@@ -0,0 +1,210 @@
+
+/*
+ * $PIP_license: <Simplified BSD License>
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *     Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ * 
+ *     Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ * $
+ * $RIKEN_copyright: Riken Center for Computational Sceience (R-CCS),
+ * System Software Development Team, 2016-2022
+ * $
+ * $PIP_VERSION: Version 2.4.1$
+ *
+ * $Author: Atsushi Hori 
+ * Query:   procinproc-info@googlegroups.com
+ * User ML: procinproc-users@googlegroups.com
+ * $
+ */
+
+#include <pip/pip_internal.h>
+#include <pip/pip_mem.h>
+
+#define PIP_NUMA_MASK_WORDS	(PIP_NUMA_NODES_MAX/(8*sizeof(unsigned long)))
+
+/* <numaif.h> is a part of libnuma */
+#define PIP_MPOL_PREFERRED	(1)
+#define PIP_MPOL_INTERLEAVE	(3)
+#define PIP_MPOL_MF_MOVE	(1<<1)
+
+unsigned int pip_mem_policy_env( void ) {
+  unsigned int policy = 0;
+  char *env;
+
+  if( ( env = getenv( PIP_ENV_HUGEPAGE ) ) != NULL ) {
+    if( strcasecmp( env, PIP_ENV_HUGEPAGE_THP ) == 0 ||
+	strcasecmp( env, "on" ) == 0 ) {
+      policy |= PIP_MEM_THP;
+    } else if( strcasecmp( env, PIP_ENV_HUGEPAGE_HUGETLB ) == 0 ) {
+      policy |= PIP_MEM_THP | PIP_MEM_HUGETLB;
+    }
+  }
+  if( ( env = getenv( PIP_ENV_NUMA ) ) != NULL &&
+      strcasecmp( env, "on" ) == 0 ) {
+    policy |= PIP_MEM_NUMA;
+  }
+  return policy;
+}
+
+int pip_numa_node_of_cpu( int cpu ) {
+  char		path[64];
+  DIR		*dir;
+  struct dirent *de;
+  int		node = PIP_NUMA_NONE;
+
+  snprintf( path, sizeof(path), "/sys/devices/system/cpu/cpu%d", cpu );
+  if( ( dir = opendir( path ) ) == NULL ) return PIP_NUMA_NONE;
+  while( ( de = readdir( dir ) ) != NULL ) {
+    if( strncmp( de->d_name, "node", 4 ) == 0 &&
+	de->d_name[4] >= '0' && de->d_name[4] <= '9' ) {
+      node = atoi( &de->d_name[4] );
+      break;
+    }
+  }
+  (void) closedir( dir );
+  return node;
+}
+
+/* the node where all CPUs in the set belong, if any */
+int pip_numa_node_of_cpuset( cpu_set_t *cpuset ) {
+  int cpu, n, node = PIP_NUMA_NONE;
+
+  for( cpu=0; cpu<CPU_SETSIZE; cpu++ ) {
+    if( !CPU_ISSET( cpu, cpuset ) ) continue;
+    n = pip_numa_node_of_cpu( cpu );
+    if( n < 0 ) return PIP_NUMA_NONE;
+    if( node == PIP_NUMA_NONE ) {
+      node = n;
+    } else if( node != n ) {
+      return PIP_NUMA_NONE;
+    }
+  }
+  return node;
+}
+
+static int pip_numa_online( unsigned long *mask ) {
+  char	buf[256], *p, *q;
+  long	from, to, n;
+  int	fd, rc, count = 0;
+
+  memset( mask, 0, sizeof(unsigned long) * PIP_NUMA_MASK_WORDS );
+  if( ( fd = open( "/sys/devices/system/node/online", O_RDONLY ) ) < 0 ) {
+    return 0;
+  }
+  rc = read( fd, buf, sizeof(buf) - 1 );
+  (void) close( fd );
+  if( rc <= 0 ) return 0;
+  buf[rc] = '\0';
+  /* "0-1,3" */
+  for( p=buf; *p!='\0' && *p!='\n'; p=q ) {
+    from = strtol( p, &q, 10 );
+    if( q == p ) break;
+    to = from;
+    if( *q == '-' ) to = strtol( q+1, &q, 10 );
+    if( *q == ',' ) q ++;
+    for( n=from; n<=to && n<PIP_NUMA_NODES_MAX; n++ ) {
+      mask[n/(8*sizeof(unsigned long))] |= 1UL << (n%(8*sizeof(unsigned long)));
+      count ++;
+    }
+  }
+  return count;
+}
+
+static int pip_mbind( void *addr, size_t len, int mode,
+		      unsigned long *mask, unsigned int flags ) {
+  return syscall( SYS_mbind, addr, len, mode, mask, PIP_NUMA_NODES_MAX + 1,
+		  flags );
+}
+
+/* advice only, errors are ignored */
+void
+pip_mem_place( void *addr, size_t len, unsigned int policy, int node ) {
+  unsigned long mask[PIP_NUMA_MASK_WORDS];
+
+  if( policy & PIP_MEM_THP ) {
+    (void) madvise( addr, len, MADV_HUGEPAGE );
+  }
+  if( policy & PIP_MEM_NUMA ) {
+    if( node == PIP_NUMA_INTERLEAVE ) {
+      if( pip_numa_online( mask ) > 1 ) {
+	(void) pip_mbind( addr, len, PIP_MPOL_INTERLEAVE, mask,
+			  PIP_MPOL_MF_MOVE );
+      }
+    } else if( node >= 0 && node < PIP_NUMA_NODES_MAX ) {
+      memset( mask, 0, sizeof(mask) );
+      mask[node/(8*sizeof(unsigned long))] =
+	1UL << (node%(8*sizeof(unsigned long)));
+      (void) pip_mbind( addr, len, PIP_MPOL_PREFERRED, mask,
+			PIP_MPOL_MF_MOVE );
+    }
+  }
+}
+
+/* hugetlb pages cannot be mprotect()ed page by page, the guard page */
+/* is a normal page mapped just below the hugetlb region              */
+static void *pip_stack_alloc_hugetlb( size_t size, size_t pgsz,
+				      size_t *mapszp ) {
+  size_t hsz = ( size + PIP_HUGEPAGE_SZ - 1 ) & ~( PIP_HUGEPAGE_SZ - 1 );
+  size_t rsz = hsz + 2 * PIP_HUGEPAGE_SZ;
+  void   *rsv, *top, *map;
+
+  /* reserve enough to find an aligned address, the guard stays PROT_NONE */
+  rsv = mmap( NULL, rsz, PROT_NONE,
+	      MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0 );
+  if( rsv == MAP_FAILED ) return NULL;
+  top = (void*) ( ( (uintptr_t) rsv + pgsz + PIP_HUGEPAGE_SZ - 1 ) &
+		  ~( PIP_HUGEPAGE_SZ - 1 ) );
+  if( mmap( top, hsz, PROT_READ | PROT_WRITE,
+	    MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK | MAP_HUGETLB | MAP_FIXED,
+	    -1, 0 ) == MAP_FAILED ) {
+    (void) munmap( rsv, rsz );
+    return NULL;
+  }
+  map = top - pgsz;
+  if( map > rsv ) (void) munmap( rsv, map - rsv );
+  (void) munmap( top + hsz, ( rsv + rsz ) - ( top + hsz ) );
+  *mapszp = hsz + pgsz;
+  return map;
+}
+
+/* task stack, the lowest page is the guard page */
+void *pip_stack_alloc( size_t size,
+		       unsigned int policy,
+		       int node,
+		       size_t *mapszp ) {
+  size_t pgsz  = sysconf( _SC_PAGESIZE );
+  size_t mapsz = size + pgsz;
+  void   *map;
+
+  if( policy & PIP_MEM_HUGETLB ) {
+    if( ( map = pip_stack_alloc_hugetlb( size, pgsz, mapszp ) ) != NULL ) {
+      pip_mem_place( map + pgsz, *mapszp - pgsz, policy & ~PIP_MEM_THP, node );
+      return map;
+    }
+    /* no hugetlb pages available, then THP */
+  }
+  map = mmap( NULL, mapsz, PROT_READ | PROT_WRITE,
+	      MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0 );
+  if( map == MAP_FAILED ) return NULL;
+  (void) mprotect( map, pgsz, PROT_NONE );
+  pip_mem_place( map + pgsz, mapsz - pgsz, policy, node );
+  *mapszp = mapsz;
+  return map;
+}
@@ -34,229 +34,632 @@
  */
 
 #include <pip/pip_internal.h>
-#include <pip/pip_list.h>
 
-#define PIP_HASHTAB_SZ	(1024)	/* must be power of 2 */
-//#define PIP_HASHTAB_SZ	(32)	/* must be power of 2 */
+#define PIP_HASHTAB_SZ		(64)	/* initial size, must be power of 2 */
+#define PIP_HASHTAB_LOAD_MAX	(2)	/* grow if entries > LOAD_MAX * sz */
 
-typedef uint64_t 		pip_hash_t;
+#define PIP_NAMEXP_SPIN		(1000)	/* spins before sleeping */
 
-struct pip_named_exptab;
+/* entry states, importers sleep on the state word as a futex */
+#define PIP_NAMEXP_QUERY	(0)
+#define PIP_NAMEXP_EXPORTED	(1)
+#define PIP_NAMEXP_CANCELED	(2)
+#define PIP_NAMEXP_WITHDRAWN	(3)	/* unexported */
 
-typedef struct pip_namexp_wait {
-  pip_list_t			list;
-  pip_sem_t			semaphore;
-  volatile void			*address;
-  volatile int			err;
-} pip_namexp_wait_t;
+typedef uint64_t 		pip_hash_t;
 
 typedef struct pip_namexp_entry {
-  pip_list_t			list; /* collision list */
+  struct pip_namexp_entry *volatile next; /* collision chain */
+  struct pip_namexp_entry	*retired;
   pip_hash_t			hashval;
+  size_t			len;
   char				*name;
   volatile void			*address;
-  char				flag_exported;
-  char				flag_canceled;
-  pip_sem_t			semaphore;
-  pip_list_t			list_wait; /* waiting list */
+  volatile uint32_t		state;
+  /* bumped whenever the address is replaced or unexported */
+  volatile uint64_t		version;
+  int				flag_exporting; /* by export_keys */
 } pip_namexp_entry_t;
 
-typedef struct pip_namexp_list {
-  pip_list_t			list;
-  pip_spinlock_t		lock;
-} pip_namexp_list_t;
+typedef struct pip_namexp_htab {
+  struct pip_namexp_htab	*retired;
+  size_t			sz;
+  pip_namexp_entry_t *volatile	buckets[];
+} pip_namexp_htab_t;
 
+/* Writers (export, query entries by import, and fin) take the lock */
+/* and bump the sequence number before and after changing the table */
+/* so that it is odd while the table is being changed. Readers of   */
+/* exported entries take no lock and retry if the sequence number   */
+/* changes. Unexported entries stay in the table and are exported  */
+/* again in place. Query entries canceled at the termination of the */
+/* task and old hash tables are retired. When the slot is reused,   */
+/* the next task gets a new table and the old one is retired as it  */
+/* is. Nothing retired is freed until the end.                      */
 typedef struct pip_named_exptab {
+  struct pip_named_exptab	*retired; /* previous tasks of the slot */
+  pip_spinlock_t		lock;
+  pip_atomic_t			seq;
+  pip_namexp_htab_t *volatile	htab;
+  size_t			nentries;
+  pip_namexp_entry_t		*retired_entries;
+  pip_namexp_htab_t		*retired_htabs;
   volatile int			flag_closed;
-  size_t			sz;
-  pip_namexp_list_t		*hash_table;
 } pip_named_exptab_t;
 
+static pip_namexp_htab_t *pip_namexp_new_htab( size_t sz ) {
+  pip_namexp_htab_t *htab;
+  size_t htsz = sizeof( pip_namexp_htab_t ) + sizeof( pip_namexp_entry_t* ) * sz;
 
-static void pip_add_namexp_entry( pip_namexp_list_t *head,
-				  pip_namexp_entry_t *entry ) {
-  PIP_LIST_ADD( (pip_list_t*) &head->list, (pip_list_t*) entry );
+  if( ( htab = (pip_namexp_htab_t*) malloc( htsz ) ) != NULL ) {
+    memset( htab, 0, htsz );
+    htab->sz = sz;
+  }
+  return htab;
 }
 
-void pip_named_export_init( pip_task_t *task ) {
+static pip_named_exptab_t *pip_namexp_new( void ) {
   pip_named_exptab_t 	*namexp;
-  pip_namexp_list_t	*hashtab;
-  int			i, sz = PIP_HASHTAB_SZ;
 
-  hashtab = (pip_namexp_list_t*)
-    malloc( sizeof( pip_namexp_list_t ) * sz );
-  ASSERTD( hashtab != NULL );
-  memset( hashtab, 0, sizeof( pip_namexp_list_t ) * sz );
-  for( i=0; i<sz; i++ ) {
-    PIP_LIST_INIT( &(hashtab[i].list) );
-    pip_spin_init( &(hashtab[i].lock) );
-  }
   namexp = (pip_named_exptab_t*) malloc( sizeof( pip_named_exptab_t ) );
-  ASSERTD( namexp != NULL );
+  ASSERT( namexp != NULL );
   memset( namexp, 0, sizeof( pip_named_exptab_t ) );
-  namexp->sz         = sz;
-  namexp->hash_table = hashtab;
-  task->named_exptab = (void*) namexp;
+  pip_spin_init( &namexp->lock );
+  namexp->htab = pip_namexp_new_htab( PIP_HASHTAB_SZ );
+  ASSERT( namexp->htab != NULL );
+  return namexp;
+}
+
+/* the table is created on the first access, not for every slot */
+static pip_named_exptab_t *pip_namexp_get( pip_task_t *task ) {
+  pip_named_exptab_t 	*namexp;
+
+  if( ( namexp = (pip_named_exptab_t*) task->named_exptab ) != NULL ) {
+    return namexp;
+  }
+  namexp = pip_namexp_new();
+  if( !__sync_bool_compare_and_swap( &task->named_exptab, NULL, namexp ) ) {
+    /* another task created it first */
+    free( namexp->htab );
+    free( namexp );
+  }
+  return (pip_named_exptab_t*) task->named_exptab;
+}
+
+static void pip_namexp_lock( pip_named_exptab_t *namexp ) {
+  pip_spin_lock( &namexp->lock );
+}
+
+static void pip_namexp_unlock( pip_named_exptab_t *namexp ) {
+  pip_spin_unlock( &namexp->lock );
+}
+
+/* must be called with the lock held */
+static void pip_namexp_write_begin( pip_named_exptab_t *namexp ) {
+  namexp->seq ++;
+  pip_memory_barrier();
 }
 
-static pip_namexp_list_t*
-pip_lock_hashtab_head( pip_named_exptab_t *namexp, pip_hash_t hash ) {
-  int			idx = hash & ( namexp->sz - 1 );
-  pip_namexp_list_t	*htab = namexp->hash_table;
-  pip_namexp_list_t	*head = &(htab[idx]);
-  //DBGF( "namexp:%p", namexp );
-  //DBGF( "head:%p  hash:0x%lu  sz:%lu  idx:%d", head, hash, namexp->sz, idx );
-  pip_spin_lock( &head->lock );
-  return head;
+static void pip_namexp_write_end( pip_named_exptab_t *namexp ) {
+  pip_memory_barrier();
+  namexp->seq ++;
 }
 
-static void pip_unlock_hashtab_head( pip_namexp_list_t *head ) {
-  pip_spin_unlock( &head->lock );
+/* FNV-1a followed by the MurmurHash3 finalizer, so that the lower */
+/* bits used for the bucket index depend on all characters        */
+static pip_hash_t pip_name_hash( const char *name, size_t len ) {
+  pip_hash_t hash = 0xcbf29ce484222325ULL;
+  size_t i;
+
+  for( i=0; i<len; i++ ) {
+    hash ^= (unsigned char) name[i];
+    hash *= 0x100000001b3ULL;
+  }
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdULL;
+  hash ^= hash >> 33;
+  hash *= 0xc4ceb9fe1a85ec53ULL;
+  hash ^= hash >> 33;
+  return hash;
 }
 
-static pip_hash_t
-pip_name_hash( char **namep, const char *format, va_list ap ) {
-  pip_hash_t	hash = 0;
-  char		*name = NULL;
-  int 		i;
+/* format a name into buf. only if it does not fit, the name is */
+/* formatted on heap and *heapp must be freed by the caller     */
+static char *pip_name_format( char *buf, char **heapp, size_t *lenp,
+			      const char *format, va_list ap ) {
+  va_list	aq;
+  int		len;
 
+  *heapp = NULL;
   if( format == NULL ) {
-    if( ( name = strdup( "" ) ) == NULL ) return 0;
-  } else {
-    if( vasprintf( &name, format, ap ) == 0 || name == NULL ) return 0;
-    for( i=0; name[i]!='\0'; i++ ) {
-      hash <<= 1;
-      hash ^= name[i];
+    buf[0] = '\0';
+    *lenp  = 0;
+    return buf;
+  }
+  va_copy( aq, ap );
+  len = vsnprintf( buf, PIP_NAMED_KEY_MAX, format, aq );
+  va_end( aq );
+  if( len < 0 ) return NULL;
+  if( len >= PIP_NAMED_KEY_MAX ) {
+    if( vasprintf( heapp, format, ap ) < 0 || *heapp == NULL ) {
+      *heapp = NULL;
+      return NULL;
     }
-    hash += i;
+    buf = *heapp;
   }
-  *namep = name;
-  return hash;
+  *lenp = len;
+  return buf;
+}
+
+int pip_named_key( pip_named_key_t *key, const char *format, ... ) {
+  va_list	ap;
+  int		len = 0;
+
+  ENTER;
+  if( key == NULL ) RETURN( EINVAL );
+  if( format == NULL ) {
+    key->name[0] = '\0';
+  } else {
+    va_start( ap, format );
+    len = vsnprintf( key->name, PIP_NAMED_KEY_MAX, format, ap );
+    va_end( ap );
+    if( len < 0 ) RETURN( EINVAL );
+    if( len >= PIP_NAMED_KEY_MAX ) RETURN( ENAMETOOLONG );
+  }
+  key->len  = len;
+  key->hash = pip_name_hash( key->name, len );
+  RETURN( 0 );
+}
+
+/* lock-free lookup of an exported entry */
+static pip_namexp_entry_t *
+pip_read_namexp( pip_named_exptab_t *namexp,
+		 pip_hash_t hash, const char *name, size_t len ) {
+  pip_namexp_htab_t	*htab;
+  pip_namexp_entry_t	*entry;
+  pip_atomic_t		seq;
+
+  do {
+    while( ( seq = namexp->seq ) & 1 ) pip_pause();
+    pip_memory_barrier();
+    htab = namexp->htab;
+    for( entry = htab->buckets[ hash & ( htab->sz - 1 ) ];
+	 entry != NULL;
+	 entry = entry->next ) {
+      if( entry->hashval == hash   &&
+	  entry->len     == len    &&
+	  entry->state   == PIP_NAMEXP_EXPORTED &&
+	  memcmp( entry->name, name, len ) == 0 ) break;
+    }
+    pip_memory_barrier();
+  } while( seq != namexp->seq );
+  DBGF( "%s -- name:'%s'", ( entry != NULL ) ? "FOUND" : "NOT found", name );
+  return entry;
 }
 
+/* must be called with the lock held */
 static pip_namexp_entry_t*
-pip_find_namexp( pip_namexp_list_t *head, pip_hash_t hash, char *name ) {
-  pip_list_t		*entry;
-  pip_namexp_entry_t	*name_entry;
-
-  DBGF( "head:%p  name:'%s'", head, name );
-  PIP_LIST_FOREACH( (pip_list_t*) &head->list, entry ) {
-    name_entry = (pip_namexp_entry_t*) entry;
-    //DBGF( "entry:%p  hash:0x%lx/0x%lx  name:%s/%s",
-    //name_entry, name_entry->hashval, hash, name_entry->name, name );
-    if( name_entry->hashval == hash &&
-	strcmp( name_entry->name, name ) == 0 ) {
-      DBGF( "FOUND -- head:%p  name:'%s'", head, name );
-      return name_entry;
+pip_find_namexp( pip_named_exptab_t *namexp,
+		 pip_hash_t hash, const char *name, size_t len ) {
+  pip_namexp_htab_t	*htab = namexp->htab;
+  pip_namexp_entry_t	*entry;
+
+  DBGF( "name:'%s'", name );
+  for( entry = htab->buckets[ hash & ( htab->sz - 1 ) ];
+       entry != NULL;
+       entry = entry->next ) {
+    if( entry->hashval == hash &&
+	entry->len     == len  &&
+	memcmp( entry->name, name, len ) == 0 ) {
+      DBGF( "FOUND -- name:'%s'", name );
+      return entry;
     }
   }
-  DBGF( "NOT found -- head:%p  name:'%s'", head, name );
+  DBGF( "NOT found -- name:'%s'", name );
   return NULL;
 }
 
+/* must be called in the write section */
+static void pip_namexp_grow( pip_named_exptab_t *namexp ) {
+  pip_namexp_htab_t	*old = namexp->htab, *new;
+  pip_namexp_entry_t	*entry, *next;
+  size_t		i, idx;
+
+  /* if it fails, the table stays as it is */
+  if( ( new = pip_namexp_new_htab( old->sz * 2 ) ) == NULL ) return;
+  for( i=0; i<old->sz; i++ ) {
+    for( entry=old->buckets[i]; entry!=NULL; entry=next ) {
+      next = entry->next;
+      idx  = entry->hashval & ( new->sz - 1 );
+      entry->next = new->buckets[idx];
+      new->buckets[idx] = entry;
+    }
+  }
+  DBGF( "hash table grows: %lu -> %lu", old->sz, new->sz );
+  namexp->htab = new;
+  old->retired = namexp->retired_htabs;
+  namexp->retired_htabs = old;
+}
+
+/* must be called in the write section */
+static void pip_add_namexp_entry( pip_named_exptab_t *namexp,
+				  pip_namexp_entry_t *entry ) {
+  pip_namexp_htab_t *htab = namexp->htab;
+  size_t idx = entry->hashval & ( htab->sz - 1 );
+
+  entry->next = htab->buckets[idx];
+  pip_memory_barrier();
+  htab->buckets[idx] = entry;
+  if( ++namexp->nentries > htab->sz * PIP_HASHTAB_LOAD_MAX ) {
+    pip_namexp_grow( namexp );
+  }
+}
+
+/* must be called in the write section */
+static void pip_unlink_namexp_entry( pip_named_exptab_t *namexp,
+				     pip_namexp_entry_t *entry ) {
+  pip_namexp_htab_t *htab = namexp->htab;
+  pip_namexp_entry_t *volatile *prevp;
+
+  for( prevp = &htab->buckets[ entry->hashval & ( htab->sz - 1 ) ];
+       *prevp != NULL;
+       prevp = &(*prevp)->next ) {
+    if( *prevp == entry ) {
+      *prevp = entry->next;
+      namexp->nentries --;
+      break;
+    }
+  }
+}
+
+static void pip_retire_namexp_entry( pip_named_exptab_t *namexp,
+				     pip_namexp_entry_t *entry ) {
+  /* readers may still be looking at this */
+  entry->retired = namexp->retired_entries;
+  namexp->retired_entries = entry;
+}
+
+/* must be called in the write section */
+static void pip_del_namexp_entry( pip_named_exptab_t *namexp,
+				  pip_namexp_entry_t *entry ) {
+  pip_unlink_namexp_entry( namexp, entry );
+  pip_retire_namexp_entry( namexp, entry );
+}
+
 static pip_namexp_entry_t *
-pip_new_entry( pip_named_exptab_t *namexp, char *name, pip_hash_t hash ) {
+pip_new_entry( pip_hash_t hash, const char *name, size_t len ) {
   pip_namexp_entry_t 	*entry;
 
   entry = (pip_namexp_entry_t*) malloc( sizeof( pip_namexp_entry_t ) );
   if( entry == NULL ) return NULL;
   memset( entry, 0, sizeof( pip_namexp_entry_t ) );
+  if( ( entry->name = (char*) malloc( len + 1 ) ) == NULL ) {
+    free( entry );
+    return NULL;
+  }
+  memcpy( entry->name, name, len );
+  entry->name[len] = '\0';
   DBGF( "entry:%p  %s@0x%lx", entry, name, hash );
-  PIP_LIST_INIT( &entry->list );
-  PIP_LIST_INIT( &entry->list_wait );
-  pip_sem_init( &entry->semaphore );
   entry->hashval = hash;
-  entry->name    = name;
+  entry->len     = len;
   return entry;
 }
 
-int pip_named_export( void *exp, const char *format, ... ) {
+/* the entry must have been unlinked in the write section */
+static void pip_namexp_wakeup( pip_namexp_entry_t *entry,
+			       void *address,
+			       uint32_t state ) {
+  entry->address = address;
+  pip_memory_barrier();
+  entry->state = state;
+  /* all waiting imports are resumed at once */
+  pip_futex_wake_all( &entry->state );
+}
+
+/* must be called in the write section. a query entry or an */
+/* unexported entry is exported in place                    */
+static void pip_namexp_revive( pip_namexp_entry_t *entry, void *address ) {
+  int waiting = ( entry->state == PIP_NAMEXP_QUERY );
+
+  entry->address = address;
+  pip_memory_barrier();
+  entry->state = PIP_NAMEXP_EXPORTED;
+  pip_memory_barrier();
+  entry->version ++;
+  /* all waiting imports are resumed at once */
+  if( waiting ) pip_futex_wake_all( &entry->state );
+}
+
+/* must be called with the lock held. an unexported entry is */
+/* turned back into a query entry to wait for the next export */
+static void pip_namexp_requery( pip_named_exptab_t *namexp,
+				pip_namexp_entry_t *entry ) {
+  pip_namexp_write_begin( namexp );
+  entry->state = PIP_NAMEXP_QUERY;
+  pip_namexp_write_end( namexp );
+}
+
+static int pip_namexp_wait( pip_namexp_entry_t *entry,
+			    const struct timespec *timeout,
+			    volatile void **addressp ) {
+  struct timespec	ts, *deadline;
+  int			i;
+
+  deadline = pip_sync_deadline( timeout, &ts );
+  for( i=0; i<PIP_NAMEXP_SPIN; i++ ) {
+    if( entry->state != PIP_NAMEXP_QUERY ) break;
+    pip_pause();
+  }
+  while( entry->state == PIP_NAMEXP_QUERY ) {
+    if( pip_futex_wait_until( &entry->state,
+			      PIP_NAMEXP_QUERY,
+			      deadline ) == ETIMEDOUT ) return ETIMEDOUT;
+  }
+  pip_memory_barrier();
+  if( entry->state == PIP_NAMEXP_CANCELED ) return ECANCELED;
+  *addressp = entry->address;
+  return 0;
+}
+
+static int pip_do_named_export( void *exp,
+				int flag_replace,
+				uint64_t *versionp,
+				pip_hash_t hash,
+				const char *name,
+				size_t len ) {
   pip_named_exptab_t *namexp;
   pip_namexp_entry_t *entry, *new;
-  pip_namexp_list_t  *head = NULL;
-  pip_list_t	     *list, *next;
-  pip_namexp_wait_t  *waitp;
-  va_list 	ap;
-  pip_hash_t 	hash;
-  char 		*name = NULL;
   int 		err = 0;
 
+  ENTER;
+  DBGF( "pipid:%d  name:'%s'  exp:%p", pip_task->pipid, name, exp );
+  namexp = pip_namexp_get( pip_task );
+
+  pip_namexp_lock( namexp );
+  entry = pip_find_namexp( namexp, hash, name, len );
+  if( entry != NULL && entry->state == PIP_NAMEXP_EXPORTED ) {
+    if( !flag_replace ) {
+      /* already exported */
+      err = EBUSY;
+    } else {
+      pip_namexp_write_begin( namexp );
+      entry->address = exp;
+      pip_memory_barrier();
+      entry->version ++;
+      pip_namexp_write_end( namexp );
+      if( versionp != NULL ) *versionp = entry->version;
+    }
+  } else if( entry != NULL ) {
+    /* queried, or unexported before. the subscribers of the */
+    /* previous export see this as a new version             */
+    pip_namexp_write_begin( namexp );
+    pip_namexp_revive( entry, exp );
+    pip_namexp_write_end( namexp );
+    if( versionp != NULL ) *versionp = entry->version;
+  } else if( ( new = pip_new_entry( hash, name, len ) ) == NULL ) {
+    err = ENOMEM;
+  } else {
+    new->address = exp;
+    new->state   = PIP_NAMEXP_EXPORTED;
+    new->version = 1;
+    if( versionp != NULL ) *versionp = new->version;
+    pip_namexp_write_begin( namexp );
+    pip_add_namexp_entry( namexp, new );
+    pip_namexp_write_end( namexp );
+  }
+  pip_namexp_unlock( namexp );
+  RETURN( err );
+}
+
+int pip_named_export( void *exp, const char *format, ... ) {
+  char		buf[PIP_NAMED_KEY_MAX];
+  char		*name, *heap;
+  size_t	len;
+  va_list 	ap;
+  int 		err;
+
   ENTER;
   if( !pip_is_effective() ) RETURN( EPERM );
+  va_start( ap, format );
+  name = pip_name_format( buf, &heap, &len, format, ap );
+  va_end( ap );
+  if( name == NULL ) RETURN( ENOMEM );
+  err = pip_do_named_export( exp, 0, NULL,
+			     pip_name_hash( name, len ), name, len );
+  free( heap );
+  RETURN( err );
+}
 
+int pip_named_export_key( void *exp, const pip_named_key_t *key ) {
+  ENTER;
+  if( !pip_is_effective() ) RETURN( EPERM );
+  if( key == NULL ) RETURN( EINVAL );
+  RETURN( pip_do_named_export( exp, 0, NULL,
+			       key->hash, key->name, key->len ) );
+}
+
+int pip_named_export_replace( void *exp,
+			      uint64_t *versionp,
+			      const char *format, ... ) {
+  char		buf[PIP_NAMED_KEY_MAX];
+  char		*name, *heap;
+  size_t	len;
+  va_list 	ap;
+  int 		err;
+
+  ENTER;
+  if( !pip_is_effective() ) RETURN( EPERM );
   va_start( ap, format );
-  hash = pip_name_hash( &name, format, ap );
-  ASSERTD( name != NULL );
-  DBGF( "pipid:%d  name:'%s'  exp:%p", pip_task->pipid, name, exp );
+  name = pip_name_format( buf, &heap, &len, format, ap );
+  va_end( ap );
+  if( name == NULL ) RETURN( ENOMEM );
+  err = pip_do_named_export( exp, 1, versionp,
+			     pip_name_hash( name, len ), name, len );
+  free( heap );
+  RETURN( err );
+}
 
-  namexp = (pip_named_exptab_t*) pip_task->named_exptab;
-  ASSERTD( namexp != NULL );
+int pip_named_export_replace_key( void *exp,
+				  uint64_t *versionp,
+				  const pip_named_key_t *key ) {
+  ENTER;
+  if( !pip_is_effective() ) RETURN( EPERM );
+  if( key == NULL ) RETURN( EINVAL );
+  RETURN( pip_do_named_export( exp, 1, versionp,
+			       key->hash, key->name, key->len ) );
+}
 
-  head = pip_lock_hashtab_head( namexp, hash );
-  {
-    if( ( entry = pip_find_namexp( head, hash, name ) ) == NULL ) {
-      /* no entry yet */
-      entry = pip_new_entry( namexp, name, hash );
-      if( entry == NULL ) {
-	err = ENOMEM;
+/* must be called with the lock held */
+static void pip_namexp_withdraw( pip_namexp_entry_t *entry ) {
+  entry->state = PIP_NAMEXP_WITHDRAWN;
+  pip_memory_barrier();
+  entry->version ++;
+}
+
+static int pip_do_named_unexport( pip_hash_t hash,
+				  const char *name,
+				  size_t len ) {
+  pip_named_exptab_t *namexp;
+  pip_namexp_entry_t *entry;
+  int 		err = 0;
+
+  ENTER;
+  DBGF( "pipid:%d  name:'%s'", pip_task->pipid, name );
+  namexp = pip_namexp_get( pip_task );
+
+  pip_namexp_lock( namexp );
+  if( ( entry = pip_find_namexp( namexp, hash, name, len ) ) == NULL ||
+      entry->state != PIP_NAMEXP_EXPORTED ) {
+    err = ENOENT;
+  } else {
+    /* kept in the table to be exported again in place */
+    pip_namexp_write_begin( namexp );
+    pip_namexp_withdraw( entry );
+    pip_namexp_write_end( namexp );
+  }
+  pip_namexp_unlock( namexp );
+  RETURN( err );
+}
+
+int pip_named_unexport( const char *format, ... ) {
+  char		buf[PIP_NAMED_KEY_MAX];
+  char		*name, *heap;
+  size_t	len;
+  va_list 	ap;
+  int 		err;
+
+  ENTER;
+  if( !pip_is_effective() ) RETURN( EPERM );
+  va_start( ap, format );
+  name = pip_name_format( buf, &heap, &len, format, ap );
+  va_end( ap );
+  if( name == NULL ) RETURN( ENOMEM );
+  err = pip_do_named_unexport( pip_name_hash( name, len ), name, len );
+  free( heap );
+  RETURN( err );
+}
+
+int pip_named_unexport_key( const pip_named_key_t *key ) {
+  ENTER;
+  if( !pip_is_effective() ) RETURN( EPERM );
+  if( key == NULL ) RETURN( EINVAL );
+  RETURN( pip_do_named_unexport( key->hash, key->name, key->len ) );
+}
+
+int pip_named_export_keys( int n, void **exps, const pip_named_key_t *keys ) {
+  pip_named_exptab_t *namexp;
+  pip_namexp_entry_t **news, **olds;
+  int 		i, j, err = 0;
+
+  ENTER;
+  if( !pip_is_effective() ) RETURN( EPERM );
+  if( n < 0 ) RETURN( EINVAL );
+  if( n == 0 ) RETURN( 0 );
+  if( exps == NULL || keys == NULL ) RETURN( EINVAL );
+
+  namexp = pip_namexp_get( pip_task );
+
+  news = (pip_namexp_entry_t**) malloc( sizeof( pip_namexp_entry_t* ) * n * 2 );
+  if( news == NULL ) RETURN( ENOMEM );
+  olds = news + n;
+  /* all entries are allocated before taking the lock */
+  for( i=0; i<n; i++ ) {
+    news[i] = pip_new_entry( keys[i].hash, keys[i].name, keys[i].len );
+    if( news[i] == NULL ) {
+      for( j=0; j<i; j++ ) {
+	free( news[j]->name );
+	free( news[j] );
+      }
+      free( news );
+      RETURN( ENOMEM );
+    }
+    news[i]->address = exps[i];
+    news[i]->state   = PIP_NAMEXP_EXPORTED;
+    news[i]->version = 1;
+  }
+
+  pip_namexp_lock( namexp );
+  pip_namexp_write_begin( namexp );
+  for( i=0; i<n; i++ ) {
+    olds[i] = pip_find_namexp( namexp,
+			       keys[i].hash, keys[i].name, keys[i].len );
+    if( olds[i] == NULL ) {
+      pip_add_namexp_entry( namexp, news[i] );
+    } else if( olds[i]->state == PIP_NAMEXP_EXPORTED ||
+	       olds[i]->flag_exporting ) {
+      /* already exported, or the same name appears twice */
+      err = EBUSY;
+      break;
+    } else {
+      /* queried or unexported, to be exported in place */
+      olds[i]->flag_exporting = 1;
+    }
+  }
+  if( err ) {
+    /* undo, none of them is exported */
+    for( j=i-1; j>=0; j-- ) {
+      if( olds[j] != NULL ) {
+	olds[j]->flag_exporting = 0;
       } else {
-	name = NULL;		/* not to free since name is in use */
-	entry->address       = exp;
-	entry->flag_exported = 1;
-	pip_add_namexp_entry( head, entry );
+	pip_del_namexp_entry( namexp, news[j] );
+	news[j] = NULL;
       }
-    } else {			/* found */
-      if( entry->flag_exported ) {
-	/* already exported */
-	err = EBUSY;
+    }
+  } else {
+    /* resume waiting imports at once */
+    for( i=0; i<n; i++ ) {
+      if( olds[i] == NULL ) {
+	news[i] = NULL;
       } else {
-	/* the found entry is a query entry, so create new one */
-	new = pip_new_entry( namexp, name, hash );
-	if( new == NULL ) {
-	  err = ENOMEM;
-	} else {
-	  name = NULL;		/* not to free since name is in use */
-	  entry->address     = exp;
-	  new->address       = exp;
-	  new->flag_exported = 1;
-	  /* replace the query entry with the exported entry */
-	  PIP_LIST_DEL( (pip_list_t*) entry );
-	  pip_add_namexp_entry( head, new );
-	  /* note: we cannot free this entry since it might be created by */
-	  /* another PiP task and this PiP task must free it in this case */
-
-	  /* resume waiting imports if any*/
-	  PIP_LIST_FOREACH_SAFE( &entry->list_wait, list, next ) {
-	    PIP_LIST_DEL( list );
-	    waitp = (pip_namexp_wait_t*) list;
-	    waitp->err     = err;
-	    waitp->address = exp;
-	    pip_sem_post( &waitp->semaphore );
-	  }
-	  pip_sem_post( &entry->semaphore );
-	}
+	olds[i]->flag_exporting = 0;
+	pip_namexp_revive( olds[i], exps[i] );
       }
     }
   }
-  pip_unlock_hashtab_head( head );
-  free( name );
-
-  va_end( ap );
+  pip_namexp_write_end( namexp );
+  pip_namexp_unlock( namexp );
+  /* the new entries never linked to the table */
+  for( i=0; i<n; i++ ) {
+    if( news[i] != NULL ) {
+      free( news[i]->name );
+      free( news[i] );
+    }
+  }
+  free( news );
   RETURN( err );
 }
 
 static int pip_do_named_import( int pipid,
 				void **expp,
 				int flag_nblk,
-				const char *format,
-				va_list ap ) {
+				const struct timespec *timeout,
+				pip_hash_t hash,
+				const char *name,
+				size_t len ) {
   pip_task_t		*task;
   pip_named_exptab_t 	*namexp;
   pip_namexp_entry_t 	*entry;
-  pip_namexp_list_t  	*head;
-  pip_hash_t 		hash;
   volatile void		*address = NULL;
-  char 			*name = NULL;
   int 			err = 0;
 
   ENTER;
@@ -265,73 +668,58 @@ static int pip_do_named_import( int pipid,
   /* thre can be the case where target task is already terminated */
   if( task == NULL ) RETURN( ESRCH );
 
-  namexp = (pip_named_exptab_t*) task->named_exptab;
-
-  hash = pip_name_hash( &name, format, ap );
-  if( name == NULL ) RETURN( ENOMEM );
+  namexp = pip_namexp_get( task );
 
   DBGF( "pipid:%d  name:'%s'  hash:0x%lx", pipid, name, hash );
-  head = pip_lock_hashtab_head( namexp, hash );
-  {
-    if( ( entry = pip_find_namexp( head, hash, name ) ) != NULL ) {
-      if( entry->flag_exported ) { /* exported already */
-	address = entry->address;
-      } else {		   /* already queried, but not yet exported */
-	if( flag_nblk ) {
-	  err = EAGAIN;
-	} else {
-	  pip_namexp_wait_t	wait;
-
-	  memset( &wait, 0, sizeof(wait) );
-	  PIP_LIST_INIT( &wait.list );
-	  PIP_LIST_ADD( &entry->list_wait, &wait.list );
-
-	  pip_sem_init( &wait.semaphore );
-	  pip_unlock_hashtab_head( head );
-	  pip_sem_wait( &wait.semaphore );
-	  pip_sem_fin(  &wait.semaphore );
-	  /* exported and resumed */
-	  err     = wait.err;
-	  address = wait.address;
-	  DBGF( "address:%p  err:%d", address, err );
-	  goto nounlock;
-	}
-      }
-    } else {			/* not found */
-      if( namexp->flag_closed ) {
-	err = ECANCELED;
-      } else if( pipid == pip_task->pipid ) {
-	err = EDEADLK;
-      } else if( flag_nblk ) {	/* no entry yet */
-	err = EAGAIN;
+  /* fast path, already exported */
+  if( ( entry = pip_read_namexp( namexp, hash, name, len ) ) != NULL ) {
+    address = entry->address;
+    goto done;
+  }
+
+  pip_namexp_lock( namexp );
+  if( ( entry = pip_find_namexp( namexp, hash, name, len ) ) != NULL ) {
+    if( entry->state == PIP_NAMEXP_EXPORTED ) { /* exported in the meantime */
+      address = entry->address;
+      entry   = NULL;
+    } else if( entry->state == PIP_NAMEXP_WITHDRAWN && namexp->flag_closed ) {
+      err   = ECANCELED;
+      entry = NULL;
+    } else if( flag_nblk ) {   /* queried or unexported, not exported */
+      err   = EAGAIN;
+      entry = NULL;
+    } else if( entry->state == PIP_NAMEXP_WITHDRAWN ) {
+      if( pipid == pip_task->pipid ) {
+	err   = EDEADLK;
+	entry = NULL;
       } else {
-	/* create a query entry */
-	entry = pip_new_entry( namexp, name, hash );
-	if( entry == NULL ) {
-	  err = ENOMEM;
-	} else {
-	  name = NULL;		/* not to free since name is in use */
-	  pip_add_namexp_entry( head, entry );
-	  /* add query entry and suspend until it is exported */
-	  pip_unlock_hashtab_head( head );
-	  pip_sem_wait( &entry->semaphore );
-	  /* now, it is exported */
-	  if( entry->flag_canceled ) {
-	    err = ECANCELED;
-	  } else {
-	    address = entry->address;
-	  }
-	  DBGF( "address:%p", address );
-	  free( entry->name );
-	  free( entry );
-	  goto nounlock;
-	}
+	pip_namexp_requery( namexp, entry );
       }
     }
+  } else {			/* not found */
+    if( namexp->flag_closed ) {
+      err = ECANCELED;
+    } else if( pipid == pip_task->pipid ) {
+      err = EDEADLK;
+    } else if( flag_nblk ) {	/* no entry yet */
+      err = EAGAIN;
+    } else if( ( entry = pip_new_entry( hash, name, len ) ) == NULL ) {
+      err = ENOMEM;
+    } else {
+      /* add query entry */
+      pip_namexp_write_begin( namexp );
+      pip_add_namexp_entry( namexp, entry );
+      pip_namexp_write_end( namexp );
+    }
   }
-  pip_unlock_hashtab_head( head );
- nounlock:
-  free( name );
+  pip_namexp_unlock( namexp );
+  if( entry != NULL ) {
+    /* suspend until it is exported or canceled. the query entry */
+    /* is retired then and will be freed at the end              */
+    err = pip_namexp_wait( entry, timeout, &address );
+    DBGF( "address:%p  err:%d", address, err );
+  }
+ done:
   if( !err ) {
     DBGF( "exp:%p", address );
     if( expp != NULL ) *expp = (void*) address;
@@ -339,11 +727,30 @@ static int pip_do_named_import( int pipid,
   RETURN( err );
 }
 
+static int pip_named_import_fmt( int pipid,
+				 void **expp,
+				 int flag_nblk,
+				 const struct timespec *timeout,
+				 const char *format,
+				 va_list ap ) {
+  char		buf[PIP_NAMED_KEY_MAX];
+  char		*name, *heap;
+  size_t	len;
+  int		err;
+
+  name = pip_name_format( buf, &heap, &len, format, ap );
+  if( name == NULL ) RETURN( ENOMEM );
+  err = pip_do_named_import( pipid, expp, flag_nblk, timeout,
+			     pip_name_hash( name, len ), name, len );
+  free( heap );
+  RETURN( err );
+}
+
 int pip_named_import( int pipid, void **expp, const char *format, ... ) {
   va_list ap;
   int err;
   va_start( ap, format );
-  err = pip_do_named_import( pipid, expp, 0, format, ap );
+  err = pip_named_import_fmt( pipid, expp, 0, NULL, format, ap );
   va_end( ap );
   RETURN( err );
 }
@@ -352,55 +759,304 @@ int pip_named_tryimport( int pipid, void **expp, const char *format, ... ) {
   va_list ap;
   int err;
   va_start( ap, format );
-  err = pip_do_named_import( pipid, expp, 1, format, ap );
+  err = pip_named_import_fmt( pipid, expp, 1, NULL, format, ap );
+  va_end( ap );
+  RETURN( err );
+}
+
+int pip_named_timedimport( int pipid,
+			   void **expp,
+			   const struct timespec *timeout,
+			   const char *format, ... ) {
+  va_list ap;
+  int err;
+  if( timeout == NULL ) RETURN( EINVAL );
+  va_start( ap, format );
+  err = pip_named_import_fmt( pipid, expp, 0, timeout, format, ap );
   va_end( ap );
   RETURN( err );
 }
 
+int pip_named_import_key( int pipid, void **expp, const pip_named_key_t *key ) {
+  ENTER;
+  if( key == NULL ) RETURN( EINVAL );
+  RETURN( pip_do_named_import( pipid, expp, 0, NULL,
+			       key->hash, key->name, key->len ) );
+}
+
+int pip_named_tryimport_key( int pipid,
+			     void **expp,
+			     const pip_named_key_t *key ) {
+  ENTER;
+  if( key == NULL ) RETURN( EINVAL );
+  RETURN( pip_do_named_import( pipid, expp, 1, NULL,
+			       key->hash, key->name, key->len ) );
+}
+
+int pip_named_timedimport_key( int pipid,
+			       void **expp,
+			       const struct timespec *timeout,
+			       const pip_named_key_t *key ) {
+  ENTER;
+  if( key == NULL || timeout == NULL ) RETURN( EINVAL );
+  RETURN( pip_do_named_import( pipid, expp, 0, timeout,
+			       key->hash, key->name, key->len ) );
+}
+
+int pip_named_import_all( const pip_named_key_t *key,
+			  int n,
+			  const int *pipids,
+			  void **exps ) {
+  pip_task_t		*task;
+  pip_named_exptab_t 	*namexp, **tabs = NULL;
+  pip_namexp_entry_t 	*entry, **entries = NULL;
+  volatile void		*address;
+  int			pipid, i, e, err = 0;
+
+  ENTER;
+  if( !pip_is_effective() ) RETURN( EPERM );
+  if( key == NULL || exps == NULL || n < 0 ) RETURN( EINVAL );
+  if( pipids == NULL && n > pip_root->ntasks ) RETURN( EINVAL );
+
+  /* first, take the ones already exported without locking */
+  for( i=0; i<n; i++ ) {
+    pipid = ( pipids != NULL ) ? pipids[i] : i;
+    if( ( err = pip_check_pipid( &pipid ) ) != 0 ) goto error;
+    if( ( task = pip_get_task_( pipid ) ) == NULL ) {
+      err = ESRCH;
+      goto error;
+    }
+    namexp = pip_namexp_get( task );
+    entry  = pip_read_namexp( namexp, key->hash, key->name, key->len );
+    if( entry != NULL ) {
+      exps[i] = (void*) entry->address;
+      continue;
+    }
+    if( pipid == pip_task->pipid ) {
+      err = EDEADLK;
+      goto error;
+    }
+    if( tabs == NULL ) {
+      tabs = (pip_named_exptab_t**) malloc( sizeof( void* ) * n * 2 );
+      if( tabs == NULL ) {
+	err = ENOMEM;
+	goto error;
+      }
+      memset( tabs, 0, sizeof( void* ) * n * 2 );
+      entries = (pip_namexp_entry_t**) ( tabs + n );
+    }
+    tabs[i] = namexp;		/* not yet exported */
+  }
+  if( tabs == NULL ) goto error; /* all exported */
+
+  /* then, put query entries for all the rest before sleeping */
+  for( i=0; i<n; i++ ) {
+    if( ( namexp = tabs[i] ) == NULL ) continue;
+
+    pip_namexp_lock( namexp );
+    entry = pip_find_namexp( namexp, key->hash, key->name, key->len );
+    if( entry == NULL ) {
+      if( namexp->flag_closed ) {
+	if( !err ) err = ECANCELED;
+      } else if( ( entry = pip_new_entry( key->hash,
+					  key->name,
+					  key->len ) ) == NULL ) {
+	if( !err ) err = ENOMEM;
+      } else {
+	pip_namexp_write_begin( namexp );
+	pip_add_namexp_entry( namexp, entry );
+	pip_namexp_write_end( namexp );
+      }
+    }
+    if( entry != NULL && entry->state == PIP_NAMEXP_WITHDRAWN ) {
+      if( namexp->flag_closed ) {
+	if( !err ) err = ECANCELED;
+	entry = NULL;
+      } else {
+	pip_namexp_requery( namexp, entry );
+      }
+    }
+    if( entry != NULL ) {
+      if( entry->state == PIP_NAMEXP_EXPORTED ) {
+	exps[i] = (void*) entry->address;
+      } else {
+	entries[i] = entry;
+      }
+    }
+    pip_namexp_unlock( namexp );
+  }
+  for( i=0; i<n; i++ ) {
+    if( entries[i] == NULL ) continue;
+    if( ( e = pip_namexp_wait( entries[i], NULL, &address ) ) != 0 ) {
+      if( !err ) err = e;
+    } else {
+      exps[i] = (void*) address;
+    }
+  }
+ error:
+  free( tabs );
+  RETURN( err );
+}
+
+/* read the address and the state of the version */
+static uint64_t pip_namexp_snapshot( pip_namexp_entry_t *entry,
+				     volatile void **addressp,
+				     uint32_t *statep ) {
+  uint64_t	version;
+
+  do {
+    version = entry->version;
+    pip_memory_barrier();
+    *addressp = entry->address;
+    *statep   = entry->state;
+    pip_memory_barrier();
+  } while( version != entry->version );
+  return version;
+}
+
+int pip_named_subscribe( int pipid,
+			 pip_named_sub_t *sub,
+			 const pip_named_key_t *key ) {
+  pip_task_t		*task;
+  pip_named_exptab_t 	*namexp;
+  pip_namexp_entry_t 	*entry;
+  volatile void		*address;
+  uint32_t		state;
+  int 			err;
+
+  ENTER;
+  if( sub == NULL || key == NULL ) RETURN( EINVAL );
+  if( ( err = pip_check_pipid( &pipid ) ) != 0 ) RETURN( err );
+  if( ( task = pip_get_task_( pipid ) ) == NULL ) RETURN( ESRCH );
+  namexp = pip_namexp_get( task );
+
+  while( 1 ) {
+    /* wait for the export */
+    err = pip_do_named_import( pipid, NULL, 0, NULL,
+			       key->hash, key->name, key->len );
+    if( err ) RETURN( err );
+    entry = pip_read_namexp( namexp, key->hash, key->name, key->len );
+    /* retry if it is unexported in the meantime */
+    if( entry == NULL ) continue;
+    sub->version = pip_namexp_snapshot( entry, &address, &state );
+    if( state == PIP_NAMEXP_EXPORTED ) break;
+  }
+  sub->entry   = entry;
+  sub->address = (void*) address;
+  RETURN( 0 );
+}
+
+int pip_named_poll( pip_named_sub_t *sub, void **expp, int *changedp ) {
+  pip_namexp_entry_t 	*entry;
+  volatile void		*address;
+  uint32_t		state;
+  uint64_t		version;
+  int			changed = 0;
+
+  if( sub == NULL || sub->entry == NULL ) RETURN( EINVAL );
+  entry = (pip_namexp_entry_t*) sub->entry;
+  if( entry->version != sub->version ) {
+    version = pip_namexp_snapshot( entry, &address, &state );
+    if( state != PIP_NAMEXP_EXPORTED ) RETURN( ENOENT );
+    sub->version = version;
+    sub->address = (void*) address;
+    changed = 1;
+  }
+  if( expp     != NULL ) *expp     = sub->address;
+  if( changedp != NULL ) *changedp = changed;
+  RETURN( 0 );
+}
+
 void pip_named_export_fin( pip_task_t *task ) {
   pip_named_exptab_t	*namexp;
-  pip_list_t		*list, *next;
-  int 			i;
+  pip_namexp_htab_t	*htab;
+  pip_namexp_entry_t	*entry, *volatile *prevp;
+  size_t		i;
 
   ENTERF( "PIPID:%d", task->pipid );
   namexp = (pip_named_exptab_t*) task->named_exptab;
   if( namexp != NULL ) {
+    pip_namexp_lock( namexp );
     namexp->flag_closed = 1;
-    for( i=0; i<namexp->sz; i++ ) {
-      pip_namexp_list_t	*htab = namexp->hash_table;
-      pip_namexp_list_t	*head = &(htab[i]);
-      pip_spin_lock( &head->lock );
-      PIP_LIST_FOREACH_SAFE( (pip_list_t*) &head->list, list, next ) {
-	pip_namexp_entry_t *entry = (pip_namexp_entry_t*) list;
-	PIP_LIST_DEL( (pip_list_t*) entry );
-	if( !entry->flag_exported ) {
-	  entry->flag_canceled = 1;
-	  pip_sem_post( &entry->semaphore );
+    pip_namexp_write_begin( namexp );
+    htab = namexp->htab;
+    for( i=0; i<htab->sz; i++ ) {
+      prevp = &htab->buckets[i];
+      while( ( entry = *prevp ) != NULL ) {
+	if( entry->state == PIP_NAMEXP_QUERY ) {
+	  pip_del_namexp_entry( namexp, entry );
+	  pip_namexp_wakeup( entry, NULL, PIP_NAMEXP_CANCELED );
+	  continue;
 	}
+	/* kept for the subscribers, let them know */
+	if( entry->state == PIP_NAMEXP_EXPORTED ) pip_namexp_withdraw( entry );
+	prevp = &entry->next;
       }
-      pip_spin_unlock( &head->lock );
     }
+    pip_namexp_write_end( namexp );
+    pip_namexp_unlock( namexp );
   }
   RETURNV;
 }
 
+/* the table of a terminated task is left to the importers and the */
+/* subscribers of the task, and the next task of the slot exports  */
+/* to a new one. the old entries are never exported again          */
+void pip_named_export_reset( pip_task_t *task ) {
+  pip_named_exptab_t	*old = task->named_exptab, *new;
+
+  if( old == NULL ) return;
+  new = pip_namexp_new();
+  new->retired = old;
+  pip_memory_barrier();
+  task->named_exptab = new;
+}
+
+static void pip_namexp_free( pip_named_exptab_t *namexp ) {
+  pip_namexp_htab_t	*htab, *next_htab;
+  pip_namexp_entry_t	*entry, *next_entry;
+  size_t		i;
+
+  for( entry=namexp->retired_entries; entry!=NULL; entry=next_entry ) {
+    next_entry = entry->retired;
+    free( entry->name );
+    free( entry );
+  }
+  for( htab=namexp->retired_htabs; htab!=NULL; htab=next_htab ) {
+    next_htab = htab->retired;
+    free( htab );
+  }
+  /* the unexported entries left in the table */
+  htab = namexp->htab;
+  for( i=0; i<htab->sz; i++ ) {
+    for( entry=htab->buckets[i]; entry!=NULL; entry=next_entry ) {
+      next_entry = entry->next;
+      free( entry->name );
+      free( entry );
+    }
+  }
+  free( htab );
+  free( namexp );
+}
+
+static void pip_named_exptab_free( pip_task_t *task ) {
+  pip_named_exptab_t	*namexp, *next;
+
+  if( task->named_exptab == NULL ) return;
+  pip_named_export_fin( task );
+  for( namexp=task->named_exptab; namexp!=NULL; namexp=next ) {
+    next = namexp->retired;
+    pip_namexp_free( namexp );
+  }
+  task->named_exptab = NULL;
+}
 void pip_named_export_fin_all( pip_root_t *root ) {
-  pip_task_t 		*task;
-  pip_named_exptab_t  	*namexp;
   int i;
 
   ENTERF( "root->ntasks:%d", root->ntasks );
-  for( i=0; i<pip_root->ntasks; i++ ) {
-    task   = &root->tasks[i];
-    namexp = task->named_exptab;
-    free( namexp->hash_table );
-    free( namexp );
-    task->named_exptab = NULL;
+  for( i=0; i<root->ntasks; i++ ) {
+    pip_named_exptab_free( &root->tasks[i] );
   }
-  (void) pip_named_export_fin( root->task_root );
-  namexp = root->task_root->named_exptab;
-  free( namexp->hash_table );
-  free( namexp );
-  root->task_root->named_exptab = NULL;
+  pip_named_exptab_free( root->task_root );
   RETURNV;
 }
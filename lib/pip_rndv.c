@@ -0,0 +1,306 @@
+
+/*
+ * $PIP_license: <Simplified BSD License>
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *     Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ * 
+ *     Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ * $
+ * $RIKEN_copyright: Riken Center for Computational Sceience (R-CCS),
+ * System Software Development Team, 2016-2022
+ * $
+ * $PIP_VERSION: Version 2.4.1$
+ *
+ * $Author: Atsushi Hori 
+ * Query:   procinproc-info@googlegroups.com
+ * User ML: procinproc-users@googlegroups.com
+ * $
+ */
+
+#include <pip/pip_internal.h>
+
+/* Rendezvous transfer: since all PiP tasks share the same address  */
+/* space, a message is copied from the sender's buffer to the       */
+/* receiver's buffer directly, without any intermediate buffer. A   */
+/* large message is split into chunks, and the receiver waiting for */
+/* the message helps the sender copying the remaining chunks.       */
+/* A sender finds a posting by its name, and the posting can be     */
+/* released before the sender touches it. Released objects are kept */
+/* by the root and never unmapped until pip_fin(), and a sender     */
+/* takes a reference only while the object is still referred.       */
+
+#define PIP_RNDV_MAGIC		(0x5B900500U)
+#define PIP_RNDV_NAME_FMT	"pip_rndv:%s"
+
+#define PIP_RNDV_POSTED		(0)
+#define PIP_RNDV_CLAIMED	(1)	/* a sender is setting up */
+#define PIP_RNDV_SENDING	(2)
+#define PIP_RNDV_DONE		(3)
+#define PIP_RNDV_CANCELED	(4)
+
+/* messages larger than this are copied in chunks of this size */
+#define PIP_RNDV_CHUNK_SZ	(1024*1024)
+/* non-temporal stores are used for copies at least this size */
+#define PIP_MEMCPY_NT_MIN	(256*1024)
+
+struct pip_rndv {
+  uint32_t		magic;
+  int			pipid;	/* receiver */
+  void			*buf;
+  size_t		size;
+  const void		*src;
+  size_t		len;
+  size_t		nchunks;
+  struct pip_rndv	*next_free;
+  char			name[PIP_NAMED_KEY_MAX];
+  char			__pad__[PIP_CACHEBLK_SZ -
+				( 56 + PIP_NAMED_KEY_MAX ) % PIP_CACHEBLK_SZ];
+  volatile uint32_t	state;	  /* futex word */
+  volatile uint32_t	nsleepers;
+  volatile uint32_t	nrefs;	  /* freed by the last one leaving */
+  volatile size_t	next;	  /* next chunk to copy */
+  volatile size_t	ndone;	  /* number of copied chunks */
+};
+
+void *pip_memcpy_nt( void *dst, const void *src, size_t sz ) {
+  void		*d = dst;
+  const void	*s = src;
+  size_t	head;
+
+  if( sz < PIP_MEMCPY_NT_MIN ) return memcpy( dst, src, sz );
+
+  head = ( -(uintptr_t) d ) & ( PIP_CACHEBLK_SZ - 1 );
+  memcpy( d, s, head );
+  d  += head;
+  s  += head;
+  sz -= head;
+  for( ; sz >= PIP_CACHEBLK_SZ; sz -= PIP_CACHEBLK_SZ ) {
+    pip_stream_copy_block( d, s );
+    d += PIP_CACHEBLK_SZ;
+    s += PIP_CACHEBLK_SZ;
+  }
+  /* non-temporal stores are weakly ordered */
+  pip_write_barrier();
+  memcpy( d, s, sz );
+  return dst;
+}
+
+INLINE int pip_rndv_check( pip_rndv_t *rndv ) {
+  return rndv != NULL && rndv->magic == PIP_RNDV_MAGIC;
+}
+
+static void pip_rndv_set_state( pip_rndv_t *rndv, uint32_t state ) {
+  rndv->state = state;
+  pip_memory_barrier();
+  if( rndv->nsleepers > 0 ) pip_futex_wake_all( &rndv->state );
+}
+
+/* wait until the state becomes at least the specified one */
+static void pip_rndv_wait_state( pip_rndv_t *rndv, uint32_t state ) {
+  uint32_t	cur;
+  int		i;
+
+  for( i=0; i<PIP_SYNC_SPIN; i++ ) {
+    if( rndv->state >= state ) return;
+    pip_pause();
+  }
+  (void) __sync_fetch_and_add( &rndv->nsleepers, 1 );
+  while( ( cur = rndv->state ) < state ) {
+    (void) pip_futex_wait( &rndv->state, cur, NULL );
+  }
+  (void) __sync_fetch_and_sub( &rndv->nsleepers, 1 );
+}
+
+static pip_rndv_t *pip_rndv_alloc( void ) {
+  pip_rndv_t	*rndv;
+
+  pip_spin_lock( &pip_root->lock_rndv );
+  if( ( rndv = pip_root->rndv_pool ) != NULL ) {
+    pip_root->rndv_pool = rndv->next_free;
+  }
+  pip_spin_unlock( &pip_root->lock_rndv );
+  if( rndv == NULL &&
+      pip_page_alloc( sizeof( pip_rndv_t ), (void**) &rndv ) != 0 ) {
+    return NULL;
+  }
+  return rndv;
+}
+
+/* take a reference unless the object is already released */
+static int pip_rndv_ref( pip_rndv_t *rndv ) {
+  uint32_t	n;
+
+  do {
+    if( ( n = rndv->nrefs ) == 0 ) return 0;
+  } while( !__sync_bool_compare_and_swap( &rndv->nrefs, n, n + 1 ) );
+  return 1;
+}
+
+static void pip_rndv_release( pip_rndv_t *rndv ) {
+  if( __sync_sub_and_fetch( &rndv->nrefs, 1 ) == 0 ) {
+    rndv->magic = 0;
+    pip_spin_lock( &pip_root->lock_rndv );
+    rndv->next_free = pip_root->rndv_pool;
+    pip_root->rndv_pool = rndv;
+    pip_spin_unlock( &pip_root->lock_rndv );
+  }
+}
+
+void pip_rndv_pool_fin( pip_root_t *root ) {
+  pip_rndv_t	*rndv, *next;
+
+  for( rndv = root->rndv_pool; rndv != NULL; rndv = next ) {
+    next = rndv->next_free;
+    pip_page_free( rndv );
+  }
+  root->rndv_pool = NULL;
+}
+
+/* copy the chunks not yet taken by the other */
+static void pip_rndv_copy( pip_rndv_t *rndv ) {
+  size_t	chunk, off, sz;
+
+  while( ( chunk = __sync_fetch_and_add( &rndv->next, 1 ) ) <
+	 rndv->nchunks ) {
+    off = chunk * PIP_RNDV_CHUNK_SZ;
+    sz  = rndv->len - off;
+    if( sz > PIP_RNDV_CHUNK_SZ ) sz = PIP_RNDV_CHUNK_SZ;
+    pip_memcpy_nt( rndv->buf + off, rndv->src + off, sz );
+    if( __sync_add_and_fetch( &rndv->ndone, 1 ) == rndv->nchunks ) {
+      pip_rndv_set_state( rndv, PIP_RNDV_DONE );
+    }
+  }
+}
+
+int pip_rndv_post( pip_rndv_t **rndvp,
+		   void *buf,
+		   size_t size,
+		   const char *name ) {
+  pip_rndv_t	*rndv;
+  int		err;
+
+  if( !pip_is_effective() ) RETURN( EPERM );
+  if( rndvp == NULL || name == NULL ) RETURN( EINVAL );
+  if( buf == NULL && size > 0 ) RETURN( EINVAL );
+  if( strlen( name ) + sizeof( PIP_RNDV_NAME_FMT ) > PIP_NAMED_KEY_MAX ) {
+    RETURN( ENAMETOOLONG );
+  }
+  if( ( rndv = pip_rndv_alloc() ) == NULL ) RETURN( ENOMEM );
+  /* a stale sender may be looking at this, nrefs is kept zero */
+  rndv->pipid     = pip_task->pipid;
+  rndv->buf       = buf;
+  rndv->size      = size;
+  rndv->src       = NULL;
+  rndv->len       = 0;
+  rndv->nchunks   = 0;
+  rndv->next_free = NULL;
+  rndv->nsleepers = 0;
+  rndv->next      = 0;
+  rndv->ndone     = 0;
+  rndv->state     = PIP_RNDV_POSTED;
+  strcpy( rndv->name, name );
+  rndv->magic     = PIP_RNDV_MAGIC;
+  pip_memory_barrier();
+  rndv->nrefs     = 1;	/* the receiver */
+
+  if( ( err = pip_named_export( rndv, PIP_RNDV_NAME_FMT, name ) ) != 0 ) {
+    pip_rndv_release( rndv );
+    RETURN( err );
+  }
+  *rndvp = rndv;
+  RETURN( 0 );
+}
+
+int pip_rndv_send( int pipid,
+		   const char *name,
+		   const void *buf,
+		   size_t size ) {
+  pip_rndv_t	*rndv;
+  int		err;
+
+  if( name == NULL || ( buf == NULL && size > 0 ) ) RETURN( EINVAL );
+  err = pip_named_import( pipid, (void**) &rndv, PIP_RNDV_NAME_FMT, name );
+  if( err ) RETURN( err );
+  (void) pip_check_pipid( &pipid );
+
+  /* the posting may have been taken by another sender and released, */
+  /* and then the object may have been reused for another posting    */
+  if( !pip_rndv_ref( rndv ) ) RETURN( EBUSY );
+  if( !pip_rndv_check( rndv )   ||
+      rndv->pipid != pipid      ||
+      strcmp( rndv->name, name ) != 0 ) {
+    err = EBUSY;
+    goto done;
+  }
+  if( size > rndv->size ) {
+    err = EMSGSIZE;
+    goto done;
+  }
+  if( !__sync_bool_compare_and_swap( &rndv->state,
+				     PIP_RNDV_POSTED,
+				     PIP_RNDV_CLAIMED ) ) {
+    err = EBUSY;
+    goto done;
+  }
+
+  rndv->src     = buf;
+  rndv->len     = size;
+  rndv->nchunks = ( size + PIP_RNDV_CHUNK_SZ - 1 ) / PIP_RNDV_CHUNK_SZ;
+  if( rndv->nchunks == 0 ) {
+    pip_rndv_set_state( rndv, PIP_RNDV_DONE );
+  } else {
+    /* wake up the receiver to help copying */
+    pip_rndv_set_state( rndv, PIP_RNDV_SENDING );
+    pip_rndv_copy( rndv );
+    /* the receiver may still be copying from our buffer */
+    pip_rndv_wait_state( rndv, PIP_RNDV_DONE );
+  }
+ done:
+  pip_rndv_release( rndv );
+  RETURN( err );
+}
+
+int pip_rndv_wait( pip_rndv_t *rndv, size_t *sizep ) {
+  if( !pip_rndv_check( rndv ) ) RETURN( EINVAL );
+  if( rndv->pipid != pip_task->pipid ) RETURN( EPERM );
+
+  /* sleep until a sender comes */
+  pip_rndv_wait_state( rndv, PIP_RNDV_SENDING );
+  (void) pip_named_unexport( PIP_RNDV_NAME_FMT, rndv->name );
+  pip_rndv_copy( rndv );
+  pip_rndv_wait_state( rndv, PIP_RNDV_DONE );
+
+  if( sizep != NULL ) *sizep = rndv->len;
+  pip_rndv_release( rndv );
+  RETURN( 0 );
+}
+
+int pip_rndv_cancel( pip_rndv_t *rndv ) {
+  if( !pip_rndv_check( rndv ) ) RETURN( EINVAL );
+  if( rndv->pipid != pip_task->pipid ) RETURN( EPERM );
+
+  /* a sender has already taken the posting */
+  if( !__sync_bool_compare_and_swap( &rndv->state,
+				     PIP_RNDV_POSTED,
+				     PIP_RNDV_CANCELED ) ) RETURN( EBUSY );
+  (void) pip_named_unexport( PIP_RNDV_NAME_FMT, rndv->name );
+  pip_rndv_release( rndv );
+  RETURN( 0 );
+}
@@ -0,0 +1,153 @@
+
+/*
+ * $PIP_license: <Simplified BSD License>
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *     Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ * 
+ *     Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ * $
+ * $RIKEN_copyright: Riken Center for Computational Sceience (R-CCS),
+ * System Software Development Team, 2016-2022
+ * $
+ * $PIP_VERSION: Version 2.4.1$
+ *
+ * $Author: Atsushi Hori 
+ * Query:   procinproc-info@googlegroups.com
+ * User ML: procinproc-users@googlegroups.com
+ * $
+ */
+
+#include <pip/pip_internal.h>
+
+#define PIP_SHMPOOL_MAGIC	(0x5B900100U)
+#define PIP_SHMPOOL_INDEX_MASK	((pip_atomic_t)0xFFFFFFFF)
+#define PIP_SHMPOOL_NBLKS_MAX	(0x7FFFFFFF)
+
+struct pip_shmpool {
+  /* read-only after creation */
+  uint32_t		magic;
+  int			nblks;
+  size_t		blksz;
+  void			*blocks;
+  uint32_t		*next;	/* index+1 of the next free block */
+  char			__pad0__[PIP_CACHEBLK_SZ - 32];
+  /* the free list head: ABA tag (upper 32 bits) and index+1 */
+  pip_atomic_t		head;
+  char			__pad1__[PIP_CACHEBLK_SZ - sizeof(pip_atomic_t)];
+};
+
+#define ROUNDUP(X,Y)		((((X)+(Y)-1)/(Y))*(Y))
+
+INLINE int pip_shmpool_check( pip_shmpool_t *pool ) {
+  return pool != NULL && pool->magic == PIP_SHMPOOL_MAGIC;
+}
+
+int pip_shmpool_create( pip_shmpool_t **poolp, size_t blksz, int nblks ) {
+  pip_shmpool_t	*pool;
+  size_t	pgsz, sz_hdr, sz_blks;
+  int		i;
+
+  if( !pip_is_effective() ) RETURN( EPERM );
+  if( poolp == NULL || blksz == 0 ) RETURN( EINVAL );
+  if( nblks <= 0 || nblks > PIP_SHMPOOL_NBLKS_MAX ) RETURN( EINVAL );
+
+  pgsz    = pip_root->page_size;
+  blksz   = ROUNDUP( blksz, PIP_CACHEBLK_SZ );
+  sz_hdr  = ROUNDUP( sizeof(pip_shmpool_t) + sizeof(uint32_t) * nblks, pgsz );
+  if( blksz > ( SIZE_MAX - sz_hdr ) / nblks ) RETURN( ENOMEM );
+  sz_blks = blksz * nblks;
+
+  if( pip_page_alloc( sz_hdr + sz_blks, (void**) &pool ) != 0 ) {
+    RETURN( ENOMEM );
+  }
+  memset( pool, 0, sizeof(pip_shmpool_t) );
+  pool->nblks  = nblks;
+  pool->blksz  = blksz;
+  pool->next   = (uint32_t*) ( pool + 1 );
+  pool->blocks = (void*) pool + sz_hdr;
+  for( i=0; i<nblks-1; i++ ) pool->next[i] = i + 2;
+  pool->next[nblks-1] = 0;
+  pool->head  = 1;
+  pip_memory_barrier();
+  pool->magic = PIP_SHMPOOL_MAGIC;
+
+  *poolp = pool;
+  RETURN( 0 );
+}
+
+int pip_shmpool_alloc( pip_shmpool_t *pool, void **blkp ) {
+  pip_atomic_t	old, new;
+  uint32_t	idx;
+
+  if( !pip_shmpool_check( pool ) || blkp == NULL ) RETURN( EINVAL );
+  do {
+    old = pool->head;
+    idx = old & PIP_SHMPOOL_INDEX_MASK;
+    if( idx == 0 ) return EAGAIN;
+    /* a stale next[] is harmless, the tag makes the CAS fail */
+    new = ( ( ( old >> 32 ) + 1 ) << 32 ) | pool->next[idx-1];
+  } while( !pip_comp_and_swap( &pool->head, old, new ) );
+
+  *blkp = pool->blocks + pool->blksz * ( idx - 1 );
+  return 0;
+}
+
+int pip_shmpool_free( pip_shmpool_t *pool, void *blk ) {
+  pip_atomic_t	old, new;
+  uintptr_t	off;
+  uint32_t	idx;
+
+  if( !pip_shmpool_check( pool ) ) RETURN( EINVAL );
+  off = (uintptr_t) blk - (uintptr_t) pool->blocks;
+  if( blk < pool->blocks            ||
+      off >= pool->blksz * pool->nblks ||
+      off %  pool->blksz != 0 ) RETURN( EINVAL );
+
+  idx = off / pool->blksz;
+  do {
+    old = pool->head;
+    pool->next[idx] = old & PIP_SHMPOOL_INDEX_MASK;
+    new = ( ( ( old >> 32 ) + 1 ) << 32 ) | ( idx + 1 );
+  } while( !pip_comp_and_swap( &pool->head, old, new ) );
+  return 0;
+}
+
+int pip_shmpool_size( pip_shmpool_t *pool, size_t *blkszp, int *nblksp ) {
+  if( !pip_shmpool_check( pool ) ) RETURN( EINVAL );
+  if( blkszp != NULL ) *blkszp = pool->blksz;
+  if( nblksp != NULL ) *nblksp = pool->nblks;
+  return 0;
+}
+
+int pip_shmpool_destroy( pip_shmpool_t *pool ) {
+  uint32_t	idx;
+  int		nfree = 0;
+
+  if( !pip_shmpool_check( pool ) ) RETURN( EINVAL );
+  /* nobody may touch the pool at this time */
+  for( idx = pool->head & PIP_SHMPOOL_INDEX_MASK;
+       idx != 0 && nfree <= pool->nblks;
+       idx = pool->next[idx-1] ) nfree ++;
+  if( nfree != pool->nblks ) RETURN( EBUSY );
+
+  pool->magic = 0;
+  pip_page_free( pool );
+  RETURN( 0 );
+}
@@ -431,6 +431,7 @@ static void pip_unset_abort_handler( void ) {
 void pip_raise_sigchld( pip_task_t *task ) {
   if( pip_is_threaded_() ) {
     task->flag_sigchld = 1;
+    pip_wait_fd_notify( pip_root );
     ASSERT( pip_raise_signal( pip_root->task_root, SIGCHLD ) == 0 );
   }
 }
@@ -445,7 +446,9 @@ int pip_kill_all_children_( int killsig ) {
       if( !pip_aborted ) {
 	pip_aborted = 1;
 
-	for( i=0; i<pip_root->ntasks; i++ ) {
+	for( i = pip_next_busy_task( pip_root, 0 );
+	     i >= 0;
+	     i = pip_next_busy_task( pip_root, i + 1 ) ) {
 	  pip_task_t *task = &pip_root->tasks[i];
 	  if( PIP_IS_ALIVE( task ) ) {
 	    if( killsig != 0 ) {
@@ -220,7 +220,9 @@ void pip_do_exit( pip_task_t *task, int flag, uintptr_t extval ) {
   if( root != NULL && 
       task != NULL &&
       PIP_ISA_ROOT( task ) ) {
-    for( i=0; i<root->ntasks; i++ ) {
+    for( i = pip_next_busy_task( root, 0 );
+	 i >= 0;
+	 i = pip_next_busy_task( root, i + 1 ) ) {
       pip_task_t *t = &root->tasks[i];
       if( PIP_IS_ALIVE( t ) ) {
 	/* sending signal 0 to check if the task 
@@ -247,6 +249,10 @@ void pip_do_exit( pip_task_t *task, int flag, uintptr_t extval ) {
     }
   }
   DBGF( "FORCE EXIT:%lu", extval );
+  if( flag_pip && root != NULL && task != NULL && !PIP_ISA_ROOT( task ) ) {
+    /* let the root find this task without scanning all */
+    pip_wait_cq_push( root, task );
+  }
   if( flag_pip && is_threaded && !PIP_ISA_ROOT( task ) ) {	
     /* child task in thread mode */
     libc_pthread_exit_t pthrd_exit = 
@@ -360,6 +366,7 @@ void *__pip_start_task( pip_root_t *root,
 
   DBG;
   pip_set_libc_ftab( task->libc_ftabp );
+  pip_arena_attach( task );
   pip_dont_wrap_malloc = 0;
     
   if( root->opts & PIP_MODE_PTHREAD ) {
@@ -402,6 +409,9 @@ void *__pip_start_task( pip_root_t *root,
       DBG;
       extval = err;
       
+    } else if( task->pool_slot != NULL ) {
+      /* parked in the task pool, serving dispatched functions */
+      extval = pip_task_pool_serve( task );
     } else if( args->funcname == NULL ) {
       extern char **environ;
       main_func_t start_main = args->func_main;
@@ -0,0 +1,414 @@
+
+/*
+ * $PIP_license: <Simplified BSD License>
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *     Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ * 
+ *     Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ * $
+ * $RIKEN_copyright: Riken Center for Computational Sceience (R-CCS),
+ * System Software Development Team, 2016-2022
+ * $
+ * $PIP_VERSION: Version 2.4.1$
+ *
+ * $Author: Atsushi Hori 
+ * Query:   procinproc-info@googlegroups.com
+ * User ML: procinproc-users@googlegroups.com
+ * $
+ */
+
+#include <pip/pip_internal.h>
+
+/* The synchronization objects here are built on 32-bit futex words  */
+/* only, so that they can be placed anywhere in the (shared) address */
+/* space and work in the same way in the thread and process modes.   */
+/* All of them spin for a while before sleeping in the kernel.       */
+
+/* mutex */
+
+int pip_mutex_init( pip_mutex_t *mutex ) {
+  if( mutex == NULL ) RETURN( EINVAL );
+  pip_mutex_init_( mutex );
+  return 0;
+}
+
+int pip_mutex_lock( pip_mutex_t *mutex ) {
+  if( mutex == NULL ) RETURN( EINVAL );
+  pip_mutex_lock_( mutex );
+  return 0;
+}
+
+int pip_mutex_trylock( pip_mutex_t *mutex ) {
+  if( mutex == NULL ) RETURN( EINVAL );
+  return pip_mutex_trylock_( mutex );
+}
+
+int pip_mutex_unlock( pip_mutex_t *mutex ) {
+  if( mutex == NULL   ) RETURN( EINVAL );
+  if( mutex->word == 0 ) RETURN( EPERM );
+  pip_mutex_unlock_( mutex );
+  return 0;
+}
+
+int pip_mutex_fin( pip_mutex_t *mutex ) {
+  if( mutex == NULL   ) RETURN( EINVAL );
+  if( mutex->word != 0 ) RETURN( EBUSY );
+  return 0;
+}
+
+/* condition variable */
+
+int pip_cond_init( pip_cond_t *cond ) {
+  if( cond == NULL ) RETURN( EINVAL );
+  cond->seq = 0;
+  return 0;
+}
+
+int pip_cond_timedwait( pip_cond_t *cond,
+			pip_mutex_t *mutex,
+			const struct timespec *timeout ) {
+  struct timespec	ts, *deadline;
+  uint32_t		seq;
+  int			err;
+
+  if( cond == NULL || mutex == NULL ) RETURN( EINVAL );
+  deadline = pip_sync_deadline( timeout, &ts );
+  /* the sequence number must be taken before unlocking */
+  seq = cond->seq;
+  pip_mutex_unlock_( mutex );
+  err = pip_futex_wait_until( &cond->seq, seq, deadline );
+  /* other waiters may be woken up at the same time */
+  pip_mutex_lock_contended( mutex );
+  return ( err == ETIMEDOUT ) ? ETIMEDOUT : 0;
+}
+
+int pip_cond_wait( pip_cond_t *cond, pip_mutex_t *mutex ) {
+  return pip_cond_timedwait( cond, mutex, NULL );
+}
+
+int pip_cond_signal( pip_cond_t *cond ) {
+  if( cond == NULL ) RETURN( EINVAL );
+  (void) __sync_fetch_and_add( &cond->seq, 1 );
+  pip_futex_wake( &cond->seq, 1 );
+  return 0;
+}
+
+int pip_cond_broadcast( pip_cond_t *cond ) {
+  if( cond == NULL ) RETURN( EINVAL );
+  (void) __sync_fetch_and_add( &cond->seq, 1 );
+  pip_futex_wake_all( &cond->seq );
+  return 0;
+}
+
+int pip_cond_fin( pip_cond_t *cond ) {
+  if( cond == NULL ) RETURN( EINVAL );
+  return 0;
+}
+
+/* semaphore */
+
+int pip_semaphore_init( pip_semaphore_t *sem, unsigned int value ) {
+  if( sem == NULL || value > INT_MAX ) RETURN( EINVAL );
+  pip_sem_init_n( sem, value );
+  return 0;
+}
+
+int pip_semaphore_post( pip_semaphore_t *sem ) {
+  if( sem == NULL ) RETURN( EINVAL );
+  pip_sem_post( sem );
+  return 0;
+}
+
+int pip_semaphore_wait( pip_semaphore_t *sem ) {
+  if( sem == NULL ) RETURN( EINVAL );
+  return pip_sem_wait_until( sem, NULL );
+}
+
+int pip_semaphore_trywait( pip_semaphore_t *sem ) {
+  if( sem == NULL ) RETURN( EINVAL );
+  return pip_sem_trywait( sem );
+}
+
+int pip_semaphore_timedwait( pip_semaphore_t *sem,
+			     const struct timespec *timeout ) {
+  struct timespec ts;
+
+  if( sem == NULL || timeout == NULL ) RETURN( EINVAL );
+  return pip_sem_wait_until( sem, pip_sync_deadline( timeout, &ts ) );
+}
+
+int pip_semaphore_fin( pip_semaphore_t *sem ) {
+  if( sem == NULL         ) RETURN( EINVAL );
+  if( sem->nwaiters != 0  ) RETURN( EBUSY );
+  return 0;
+}
+
+/* reader-writer lock, waiting writers are preferred */
+
+INLINE int pip_rwlock_tryrdlock_( pip_rwlock_t *rwlock ) {
+  uint32_t s;
+
+  while( !( ( s = rwlock->state ) & PIP_RWLOCK_WRITER ) &&
+	 rwlock->nwriters == 0 ) {
+    if( __sync_bool_compare_and_swap( &rwlock->state, s, s + 1 ) ) return 0;
+  }
+  return EBUSY;
+}
+
+INLINE int pip_rwlock_trywrlock_( pip_rwlock_t *rwlock ) {
+  return __sync_bool_compare_and_swap( &rwlock->state,
+				       0,
+				       PIP_RWLOCK_WRITER ) ? 0 : EBUSY;
+}
+
+static void pip_rwlock_block( pip_rwlock_t *rwlock,
+			      int(*trylock)( pip_rwlock_t* ) ) {
+  uint32_t	seq;
+  int		i;
+
+  for( i=0; i<PIP_SYNC_SPIN; i++ ) {
+    if( trylock( rwlock ) == 0 ) return;
+    pip_pause();
+  }
+  (void) __sync_fetch_and_add( &rwlock->nwaiters, 1 );
+  while( 1 ) {
+    seq = rwlock->seq;
+    if( trylock( rwlock ) == 0 ) break;
+    (void) pip_futex_wait( &rwlock->seq, seq, NULL );
+  }
+  (void) __sync_fetch_and_sub( &rwlock->nwaiters, 1 );
+}
+
+int pip_rwlock_init( pip_rwlock_t *rwlock ) {
+  if( rwlock == NULL ) RETURN( EINVAL );
+  memset( (void*) rwlock, 0, sizeof( pip_rwlock_t ) );
+  return 0;
+}
+
+int pip_rwlock_rdlock( pip_rwlock_t *rwlock ) {
+  if( rwlock == NULL ) RETURN( EINVAL );
+  pip_rwlock_block( rwlock, pip_rwlock_tryrdlock_ );
+  return 0;
+}
+
+int pip_rwlock_tryrdlock( pip_rwlock_t *rwlock ) {
+  if( rwlock == NULL ) RETURN( EINVAL );
+  return pip_rwlock_tryrdlock_( rwlock );
+}
+
+int pip_rwlock_wrlock( pip_rwlock_t *rwlock ) {
+  if( rwlock == NULL ) RETURN( EINVAL );
+  /* new readers are blocked while writers are waiting */
+  (void) __sync_fetch_and_add( &rwlock->nwriters, 1 );
+  pip_rwlock_block( rwlock, pip_rwlock_trywrlock_ );
+  (void) __sync_fetch_and_sub( &rwlock->nwriters, 1 );
+  return 0;
+}
+
+int pip_rwlock_trywrlock( pip_rwlock_t *rwlock ) {
+  if( rwlock == NULL ) RETURN( EINVAL );
+  return pip_rwlock_trywrlock_( rwlock );
+}
+
+int pip_rwlock_unlock( pip_rwlock_t *rwlock ) {
+  uint32_t s;
+
+  if( rwlock == NULL ) RETURN( EINVAL );
+  if( ( s = rwlock->state ) == 0 ) RETURN( EPERM );
+  if( s == PIP_RWLOCK_WRITER ) {
+    (void) __sync_bool_compare_and_swap( &rwlock->state, s, 0 );
+  } else if( __sync_sub_and_fetch( &rwlock->state, 1 ) != 0 ) {
+    /* still read-locked by the others */
+    return 0;
+  }
+  if( rwlock->nwaiters > 0 ) {
+    (void) __sync_fetch_and_add( &rwlock->seq, 1 );
+    pip_futex_wake_all( &rwlock->seq );
+  }
+  return 0;
+}
+
+int pip_rwlock_fin( pip_rwlock_t *rwlock ) {
+  if( rwlock == NULL        ) RETURN( EINVAL );
+  if( rwlock->state    != 0 ||
+      rwlock->nwaiters != 0 ) RETURN( EBUSY );
+  return 0;
+}
+
+/* barrier */
+
+int pip_barrier_init( pip_barrier_t *barrp, int n ) {
+  if( !pip_is_effective() ) return EPERM;
+  if( n <= 0 ) return EINVAL;
+  barrp->count      = n;
+  barrp->count_init = n;
+  barrp->generation = 0;
+  return 0;
+}
+
+int pip_barrier_wait( pip_barrier_t *barrp ) {
+  uint32_t	gen;
+  int		i;
+
+  if( barrp->count_init > 1 ) {
+    gen = barrp->generation;
+    if( __sync_sub_and_fetch( &barrp->count, 1 ) == 0 ) {
+      barrp->count = barrp->count_init;
+      pip_memory_barrier();
+      barrp->generation = gen + 1;
+      /* all waiters are woken up at once */
+      pip_futex_wake_all( &barrp->generation );
+    } else {
+      for( i=0; i<PIP_SYNC_SPIN; i++ ) {
+	if( barrp->generation != gen ) return 0;
+	pip_pause();
+      }
+      while( barrp->generation == gen ) {
+	DBG;
+	(void) pip_futex_wait( &barrp->generation, gen, NULL );
+      }
+    }
+  }
+  return 0;
+}
+
+int pip_barrier_fin( pip_barrier_t *barrp ) {
+  if( !pip_is_effective()               ) return EPERM;
+  if( barrp->count != barrp->count_init ) return EBUSY;
+  return 0;
+}
+
+/* combining tree barrier */
+
+#define PIP_TBARRIER_MAGIC	(0x5B900200U)
+#define PIP_TBARRIER_RADIX	(4)
+
+/* a tree node has its own cache block not to be shared with the */
+/* others. ranks are grouped from 0, so that the sub-trees are    */
+/* local when the tasks are spawned on the consecutive cores      */
+typedef struct pip_tbarrier_node {
+  volatile uint32_t	count;	/* arrivals to wait for */
+  uint32_t		count_init;
+  int			parent;	/* -1 for the root node */
+  char			__pad__[PIP_CACHEBLK_SZ - 12];
+} pip_tbarrier_node_t;
+
+struct pip_tree_barrier {
+  uint32_t		magic;
+  int			n;
+  int			nnodes;
+  char			__pad0__[PIP_CACHEBLK_SZ - 12];
+  /* release, only the root arriver writes this */
+  volatile uint32_t	generation;
+  volatile uint32_t	nsleepers;
+  char			__pad1__[PIP_CACHEBLK_SZ - 8];
+  pip_tbarrier_node_t	nodes[];	/* leaves first */
+};
+
+int pip_tree_barrier_create( pip_tree_barrier_t **barrp, int n ) {
+  pip_tree_barrier_t	*barr;
+  int			nnodes, width, base, i, j, nchild;
+
+  if( !pip_is_effective() ) RETURN( EPERM );
+  if( barrp == NULL || n <= 0 ) RETURN( EINVAL );
+
+  nnodes = 0;
+  width  = n;
+  do {
+    width   = ( width + PIP_TBARRIER_RADIX - 1 ) / PIP_TBARRIER_RADIX;
+    nnodes += width;
+  } while( width > 1 );
+
+  if( pip_page_alloc( sizeof( pip_tree_barrier_t ) +
+		      sizeof( pip_tbarrier_node_t ) * nnodes,
+		      (void**) &barr ) != 0 ) RETURN( ENOMEM );
+  memset( barr, 0, sizeof( pip_tree_barrier_t ) );
+  barr->n      = n;
+  barr->nnodes = nnodes;
+  /* build the tree level by level */
+  base  = 0;
+  width = n;			/* number of children of this level */
+  do {
+    nchild = width;
+    width  = ( nchild + PIP_TBARRIER_RADIX - 1 ) / PIP_TBARRIER_RADIX;
+    for( i=0; i<width; i++ ) {
+      j = nchild - i * PIP_TBARRIER_RADIX;
+      barr->nodes[base+i].count_init =
+	( j < PIP_TBARRIER_RADIX ) ? j : PIP_TBARRIER_RADIX;
+      barr->nodes[base+i].count  = barr->nodes[base+i].count_init;
+      barr->nodes[base+i].parent =
+	( width > 1 ) ? base + width + i / PIP_TBARRIER_RADIX : -1;
+    }
+    base += width;
+  } while( width > 1 );
+  pip_memory_barrier();
+  barr->magic = PIP_TBARRIER_MAGIC;
+
+  *barrp = barr;
+  RETURN( 0 );
+}
+
+int pip_tree_barrier_wait( pip_tree_barrier_t *barr, int rank ) {
+  pip_tbarrier_node_t	*node;
+  uint32_t		gen;
+  int			i;
+
+  if( barr == NULL || barr->magic != PIP_TBARRIER_MAGIC ) RETURN( EINVAL );
+  if( rank < 0 || rank >= barr->n ) RETURN( ERANGE );
+
+  gen  = barr->generation;
+  node = &barr->nodes[ rank / PIP_TBARRIER_RADIX ];
+  while( __sync_sub_and_fetch( &node->count, 1 ) == 0 ) {
+    /* the last arriver of the node, nobody touches this node */
+    /* until the release                                      */
+    node->count = node->count_init;
+    if( node->parent < 0 ) {
+      pip_memory_barrier();
+      barr->generation = gen + 1;
+      pip_memory_barrier();
+      if( barr->nsleepers > 0 ) pip_futex_wake_all( &barr->generation );
+      return 0;
+    }
+    node = &barr->nodes[ node->parent ];
+  }
+  for( i=0; i<PIP_SYNC_SPIN; i++ ) {
+    if( barr->generation != gen ) return 0;
+    pip_pause();
+  }
+  (void) __sync_fetch_and_add( &barr->nsleepers, 1 );
+  while( barr->generation == gen ) {
+    (void) pip_futex_wait( &barr->generation, gen, NULL );
+  }
+  (void) __sync_fetch_and_sub( &barr->nsleepers, 1 );
+  return 0;
+}
+
+int pip_tree_barrier_destroy( pip_tree_barrier_t *barr ) {
+  int i;
+
+  if( barr == NULL || barr->magic != PIP_TBARRIER_MAGIC ) RETURN( EINVAL );
+  for( i=0; i<barr->nnodes; i++ ) {
+    if( barr->nodes[i].count != barr->nodes[i].count_init ) RETURN( EBUSY );
+  }
+  if( barr->nsleepers > 0 ) RETURN( EBUSY );
+  barr->magic = 0;
+  pip_page_free( barr );
+  RETURN( 0 );
+}
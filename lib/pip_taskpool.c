@@ -0,0 +1,321 @@
+
+/*
+ * $PIP_license: <Simplified BSD License>
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ *     Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ * 
+ *     Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ * $
+ * $RIKEN_copyright: Riken Center for Computational Sceience (R-CCS),
+ * System Software Development Team, 2016-2022
+ * $
+ * $PIP_VERSION: Version 2.4.1$
+ *
+ * $Author: Atsushi Hori 
+ * Query:   procinproc-info@googlegroups.com
+ * User ML: procinproc-users@googlegroups.com
+ * $
+ */
+
+#include <pip/pip_internal.h>
+
+#define PIP_TASK_POOL_MAGIC	(0x5B900200U)
+
+#define PIP_POOL_IDLE		(0)
+#define PIP_POOL_CLAIMED	(1) /* being filled by a dispatcher */
+#define PIP_POOL_BUSY		(2)
+#define PIP_POOL_DONE		(3)
+#define PIP_POOL_QUIT		(4)
+
+typedef struct pip_pool_slot {
+  pip_sem_t		request; /* posted by dispatcher */
+  pip_sem_t		done;	 /* posted by pool task  */
+  pip_atomic_t		state;
+  struct pip_task_pool	*pool;
+  pip_task_t		*task;
+  pip_task_pool_func_t	func;	/* resolved by dispatcher */
+  int			pipid;
+  int			retval;
+  int			err;
+  void			*arg;
+  char			funcname[PIP_TASK_POOL_FUNCNAME_MAX];
+} pip_pool_slot_t;
+
+struct pip_task_pool {
+  uint32_t		magic;
+  int			ntasks;
+  pip_pool_slot_t	*slots;
+  pip_sem_t		done_any; /* posted on every completion */
+};
+
+#define ROUNDUP(X,Y)		((((X)+(Y)-1)/(Y))*(Y))
+#define PIP_POOL_SLOT(P,I)	\
+  ((pip_pool_slot_t*)((void*)(P)->slots + PIP_POOL_SLOT_SZ * (I)))
+#define PIP_POOL_SLOT_SZ	ROUNDUP( sizeof(pip_pool_slot_t), PIP_CACHEBLK_SZ )
+
+INLINE int pip_task_pool_check( pip_task_pool_t *pool ) {
+  return pool != NULL && pool->magic == PIP_TASK_POOL_MAGIC;
+}
+
+static void pip_task_pool_done( pip_pool_slot_t *slot ) {
+  pip_memory_barrier();
+  slot->state = PIP_POOL_DONE;
+  pip_sem_post( &slot->done );
+  pip_sem_post( &slot->pool->done_any );
+}
+
+/* the pool task side: executed in the start function of the task */
+int pip_task_pool_serve( pip_task_t *task ) {
+  pip_pool_slot_t *slot = (pip_pool_slot_t*) task->pool_slot;
+
+  ENTER;
+  while( 1 ) {
+    pip_sem_wait( &slot->request );
+    if( slot->state == PIP_POOL_QUIT ) break;
+    if( slot->state != PIP_POOL_BUSY ) continue;
+
+    DBGF( ">> %s@%p(%p)", slot->funcname, slot->func, slot->arg );
+    slot->retval = slot->func( slot->arg );
+    slot->err    = 0;
+    DBGF( "<< %s@%p(%p) = %d", slot->funcname, slot->func, slot->arg,
+	  slot->retval );
+    pip_task_pool_done( slot );
+  }
+  RETURN( 0 );
+}
+
+/* the name is looked up in the name space of the pool task by the */
+/* dlsym() of the root name space. a dlsym() called inside the task */
+/* name space may abort, instead of returning NULL, on a failure    */
+static pip_task_pool_func_t
+pip_task_pool_dlsym( pip_task_t *task, const char *funcname ) {
+  void *addr;
+
+  pip_libc_lock();
+  addr = pip_libc_ftab( pip_root->task_root )->dlsym( task->loaded, funcname );
+  pip_libc_unlock();
+  return (pip_task_pool_func_t) addr;
+}
+
+static void pip_task_pool_setup( pip_task_t *task, int ith, void *varg ) {
+  pip_task_pool_t *pool = (pip_task_pool_t*) varg;
+  pip_pool_slot_t *slot = PIP_POOL_SLOT( pool, ith );
+
+  slot->task      = task;
+  task->pool_slot = slot;
+}
+
+int pip_task_pool_create( pip_task_pool_t **poolp,
+			  pip_spawn_program_t *progp,
+			  int ntasks,
+			  uint32_t coreno ) {
+  pip_task_pool_t *pool;
+  pip_pool_slot_t *slot;
+  size_t	  sz_hdr;
+  int		  *pipids, i, err;
+
+  ENTER;
+  if( !pip_is_effective() ) RETURN( EPERM );
+  if( pip_task != NULL && !PIP_ISA_ROOT( pip_task ) ) RETURN( EPERM );
+  if( poolp == NULL || progp == NULL || ntasks <= 0 ) RETURN( EINVAL );
+  if( ntasks > pip_root->ntasks ) RETURN( EINVAL );
+
+  sz_hdr = ROUNDUP( sizeof(pip_task_pool_t), PIP_CACHEBLK_SZ );
+  if( pip_page_alloc( sz_hdr + PIP_POOL_SLOT_SZ * ntasks,
+		      (void**) &pool ) != 0 ) RETURN( ENOMEM );
+  memset( pool, 0, sz_hdr + PIP_POOL_SLOT_SZ * ntasks );
+  pool->ntasks = ntasks;
+  pool->slots  = (void*) pool + sz_hdr;
+  pip_sem_init( &pool->done_any );
+  for( i=0; i<ntasks; i++ ) {
+    slot = PIP_POOL_SLOT( pool, i );
+    pip_sem_init( &slot->request );
+    pip_sem_init( &slot->done    );
+    slot->pool  = pool;
+    slot->pipid = PIP_PIPID_NULL;
+  }
+
+  pipids = alloca( sizeof(int) * ntasks );
+  for( i=0; i<ntasks; i++ ) pipids[i] = PIP_PIPID_ANY;
+  err = pip_do_task_spawn_n( progp, ntasks, coreno, 0, pipids, NULL,
+			     pip_task_pool_setup, pool );
+  for( i=0; i<ntasks; i++ ) PIP_POOL_SLOT( pool, i )->pipid = pipids[i];
+  if( err ) {
+    /* terminate the tasks already spawned */
+    for( i=0; i<ntasks; i++ ) {
+      slot = PIP_POOL_SLOT( pool, i );
+      if( slot->pipid == PIP_PIPID_NULL ) continue;
+      slot->state = PIP_POOL_QUIT;
+      pip_sem_post( &slot->request );
+      (void) pip_wait( slot->pipid, NULL );
+    }
+    goto error;
+  }
+  pip_memory_barrier();
+  pool->magic = PIP_TASK_POOL_MAGIC;
+  *poolp = pool;
+  RETURN( 0 );
+
+ error:
+  for( i=0; i<ntasks; i++ ) {
+    slot = PIP_POOL_SLOT( pool, i );
+    pip_sem_fin( &slot->request );
+    pip_sem_fin( &slot->done    );
+  }
+  pip_sem_fin( &pool->done_any );
+  pip_page_free( pool );
+  RETURN( err );
+}
+
+int pip_task_pool_dispatch( pip_task_pool_t *pool,
+			    const char *funcname,
+			    void *arg,
+			    int *pipidp ) {
+  pip_pool_slot_t *slot;
+  int i;
+
+  ENTER;
+  if( !pip_task_pool_check( pool ) || funcname == NULL ) RETURN( EINVAL );
+  if( strlen( funcname ) >= PIP_TASK_POOL_FUNCNAME_MAX ) {
+    RETURN( ENAMETOOLONG );
+  }
+  for( i=0; i<pool->ntasks; i++ ) {
+    slot = PIP_POOL_SLOT( pool, i );
+    if( slot->state != PIP_POOL_IDLE ) continue;
+    if( pip_comp_and_swap( &slot->state, PIP_POOL_IDLE, PIP_POOL_CLAIMED ) ) {
+      goto found;
+    }
+  }
+  RETURN( EAGAIN );
+
+ found:
+  if( pipidp != NULL ) *pipidp = slot->pipid;
+  /* the last function of the slot is remembered to skip dlsym() */
+  if( slot->func == NULL || strcmp( slot->funcname, funcname ) != 0 ) {
+    slot->func = pip_task_pool_dlsym( slot->task, funcname );
+    strcpy( slot->funcname, ( slot->func != NULL ) ? funcname : "" );
+  }
+  slot->arg = arg;
+  if( slot->func == NULL ) {
+    /* the pool task is not woken up, the error is delivered */
+    /* to the waiter as if the function had been run        */
+    DBGF( "'%s' not found", funcname );
+    slot->err = ENOENT;
+    pip_task_pool_done( slot );
+  } else {
+    pip_memory_barrier();
+    slot->state = PIP_POOL_BUSY;
+    pip_sem_post( &slot->request );
+  }
+  RETURN( 0 );
+}
+
+/* DONE -> IDLE. returns 1 if the result is taken, or minus */
+/* the error number if the function was not run             */
+static int pip_task_pool_collect( pip_pool_slot_t *slot, int *retvalp ) {
+  int retval, err;
+
+  if( slot->state != PIP_POOL_DONE ) return 0;
+  retval = slot->retval;
+  err    = slot->err;
+  if( !pip_comp_and_swap( &slot->state, PIP_POOL_DONE, PIP_POOL_IDLE ) ) {
+    return 0;
+  }
+  if( !err && retvalp != NULL ) *retvalp = retval;
+  return err ? -err : 1;
+}
+
+int pip_task_pool_wait( pip_task_pool_t *pool, int pipid, int *retvalp ) {
+  pip_pool_slot_t *slot = NULL;
+  int i, rv;
+
+  ENTER;
+  if( !pip_task_pool_check( pool ) ) RETURN( EINVAL );
+  for( i=0; i<pool->ntasks; i++ ) {
+    if( PIP_POOL_SLOT( pool, i )->pipid == pipid ) {
+      slot = PIP_POOL_SLOT( pool, i );
+      break;
+    }
+  }
+  if( slot == NULL ) RETURN( ESRCH );
+  while( 1 ) {
+    if( ( rv = pip_task_pool_collect( slot, retvalp ) ) != 0 ) {
+      RETURN( ( rv < 0 ) ? -rv : 0 );
+    }
+    /* nothing dispatched, or collected by someone else */
+    if( slot->state == PIP_POOL_IDLE ) RETURN( ECHILD );
+    pip_sem_wait( &slot->done );
+  }
+}
+
+int pip_task_pool_wait_any( pip_task_pool_t *pool,
+			    int *pipidp,
+			    int *retvalp ) {
+  pip_pool_slot_t *slot;
+  int i, rv, nbusy;
+
+  ENTER;
+  if( !pip_task_pool_check( pool ) ) RETURN( EINVAL );
+  while( 1 ) {
+    nbusy = 0;
+    for( i=0; i<pool->ntasks; i++ ) {
+      slot = PIP_POOL_SLOT( pool, i );
+      if( ( rv = pip_task_pool_collect( slot, retvalp ) ) != 0 ) {
+	if( pipidp != NULL ) *pipidp = slot->pipid;
+	RETURN( ( rv < 0 ) ? -rv : 0 );
+      }
+      if( slot->state != PIP_POOL_IDLE ) nbusy ++;
+    }
+    if( nbusy == 0 ) RETURN( ECHILD );
+    /* a post may be left by the completion collected by */
+    /* pip_task_pool_wait(), then just scan again        */
+    pip_sem_wait( &pool->done_any );
+  }
+}
+
+int pip_task_pool_destroy( pip_task_pool_t *pool ) {
+  pip_pool_slot_t *slot;
+  int i, err = 0;
+
+  ENTER;
+  if( !pip_task_pool_check( pool ) ) RETURN( EINVAL );
+  for( i=0; i<pool->ntasks; i++ ) {
+    slot = PIP_POOL_SLOT( pool, i );
+    if( slot->state == PIP_POOL_CLAIMED ||
+	slot->state == PIP_POOL_BUSY ) RETURN( EBUSY );
+  }
+  pool->magic = 0;
+  for( i=0; i<pool->ntasks; i++ ) {
+    slot = PIP_POOL_SLOT( pool, i );
+    slot->state = PIP_POOL_QUIT;
+    pip_sem_post( &slot->request );
+  }
+  for( i=0; i<pool->ntasks; i++ ) {
+    slot = PIP_POOL_SLOT( pool, i );
+    if( ( err = pip_wait( slot->pipid, NULL ) ) != 0 ) {
+      DBGF( "pip_wait(%d)=%d", slot->pipid, err );
+    }
+    pip_sem_fin( &slot->request );
+    pip_sem_fin( &slot->done    );
+  }
+  pip_sem_fin( &pool->done_any );
+  pip_page_free( pool );
+  RETURN( 0 );
+}
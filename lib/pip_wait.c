@@ -36,6 +36,20 @@
 //#define PIP_DEADLOCK_WARN
 
 #include <pip/pip_internal.h>
+#include <pip/pip_mem.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <poll.h>
+
+#ifndef SYS_pidfd_open
+#define SYS_pidfd_open		(434)
+#endif
+#ifndef PIDFD_NONBLOCK
+#define PIDFD_NONBLOCK		O_NONBLOCK
+#endif
+
+/* task->pidfd of a task whose pidfd_open() failed */
+#define PIP_PIDFD_NONE		(-2)
 
 void
 pip_set_exit_status( pip_task_t *task, int exitno, int termsig ) {
@@ -52,15 +66,248 @@ pip_set_exit_status( pip_task_t *task, int exitno, int termsig ) {
 }
 
 void pip_annul_task( pip_task_t *task ) {
-  task->type   = PIP_TYPE_NULL;
-  task->thread = 0;
-  task->pid    = 0;
-  task->tid    = 0;
+  if( PIP_IS_ALIVE( task ) ) pip_root->ntasks_curr --;
+  pip_task_slot_release( task );
+  task->type    = PIP_TYPE_NULL;
+  task->thread  = 0;
+  task->pid     = 0;
+  task->tid     = 0;
+  task->flag_cq = 0;
+  if( task->pidfd >= 0 ) {
+    /* the pidfd stays in the epoll set as long as a copy of it is */
+    /* open, which may be inherited by the tasks spawned later     */
+    if( pip_root->wait_epfd >= 0 ) {
+      (void) epoll_ctl( pip_root->wait_epfd, EPOLL_CTL_DEL,
+			task->pidfd, NULL );
+    }
+    (void) close( task->pidfd );
+  } else if( task->pidfd == PIP_PIDFD_NONE ) {
+    pip_root->ntasks_nopidfd --;
+  }
+  task->pidfd = -1;
+}
+
+/* Completion queue: a terminating task pushes its PiP ID so that */
+/* pip_wait_any() can find it without scanning all tasks. This is */
+/* a bounded MPSC ring whose cells have sequence numbers. A task  */
+/* killed by a signal never pushes, so that the occupied slots    */
+/* are still scanned in process mode. In thread mode, the queue   */
+/* is authoritative and the slots are scanned only after a push   */
+/* is dropped because the ring is full. The events posted by      */
+/* pip_post_event() are queued in the same way.                   */
+
+#define PIP_EVENTQ_SZ		(1024)
+
+typedef struct pip_wait_cq_cell {
+  volatile uint64_t	seq;
+  int			pipid;
+  uint64_t		value;
+} pip_wait_cq_cell_t;
+
+typedef struct pip_wait_cq {
+  uint64_t		mask;
+  char			__pad0__[PIP_CACHEBLK_SZ - sizeof(uint64_t)];
+  volatile uint64_t	tail;	/* tasks */
+  char			__pad1__[PIP_CACHEBLK_SZ - sizeof(uint64_t)];
+  volatile uint64_t	head;	/* root */
+  char			__pad2__[PIP_CACHEBLK_SZ - sizeof(uint64_t)];
+  pip_wait_cq_cell_t	cells[];
+} pip_wait_cq_t;
+
+static pip_wait_cq_t *pip_wait_cq_new( int n ) {
+  pip_wait_cq_t	*cq;
+  uint64_t	i, sz;
+
+  for( sz=1; sz<n; sz*=2 );
+  if( pip_page_alloc( sizeof( pip_wait_cq_t ) +
+		      sizeof( pip_wait_cq_cell_t ) * sz,
+		      (void**) &cq ) != 0 ) return NULL;
+  memset( cq, 0, sizeof( pip_wait_cq_t ) );
+  cq->mask = sz - 1;
+  for( i=0; i<sz; i++ ) cq->cells[i].seq = i;
+  return cq;
+}
+
+static int pip_wait_cq_enq( pip_wait_cq_t *cq, int pipid, uint64_t value ) {
+  pip_wait_cq_cell_t	*cell;
+  uint64_t		pos;
+  int64_t		dif;
+
+  pos = cq->tail;
+  while( 1 ) {
+    cell = &cq->cells[ pos & cq->mask ];
+    dif  = (int64_t) cell->seq - (int64_t) pos;
+    if( dif == 0 ) {
+      if( __sync_bool_compare_and_swap( &cq->tail, pos, pos + 1 ) ) break;
+    } else if( dif < 0 ) {	/* full */
+      return EAGAIN;
+    }
+    pos = cq->tail;
+  }
+  cell->pipid = pipid;
+  cell->value = value;
+  pip_write_barrier();
+  cell->seq = pos + 1;
+  return 0;
+}
+
+/* the root is the only consumer, an entry can be left in the queue */
+static pip_wait_cq_cell_t *pip_wait_cq_peek( pip_wait_cq_t *cq ) {
+  pip_wait_cq_cell_t *cell = &cq->cells[ cq->head & cq->mask ];
+
+  if( cell->seq != cq->head + 1 ) return NULL; /* empty */
+  pip_memory_barrier();
+  return cell;
+}
+
+static void pip_wait_cq_deq( pip_wait_cq_t *cq, pip_wait_cq_cell_t *cell ) {
+  cell->seq = cq->head + cq->mask + 1;
+  cq->head ++;
+}
+
+void pip_wait_cq_init( pip_root_t *root ) {
+  /* room for stale entries of the tasks waited by pip_wait() */
+  root->wait_cq = pip_wait_cq_new( 2 * root->ntasks );
+  root->event_q = pip_wait_cq_new( PIP_EVENTQ_SZ );
+}
+
+void pip_wait_cq_fin( pip_root_t *root ) {
+  pip_page_free( root->wait_cq );
+  pip_page_free( root->event_q );
+  root->wait_cq = NULL;
+  root->event_q = NULL;
+}
+
+void pip_wait_cq_push( pip_root_t *root, pip_task_t *task ) {
+  if( root->wait_cq == NULL ) return;
+  task->flag_cq = 1;
+  if( pip_wait_cq_enq( root->wait_cq, task->pipid, 0 ) != 0 ) {
+    DBGF( "PIPID:%d wait queue is full", task->pipid );
+    /* let the root scan the tasks */
+    (void) __sync_fetch_and_add( &root->wait_cq_nlost, 1 );
+  }
+}
+
+/* Wait backend: instead of waiting for SIGCHLD, the root sleeps in */
+/* epoll_wait() on the pidfds of the tasks in process mode, and on  */
+/* an eventfd written by terminating tasks in thread mode. The      */
+/* data of an epoll event is the PiP ID of the terminated task, or  */
+/* PIP_PIPID_NULL for the eventfd. If pidfd_open() or epoll is not  */
+/* available, the backend is disabled and SIGCHLD is waited for.    */
+/* If only the pidfd of a task cannot be opened, SIGCHLD is waited  */
+/* for while the task is alive.                                     */
+
+void pip_wait_fd_init( pip_root_t *root ) {
+  struct epoll_event ev;
+
+  root->wait_epfd = -1;
+  root->wait_evfd = -1;
+  root->ntasks_nopidfd = 0;
+  if( ( root->wait_epfd = epoll_create1( EPOLL_CLOEXEC ) ) < 0 ) goto error;
+  root->wait_evfd = eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC );
+  if( root->wait_evfd < 0 ) goto error;
+  memset( &ev, 0, sizeof(ev) );
+  ev.events   = EPOLLIN;
+  ev.data.u64 = (uint32_t) PIP_PIPID_NULL;
+  if( epoll_ctl( root->wait_epfd, EPOLL_CTL_ADD, root->wait_evfd, &ev ) == 0 ) {
+    return;
+  }
+ error:
+  DBGF( "wait backend is disabled: %s", pip_errname( errno ) );
+  pip_wait_fd_fin( root );
+}
+
+void pip_wait_fd_fin( pip_root_t *root ) {
+  if( root->wait_epfd >= 0 ) (void) close( root->wait_epfd );
+  if( root->wait_evfd >= 0 ) (void) close( root->wait_evfd );
+  root->wait_epfd = -1;
+  root->wait_evfd = -1;
+}
+
+void pip_wait_fd_add( pip_root_t *root, pip_task_t *task ) {
+  struct epoll_event ev;
+  int fd;
+
+  if( root->wait_epfd < 0 || pip_is_threaded_() ) return;
+  /* a task already terminated is still a zombie, never fails by that */
+  fd = syscall( SYS_pidfd_open, task->tid, PIDFD_NONBLOCK );
+  if( fd < 0 && errno == EINVAL ) {
+    /* PIDFD_NONBLOCK is new in Linux 5.10 */
+    fd = syscall( SYS_pidfd_open, task->tid, 0 );
+  }
+  if( fd < 0 ) goto error;
+  (void) fcntl( fd, F_SETFD, FD_CLOEXEC );
+  memset( &ev, 0, sizeof(ev) );
+  ev.events   = EPOLLIN;
+  ev.data.u64 = (uint32_t) task->pipid;
+  if( epoll_ctl( root->wait_epfd, EPOLL_CTL_ADD, fd, &ev ) != 0 ) {
+    (void) close( fd );
+    goto error;
+  }
+  task->pidfd = fd;
+  return;
+
+ error:
+  /* only this task cannot be waited in epoll, the user may be */
+  /* polling the epoll fd and it must stay open                */
+  DBGF( "PIPID:%d no pidfd: %s", task->pipid, pip_errname( errno ) );
+  task->pidfd = PIP_PIDFD_NONE;
+  root->ntasks_nopidfd ++;
+}
+
+/* the eventfd is inherited by the tasks created in process mode */
+void pip_wait_fd_notify( pip_root_t *root ) {
+  if( root->wait_evfd >= 0 ) (void) eventfd_write( root->wait_evfd, 1 );
+}
+
+/* returns ENOSYS if the backend is disabled */
+static int pip_wait_fd_wait( pip_task_t *task, int *pipidp ) {
+  struct epoll_event	ev;
+  struct pollfd		pfd;
+  eventfd_t		count;
+  int			n;
+
+  *pipidp = PIP_PIPID_NULL;
+  if( pip_root->wait_epfd < 0 ) RETURN_NE( ENOSYS );
+  if( task != NULL ) {
+    /* only a pidfd can tell the termination of a specific task */
+    if( task->pidfd < 0 ) RETURN_NE( ENOSYS );
+    pfd.fd     = task->pidfd;
+    pfd.events = POLLIN;
+    (void) poll( &pfd, 1, -1 );
+    RETURN_NE( 0 );
+  }
+  /* a task without pidfd is found only by SIGCHLD */
+  if( pip_root->ntasks_nopidfd > 0 ) RETURN_NE( ENOSYS );
+  if( ( n = epoll_wait( pip_root->wait_epfd, &ev, 1, -1 ) ) == 1 ) {
+    *pipidp = (int) (uint32_t) ev.data.u64;
+    if( *pipidp == PIP_PIPID_NULL ) {
+      (void) eventfd_read( pip_root->wait_evfd, &count );
+    }
+  }
+  RETURN_NE( 0 );
+}
+
+/* the eventfd is shared by the posted events and the terminated */
+/* tasks in thread mode, once drained it must be readable again  */
+/* while any of them is left                                     */
+static void pip_wait_fd_rearm( void ) {
+  if( ( pip_root->event_q != NULL &&
+	pip_wait_cq_peek( pip_root->event_q ) != NULL ) ||
+      ( pip_root->wait_cq != NULL &&
+	pip_wait_cq_peek( pip_root->wait_cq ) != NULL ) ) {
+    pip_wait_fd_notify( pip_root );
+  }
 }
 
 static void pip_finalize_task( pip_task_t *task ) {
   ENTERF( "pipid=%d  status=0x%x", task->pipid, task->status );
   pip_gdbif_finalize_task( task );
+  /* the task stack, if allocated by ldpip, is not used any more */
+  pip_stack_put( pip_root, task->stack_map, task->stack_mapsz,
+		 task->numa_node );
+  task->stack_map   = NULL;
+  task->stack_mapsz = 0;
   /* dlclose() and free() must be called only from the root process since */
   /* corresponding dlmopen() and malloc() is called by the root process   */
   if( task->loaded != NULL ) {
@@ -263,54 +510,95 @@ static int pip_wait_task( pip_task_t *task ) {
   RETURN_NE( 1 );		/* terminated */
 }
 
+static int pip_wait_cq_pop( void ) {
+  pip_wait_cq_t		*cq = (pip_wait_cq_t*) pip_root->wait_cq;
+  pip_wait_cq_cell_t	*cell;
+  pip_task_t		*task;
+  int			pipid;
+
+  if( cq == NULL ) return PIP_PIPID_NULL;
+  while( ( cell = pip_wait_cq_peek( cq ) ) != NULL ) {
+    pipid = cell->pipid;
+    task  = &pip_root->tasks[pipid];
+    /* the task may have been waited already and respawned */
+    if( PIP_IS_ALIVE( task ) && task->flag_cq ) {
+      /* still in exit(), SIGCHLD will come later */
+      if( !pip_wait_task( task ) ) return PIP_PIPID_NULL;
+    } else {
+      pipid = PIP_PIPID_NULL;
+    }
+    pip_wait_cq_deq( cq, cell );
+    if( pipid != PIP_PIPID_NULL ) return pipid;
+  }
+  return PIP_PIPID_NULL;
+}
+
 static int pip_nonblocking_waitany( void ) {
   pip_task_t 	*task;
   static int	start = 0;
+  static uint32_t nlost_seen = 0;
+  uint32_t	nlost;
   int		id, pipid = PIP_PIPID_NULL;
 
   ENTER;
-  for( id=start; id<pip_root->ntasks; id++ ) {
+  if( ( pipid = pip_wait_cq_pop() ) != PIP_PIPID_NULL ) RETURN_NE( pipid );
+  if( pip_root->ntasks_curr == 0 ) RETURN_NE( PIP_PIPID_ANY );
+  /* in thread mode, every terminating task is in the queue */
+  /* unless the queue overflowed, and no scan is needed     */
+  nlost = pip_root->wait_cq_nlost;
+  if( pip_root->wait_cq != NULL &&
+      pip_is_threaded_()        &&
+      nlost == nlost_seen ) RETURN_NE( PIP_PIPID_NULL );
+
+  /* process mode, tasks killed by signals never push */
+  for( id = pip_next_busy_task( pip_root, start );
+       id >= 0;
+       id = pip_next_busy_task( pip_root, id + 1 ) ) {
     task = &pip_root->tasks[id];
-    if( PIP_IS_ALIVE( task ) && pip_wait_task( task ) ) {
-      goto found;
-    }
+    if( PIP_IS_ALIVE( task ) && pip_wait_task( task ) ) goto found;
   }
-  for( id=0; id<start; id++ ) {
+  for( id = pip_next_busy_task( pip_root, 0 );
+       id >= 0 && id < start;
+       id = pip_next_busy_task( pip_root, id + 1 ) ) {
     task = &pip_root->tasks[id];
-    if( PIP_IS_ALIVE( task ) && pip_wait_task( task ) ) {
-      goto found;
-    }
+    if( PIP_IS_ALIVE( task ) && pip_wait_task( task ) ) goto found;
   }
-  goto not_found;
+  /* all tasks dropped from the queue have been found */
+  nlost_seen = nlost;
+  RETURN_NE( PIP_PIPID_NULL );
 
  found:
   pipid = id ++;
   start = ( id < pip_root->ntasks ) ? id : 0;
-
- not_found:
-  /* chekc again if there is a live task or not */
-  if( pipid == PIP_PIPID_NULL ) {
-    for( id=0; id<pip_root->ntasks; id++ ) {
-      task = &pip_root->tasks[id];
-      if( PIP_IS_ALIVE( task ) ) goto live_task;
-    }
-    /* no live tasks */
-    pipid = PIP_PIPID_ANY;
-  }
- live_task:
   RETURN_NE( pipid );
 }
 
 static int pip_blocking_waitany( void ) {
-  int	pipid;
+  pip_task_t	*task;
+  int		pipid, hint = PIP_PIPID_NULL;
+  int		drained = 0;
 
   ENTER;
   while( 1 ) {
+    /* the task of the pidfd which became readable */
+    if( hint >= 0 && hint < pip_root->ntasks ) {
+      task = &pip_root->tasks[hint];
+      if( PIP_IS_ALIVE( task ) && pip_wait_task( task ) ) {
+	pipid = hint;
+	break;
+      }
+    }
     pipid = pip_nonblocking_waitany();
     DBGF( "pip_nonblocking_waitany() = %d", pipid );
     if( pipid != PIP_PIPID_NULL ) break;
-    ASSERT( pip_signal_wait( SIGCHLD ) == 0 );
+    if( pip_wait_fd_wait( NULL, &hint ) != 0 ) {
+      ASSERT( pip_signal_wait( SIGCHLD ) == 0 );
+    } else if( hint == PIP_PIPID_NULL ) {
+      drained = 1;
+    }
   }
+  /* the events may have been posted while waiting */
+  if( drained ) pip_wait_fd_rearm();
   RETURN( pipid );
 }
 
@@ -336,7 +624,9 @@ int pip_wait( int pipid, int *statusp ) {
 	pip_finalize_task( task );
 	break;
       }
-      ASSERT( pip_signal_wait( SIGCHLD ) == 0 );
+      if( pip_wait_fd_wait( task, &pipid ) != 0 ) {
+	ASSERT( pip_signal_wait( SIGCHLD ) == 0 );
+      }
     }
   }
   RETURN( err );
@@ -400,3 +690,49 @@ int pip_trywait_any( int *pipidp, int *statusp ) {
   }
   RETURN( err );
 }
+
+int pip_get_wait_fd( int *fdp ) {
+  ENTER;
+  if( !pip_is_effective() || pip_root == NULL ) RETURN( EPERM  );
+  if( !pip_isa_root() )                         RETURN( EPERM  );
+  if( fdp == NULL )                             RETURN( EINVAL );
+  if( pip_root->wait_epfd < 0 )                 RETURN( ENOSYS );
+  *fdp = pip_root->wait_epfd;
+  RETURN( 0 );
+}
+
+int pip_post_event( uint64_t value ) {
+  int err;
+
+  ENTER;
+  if( !pip_is_effective() || pip_root == NULL ) RETURN( EPERM );
+  if( pip_root->event_q == NULL )               RETURN( EPERM );
+  err = pip_wait_cq_enq( pip_root->event_q, pip_task->pipid, value );
+  if( !err ) pip_wait_fd_notify( pip_root );
+  RETURN( err );
+}
+
+int pip_get_events( pip_event_t *events, int n, int *neventsp ) {
+  pip_wait_cq_t		*eq;
+  pip_wait_cq_cell_t	*cell;
+  eventfd_t		count;
+  int			i;
+
+  ENTER;
+  if( !pip_is_effective() || pip_root == NULL ) RETURN( EPERM  );
+  if( !pip_isa_root() )                         RETURN( EPERM  );
+  if( events == NULL || n < 0 )                 RETURN( EINVAL );
+  if( ( eq = (pip_wait_cq_t*) pip_root->event_q ) == NULL ) RETURN( EPERM );
+
+  if( pip_root->wait_evfd >= 0 ) {
+    (void) eventfd_read( pip_root->wait_evfd, &count );
+  }
+  for( i=0; i<n && ( cell = pip_wait_cq_peek( eq ) ) != NULL; i++ ) {
+    events[i].pipid = cell->pipid;
+    events[i].value = cell->value;
+    pip_wait_cq_deq( eq, cell );
+  }
+  if( neventsp != NULL ) *neventsp = i;
+  pip_wait_fd_rearm();
+  RETURN( 0 );
+}